@@ -8,16 +8,29 @@ typedef struct {
   int victory;
   int game_over;
   int accumulated_points;
-  char* data;
+  int origin_x; // Board cell shown at the top-left (non-zero only for windows)
+  int origin_y;
+  char* data; // Owned by the API, valid until the next receive_board_update call
 } Board;
 
 int pacman_connect(char const *req_pipe_path, char const *notif_pipe_path, char const *server_pipe_path);
 
 void pacman_play(char command);
 
+/// Asks the server to send only a rows x cols window around pacman
+/// (0 for the whole board).
+void pacman_viewport(int rows, int cols);
+
+/// Asks the server to end the game and closes the request pipe. The server
+/// then closes the notification pipe, so a receive_board_update in progress
+/// returns (data=NULL); call pacman_close once no thread receives boards.
 /// @return 0 if the disconnection was successful, 1 otherwise.
 int pacman_disconnect();
 
+/// Closes the notification pipe, removes the FIFOs and frees the retained
+/// board. No receive_board_update may be running or follow.
+void pacman_close(void);
+
 Board receive_board_update(void);
 
 #endif
\ No newline at end of file
@@ -8,6 +8,27 @@ enum {
   OP_CODE_DISCONNECT = 2,
   OP_CODE_PLAY = 3,
   OP_CODE_BOARD = 4,
+  OP_CODE_BOARD_DELTA = 5,
+  OP_CODE_VIEWPORT = 6,
+  OP_CODE_BOARD_WINDOW = 7,
+  OP_CODE_FRAME_FORMAT = 8,
 };
 
+// Largest board a frame may carry (width * height)
+#define MAX_BOARD_CELLS (1 << 24)
+
+// Board frames: (char)OP_CODE | (int)frame_length | 6 int fields | body,
+// where frame_length counts the bytes after itself
+#define BOARD_LENGTH_SIZE sizeof(int)
+#define BOARD_FIELDS_SIZE (6 * sizeof(int))
+#define BOARD_DELTA_ENTRY_SIZE (sizeof(int) + 1)
+#define BOARD_WINDOW_ORIGIN_SIZE (2 * sizeof(int))
+
+// Packed cells: keyframes and windows flagged with BOARD_PACKED_FLAG carry
+// 3-bit glyph codes, 8 cells per 24-bit little-endian group
+#define BOARD_FORMAT_PACKED 1
+#define BOARD_PACKED_FLAG 0x40
+#define BOARD_PACKED_GLYPHS " #o@CM"
+#define BOARD_PACKED_SIZE(n_cells) ((((size_t)(n_cells) + 7) / 8) * 3)
+
 #endif
\ No newline at end of file
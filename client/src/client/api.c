@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <sys/stat.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <errno.h>
 
 
@@ -18,9 +19,39 @@ struct Session {
   int notif_pipe;         // File descriptor for notification pipe (server -> client)
   char req_pipe_path[MAX_PIPE_PATH_LENGTH + 1];
   char notif_pipe_path[MAX_PIPE_PATH_LENGTH + 1];
+  char *board_data;       // Retained board, base for OP_CODE_BOARD_DELTA frames
+  int board_width;
+  int board_height;
+  int windowed;           // Retained board is a viewport window (no base for deltas)
+  char *frame;            // Body of the frame being read (deltas, skipped frames)
+  size_t frame_capacity;
 };
 
-static struct Session session = {.id = -1, .req_pipe = -1, .notif_pipe = -1};
+static struct Session session = {.id = -1, .req_pipe = -1, .notif_pipe = -1, .board_data = NULL,
+                                 .frame = NULL};
+
+
+/**
+ * Reads exactly size bytes. Large frames span several pipe buffers, so a
+ * single read() may return only part of them.
+ *
+ * @return size on success, or what read() returned when the pipe failed or
+ *         closed before the first byte (a short count if it closed midway)
+ */
+static ssize_t read_full(int fd, void *buffer, size_t size) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t r = read(fd, (char *)buffer + done, size - done);
+    if (r < 0 && errno == EINTR) {
+      continue;
+    }
+    if (r <= 0) {
+      return done > 0 ? (ssize_t)done : r;
+    }
+    done += (size_t)r;
+  }
+  return (ssize_t)done;
+}
 
 
 /**
@@ -143,6 +174,13 @@ int pacman_connect(char const *req_pipe_path, char const *notif_pipe_path, char
   }
   debug("pacman_connect: Opened request FIFO for writing\n");
 
+  // 8. Ask for packed board cells (receive_board_update unpacks them)
+  // Format: (char)OP_CODE | (char)format
+  char format[2] = {OP_CODE_FRAME_FORMAT, BOARD_FORMAT_PACKED};
+  if (write(session.req_pipe, format, sizeof(format)) != sizeof(format)) {
+    debug("pacman_connect: Failed to request packed frames: %s\n", strerror(errno));
+  }
+
   debug("pacman_connect: Connection established successfully!\n");
   return 0;
 }
@@ -176,7 +214,38 @@ void pacman_play(char command) {
 
 
 /**
- * Disconnects from the server.
+ * Announces how much of the board the client can show.
+ * 
+ * Protocol:
+ *   Request: (char)OP_CODE=6 | (int)rows | (int)cols
+ *   No response expected; boards larger than the viewport then arrive as
+ *   OP_CODE_BOARD_WINDOW frames
+ */
+void pacman_viewport(int rows, int cols) {
+  if (session.req_pipe < 0) {
+    debug("pacman_viewport: Not connected to server\n");
+    return;
+  }
+
+  // Build message: (char)OP_CODE | (int)rows | (int)cols
+  char message[1 + 2 * sizeof(int)];
+  int view[2] = {rows, cols};
+  message[0] = OP_CODE_VIEWPORT;
+  memcpy(&message[1], view, sizeof(view));
+
+  ssize_t written = write(session.req_pipe, message, sizeof(message));
+  if (written != sizeof(message)) {
+    debug("pacman_viewport: Failed to send viewport: %s\n", strerror(errno));
+  } else {
+    debug("pacman_viewport: Sent viewport %dx%d\n", cols, rows);
+  }
+}
+
+
+/**
+ * Disconnects from the server. Only the request pipe is closed here: a
+ * receiver thread may still be reading the notification pipe and the
+ * retained board, until the server closes its end (see pacman_close).
  * 
  * Protocol:
  *   Request: (char)OP_CODE=2
@@ -194,44 +263,122 @@ int pacman_disconnect() {
     debug("pacman_disconnect: Sent disconnect message\n");
   }
 
-  // 2. Close file descriptors
+  // 2. Close the request pipe (the server sees EOF even if the message was lost)
   if (session.req_pipe >= 0) {
     close(session.req_pipe);
     session.req_pipe = -1;
     debug("pacman_disconnect: Closed request pipe\n");
   }
 
+  debug("pacman_disconnect: Disconnected successfully\n");
+  return 0;
+}
+
+
+/**
+ * Releases what the connection left once nothing receives boards anymore:
+ * the notification pipe, the FIFOs and the retained board and frame buffers.
+ */
+void pacman_close(void) {
   if (session.notif_pipe >= 0) {
     close(session.notif_pipe);
     session.notif_pipe = -1;
-    debug("pacman_disconnect: Closed notification pipe\n");
+    debug("pacman_close: Closed notification pipe\n");
   }
 
-  // 3. Remove FIFOs from filesystem
+  // Remove FIFOs from filesystem
   if (session.req_pipe_path[0] != '\0') {
     unlink(session.req_pipe_path);
-    debug("pacman_disconnect: Removed request FIFO\n");
+    debug("pacman_close: Removed request FIFO\n");
     session.req_pipe_path[0] = '\0';
   }
 
   if (session.notif_pipe_path[0] != '\0') {
     unlink(session.notif_pipe_path);
-    debug("pacman_disconnect: Removed notification FIFO\n");
+    debug("pacman_close: Removed notification FIFO\n");
     session.notif_pipe_path[0] = '\0';
   }
 
-  debug("pacman_disconnect: Disconnected successfully\n");
+  free(session.board_data);
+  session.board_data = NULL;
+  free(session.frame);
+  session.frame = NULL;
+  session.frame_capacity = 0;
+}
+
+
+/**
+ * Reads a frame body of the given size into session.frame, growing it as
+ * needed (the buffer is kept for the next frame).
+ *
+ * @return 0 on success, -1 on error or disconnect
+ */
+static int read_frame_body(size_t size) {
+  if (size > session.frame_capacity) {
+    char *grown = realloc(session.frame, size);
+    if (grown == NULL) {
+      debug("read_frame_body: Failed to allocate %zu bytes\n", size);
+      return -1;
+    }
+    session.frame = grown;
+    session.frame_capacity = size;
+  }
+
+  ssize_t bytes_read = read_full(session.notif_pipe, session.frame, size);
+  if (bytes_read != (ssize_t)size) {
+    debug("read_frame_body: Failed to read frame (read=%zd, expected=%zu)\n", bytes_read, size);
+    return -1;
+  }
   return 0;
 }
 
 
+/**
+ * Expands packed cells (3-bit codes, 8 cells per 3 bytes) into glyphs.
+ * Groups are independent and fixed-size, so the loop vectorizes well.
+ */
+static void unpack_cells(const unsigned char *in, size_t n_cells, char *out) {
+  static const char glyphs[9] = BOARD_PACKED_GLYPHS "  ";  // Unused codes 6-7 show as empty
+  size_t groups = n_cells / 8;
+
+  for (size_t g = 0; g < groups; g++) {
+    uint32_t bits = in[g * 3] | (uint32_t)in[g * 3 + 1] << 8 | (uint32_t)in[g * 3 + 2] << 16;
+    for (int i = 0; i < 8; i++) {
+      out[g * 8 + i] = glyphs[(bits >> (3 * i)) & 7];
+    }
+  }
+
+  size_t rest = n_cells % 8;
+  if (rest > 0) {
+    uint32_t bits = in[groups * 3] | (uint32_t)in[groups * 3 + 1] << 8 |
+                    (uint32_t)in[groups * 3 + 2] << 16;
+    for (size_t i = 0; i < rest; i++) {
+      out[groups * 8 + i] = glyphs[(bits >> (3 * i)) & 7];
+    }
+  }
+}
+
+
 /**
  * Receives a board update from the server.
  * 
  * Protocol:
- *   Message: (char)OP_CODE=4 | (int)width | (int)height | (int)tempo | 
- *            (int)victory | (int)game_over | (int)accumulated_points | 
- *            (char[width*height])board_data
+ *   Keyframe: (char)OP_CODE=4 | (int)frame_length | (int)width | (int)height |
+ *             (int)tempo | (int)victory | (int)game_over |
+ *             (int)accumulated_points | (char[width*height])board_data
+ *   Delta:    (char)OP_CODE=5 | (same header) | (int)n_changes |
+ *             n_changes * ((int)cell_index | (char)glyph)
+ *   Window:   (char)OP_CODE=7 | (same header, window width and height) |
+ *             (int)origin_x | (int)origin_y | (char[width*height])board_data
+ * 
+ * With BOARD_PACKED_FLAG in the OP_CODE (asked for by pacman_connect),
+ * keyframe and window board_data is packed 3 bits per cell instead.
+ * 
+ * frame_length counts the bytes after itself. Each part is read until it is
+ * complete, so frames may be larger than the pipe buffer. Frames with an
+ * unknown OP_CODE are skipped.
+ * Deltas are applied onto the board retained from previous frames. Windows
+ * (sent after pacman_viewport) replace it with the visible part of the board.
  * 
  * @return Board struct with updated data (data=NULL on error or disconnect)
  */
@@ -244,27 +391,48 @@ Board receive_board_update(void) {
     return board;
   }
 
-  // 1. Read OP_CODE
+  // 1. Read OP_CODE and frame length, skipping frames we do not know
   char op_code;
-  ssize_t bytes_read = read(session.notif_pipe, &op_code, sizeof(op_code));
-  if (bytes_read <= 0) {
-    debug("receive_board_update: Connection closed or error (read=%zd)\n", bytes_read);
-    return board;
+  int frame_length;
+  int packed;
+  while (1) {
+    char prefix[1 + BOARD_LENGTH_SIZE];
+    ssize_t bytes_read = read_full(session.notif_pipe, prefix, sizeof(prefix));
+    if (bytes_read != sizeof(prefix)) {
+      debug("receive_board_update: Connection closed or error (read=%zd)\n", bytes_read);
+      return board;
+    }
+    op_code = prefix[0] & ~BOARD_PACKED_FLAG;
+    packed = (prefix[0] & BOARD_PACKED_FLAG) != 0;
+    memcpy(&frame_length, &prefix[1], BOARD_LENGTH_SIZE);
+
+    // No valid frame is longer than the fields plus a full board
+    if (frame_length < (int)BOARD_FIELDS_SIZE ||
+        frame_length > (int)(BOARD_FIELDS_SIZE + BOARD_WINDOW_ORIGIN_SIZE) + MAX_BOARD_CELLS) {
+      debug("receive_board_update: Invalid frame length: %d\n", frame_length);
+      return board;
+    }
+
+    if (op_code == OP_CODE_BOARD || op_code == OP_CODE_BOARD_WINDOW ||
+        (op_code == OP_CODE_BOARD_DELTA && !packed)) {
+      break;
+    }
+
+    debug("receive_board_update: Skipping frame with OP_CODE %d (%d bytes)\n", prefix[0], frame_length);
+    if (read_frame_body((size_t)frame_length) < 0) {
+      return board;
+    }
   }
 
-  if (op_code != OP_CODE_BOARD) {
-    debug("receive_board_update: Unexpected OP_CODE: %d\n", op_code);
-    return board;
-  }
-
-  // 2. Read fixed-size header: width, height, tempo, victory, game_over, points
+  // 2. Read fixed-size fields: width, height, tempo, victory, game_over, points
   int header[6];
-  bytes_read = read(session.notif_pipe, header, sizeof(header));
+  ssize_t bytes_read = read_full(session.notif_pipe, header, sizeof(header));
   if (bytes_read != sizeof(header)) {
     debug("receive_board_update: Failed to read header (read=%zd, expected=%zu)\n", 
           bytes_read, sizeof(header));
     return board;
   }
+  size_t body_size = (size_t)frame_length - BOARD_FIELDS_SIZE;
 
   board.width = header[0];
   board.height = header[1];
@@ -276,29 +444,101 @@ Board receive_board_update(void) {
   debug("receive_board_update: Got header - %dx%d, tempo=%d, victory=%d, game_over=%d, points=%d\n",
         board.width, board.height, board.tempo, board.victory, board.game_over, board.accumulated_points);
 
-  // 3. Read board data
-  int board_size = board.width * board.height;
-  if (board_size <= 0 || board_size > 10000) {  // Sanity check
-    debug("receive_board_update: Invalid board size: %d\n", board_size);
-    return board;
-  }
-
-  board.data = malloc((size_t)board_size + 1);
-  if (board.data == NULL) {
-    debug("receive_board_update: Failed to allocate board data\n");
+  if (board.width <= 0 || board.height <= 0 ||
+      (long long)board.width * board.height > MAX_BOARD_CELLS) {  // Sanity check
+    debug("receive_board_update: Invalid board size: %dx%d\n", board.width, board.height);
     return board;
   }
+  int board_size = board.width * board.height;
 
-  bytes_read = read(session.notif_pipe, board.data, (size_t)board_size);
-  if (bytes_read != board_size) {
-    debug("receive_board_update: Failed to read board data (read=%zd, expected=%d)\n", 
-          bytes_read, board_size);
-    free(board.data);
-    board.data = NULL;
-    return board;
+  if (op_code == OP_CODE_BOARD || op_code == OP_CODE_BOARD_WINDOW) {
+    // 3a. Keyframe or window - replace the retained board
+    size_t origin_size = op_code == OP_CODE_BOARD_WINDOW ? BOARD_WINDOW_ORIGIN_SIZE : 0;
+    size_t data_size = packed ? BOARD_PACKED_SIZE(board_size) : (size_t)board_size;
+    if (body_size != origin_size + data_size) {
+      debug("receive_board_update: Frame body is %zu bytes, expected %zu\n",
+            body_size, origin_size + data_size);
+      return board;
+    }
+
+    if (origin_size > 0) {
+      int origin[2];
+      if (read_full(session.notif_pipe, origin, sizeof(origin)) != sizeof(origin)) {
+        debug("receive_board_update: Failed to read window origin\n");
+        return board;
+      }
+      board.origin_x = origin[0];
+      board.origin_y = origin[1];
+    }
+
+    if (session.board_width != board.width || session.board_height != board.height) {
+      free(session.board_data);
+      session.board_data = malloc((size_t)board_size + 1);
+      if (session.board_data == NULL) {
+        debug("receive_board_update: Failed to allocate board data\n");
+        session.board_width = 0;
+        session.board_height = 0;
+        return board;
+      }
+      session.board_width = board.width;
+      session.board_height = board.height;
+    }
+
+    if (packed) {
+      if (read_frame_body(data_size) < 0) {
+        return board;
+      }
+      unpack_cells((const unsigned char *)session.frame, (size_t)board_size, session.board_data);
+    } else {
+      // The body goes straight into the retained board
+      bytes_read = read_full(session.notif_pipe, session.board_data, (size_t)board_size);
+      if (bytes_read != board_size) {
+        debug("receive_board_update: Failed to read board data (read=%zd, expected=%d)\n", 
+              bytes_read, board_size);
+        return board;
+      }
+    }
+    session.board_data[board_size] = '\0';  // Null terminate for safety
+    session.windowed = origin_size > 0;
+
+    debug("receive_board_update: Received board %s (%d cells, %zu bytes)\n",
+          session.windowed ? "window" : "keyframe", board_size, data_size);
+  } else {
+    // 3b. Delta - apply changed cells onto the retained board
+    if (read_frame_body(body_size) < 0) {
+      return board;
+    }
+
+    if (session.board_data == NULL || session.windowed ||
+        session.board_width != board.width || session.board_height != board.height) {
+      debug("receive_board_update: Delta without matching keyframe\n");
+      return board;
+    }
+
+    int n_changes;
+    if (body_size < sizeof(n_changes)) {
+      debug("receive_board_update: Delta body too short (%zu bytes)\n", body_size);
+      return board;
+    }
+    memcpy(&n_changes, session.frame, sizeof(n_changes));
+    if (n_changes < 0 ||
+        body_size != sizeof(n_changes) + (size_t)n_changes * BOARD_DELTA_ENTRY_SIZE) {
+      debug("receive_board_update: Invalid delta count %d for %zu bytes\n", n_changes, body_size);
+      return board;
+    }
+
+    const char *entry = session.frame + sizeof(n_changes);
+    for (int i = 0; i < n_changes; i++, entry += BOARD_DELTA_ENTRY_SIZE) {
+      int index;
+      memcpy(&index, entry, sizeof(int));
+      if (index >= 0 && index < board_size) {
+        session.board_data[index] = entry[sizeof(int)];
+      }
+    }
+
+    debug("receive_board_update: Applied board delta (%d cells)\n", n_changes);
   }
-  board.data[board_size] = '\0';  // Null terminate for safety
 
-  debug("receive_board_update: Received board data (%d bytes)\n", board_size);
+  board.data = session.board_data;
   return board;
-}
\ No newline at end of file
+}
@@ -17,6 +17,28 @@ bool stop_execution = false;
 int tempo;
 pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 
+// Screen lines around the board: title, status, blank line, blank line, points
+#define BOARD_SCREEN_MARGIN 5
+
+/**
+ * Tells the server how much of the board fits on screen, if that changed
+ * (ncurses updates LINES and COLS when the terminal is resized).
+ */
+static void announce_viewport(void) {
+    static int announced_rows = -1, announced_cols = -1;
+
+    int rows = LINES - BOARD_SCREEN_MARGIN;
+    int cols = COLS;
+    if (rows < 1) rows = 1;
+    if (cols < 1) cols = 1;
+
+    if (rows != announced_rows || cols != announced_cols) {
+        pacman_viewport(rows, cols);
+        announced_rows = rows;
+        announced_cols = cols;
+    }
+}
+
 static void *receiver_thread(void *arg) {
     (void)arg;
 
@@ -95,6 +117,7 @@ int main(int argc, char *argv[]) {
 
     terminal_init();
     set_timeout(500);
+    announce_viewport();
     draw_board_client(board);
     refresh_screen();
 
@@ -110,6 +133,8 @@ int main(int argc, char *argv[]) {
         }
         pthread_mutex_unlock(&mutex);
 
+        announce_viewport();
+
         if (cmd_fp) {
             // Input from file
             ch = fgetc(cmd_fp);
@@ -154,10 +179,14 @@ int main(int argc, char *argv[]) {
 
     }
 
+    // The server closes the notification pipe once it sees the disconnect,
+    // which ends the receiver; only then can the retained board be freed
     pacman_disconnect();
 
     pthread_join(receiver_thread_id, NULL);
 
+    pacman_close();
+
     if (cmd_fp)
         fclose(cmd_fp);
 
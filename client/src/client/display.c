@@ -126,6 +126,10 @@ void draw_board_client(Board board) {
     attron(COLOR_PAIR(5));
     mvprintw(start_row + board.height + 1, 0, "Points: %d",
              board.accumulated_points);
+    if (board.origin_x > 0 || board.origin_y > 0) {
+        // Window of a larger board
+        printw(" | View at %d,%d", board.origin_x, board.origin_y);
+    }
     attroff(COLOR_PAIR(5));
 }
 
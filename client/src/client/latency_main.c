@@ -0,0 +1,283 @@
+#include "api.h"
+#include "debug.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+// =============================================================================
+// Level Transition Latency Harness
+// =============================================================================
+//
+// Usage: ./latency <server_binary> [games [max_median_ms]]
+// Starts the server on generated levels where one 'D' walks pacman into
+// the portal, plays every level in each game and measures the level
+// transitions as the client sees them: from the last frame of a level to
+// the first frame of the next (level k is k rows taller than level 0, so a
+// new level is a change of height). Prints a summary and fails if the
+// median exceeds max_median_ms.
+
+// As many levels as the server loads (its MAX_LEVELS)
+#define LATENCY_LEVELS 20
+#define LATENCY_DEFAULT_GAMES 10
+#define LATENCY_MAX_GAMES 1000
+#define LATENCY_DEFAULT_MAX_MS 10.0
+#define LATENCY_TEMPO_MS 10
+
+// Waits for the server to create its FIFO, and for it to exit
+#define LATENCY_STARTUP_TIMEOUT_MS 5000
+#define LATENCY_SHUTDOWN_TIMEOUT_MS 5000
+
+static char work_dir[64];
+
+/**
+ * Writes levels 000.lvl, 001.lvl, ... into work_dir. Level k is:
+ *   XXXX
+ *   Xo@X     (pacman starts on the dot, the portal is to its right)
+ *   XXXX     (k + 1 wall rows)
+ */
+static int generate_levels(int n_levels) {
+    for (int k = 0; k < n_levels; k++) {
+        char path[128];
+        snprintf(path, sizeof(path), "%s/%03d.lvl", work_dir, k);
+        FILE* file = fopen(path, "w");
+        if (!file) {
+            return -1;
+        }
+        fprintf(file, "DIM %d 4\nTEMPO %d\nXXXX\nXo@X\n", k + 3, LATENCY_TEMPO_MS);
+        for (int i = 0; i <= k; i++) {
+            fputs("XXXX\n", file);
+        }
+        if (fclose(file) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Removes work_dir and everything the server left in it.
+ */
+static void remove_work_dir(void) {
+    DIR* dir = opendir(work_dir);
+    if (dir) {
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+                continue;
+            }
+            char path[384];
+            snprintf(path, sizeof(path), "%s/%s", work_dir, entry->d_name);
+            unlink(path);
+        }
+        closedir(dir);
+    }
+    rmdir(work_dir);
+}
+
+static double now_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e3 + (double)now.tv_nsec / 1e6;
+}
+
+/**
+ * Starts the server in work_dir and waits for its registration FIFO.
+ * Returns its pid, or -1.
+ */
+static pid_t start_server(const char* server_binary, const char* fifo_path) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (chdir(work_dir) < 0) {
+            _exit(127);
+        }
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDOUT_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+        }
+        execl(server_binary, server_binary, work_dir, "1", fifo_path, (char*)NULL);
+        _exit(127);
+    }
+    if (pid < 0) {
+        return -1;
+    }
+
+    double deadline = now_ms() + LATENCY_STARTUP_TIMEOUT_MS;
+    struct stat st;
+    while (stat(fifo_path, &st) < 0 || !S_ISFIFO(st.st_mode)) {
+        if (now_ms() > deadline || waitpid(pid, NULL, WNOHANG) == pid) {
+            kill(pid, SIGKILL);
+            waitpid(pid, NULL, 0);
+            return -1;
+        }
+        sleep_ms(10);
+    }
+    return pid;
+}
+
+static void stop_server(pid_t pid) {
+    kill(pid, SIGTERM);
+    double deadline = now_ms() + LATENCY_SHUTDOWN_TIMEOUT_MS;
+    while (waitpid(pid, NULL, WNOHANG) != pid) {
+        if (now_ms() > deadline) {
+            fprintf(stderr, "Warning: server did not stop, killing it\n");
+            kill(pid, SIGKILL);
+            waitpid(pid, NULL, 0);
+            return;
+        }
+        sleep_ms(10);
+    }
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Plays every level. Fills transitions (ms) and returns how many were
+ * measured, or -1 if the game did not go as generated.
+ */
+static int play(int n_levels, double* transitions) {
+    int n_transitions = 0;
+    int level = -1;
+    int height = 0;
+    double last_frame = 0;
+
+    while (true) {
+        Board board = receive_board_update();
+        double received = now_ms();
+        if (!board.data) {
+            fprintf(stderr, "Error: server closed the connection at level %d\n", level);
+            return -1;
+        }
+
+        if (board.height != height) {
+            // First frame of a new level
+            if (level >= 0) {
+                transitions[n_transitions++] = received - last_frame;
+            }
+            level++;
+            height = board.height;
+            if (level >= n_levels || height != level + 3) {
+                fprintf(stderr, "Error: unexpected %dx%d board\n", board.width, board.height);
+                return -1;
+            }
+            pacman_play('D');
+        }
+        last_frame = received;
+
+        if (board.victory) {
+            return level == n_levels - 1 ? n_transitions : -1;
+        }
+        if (board.game_over) {
+            fprintf(stderr, "Error: game over at level %d\n", level);
+            return -1;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 4) {
+        fprintf(stderr, "Usage: %s <server_binary> [games [max_median_ms]]\n", argv[0]);
+        return 1;
+    }
+    int n_games = argc > 2 ? atoi(argv[2]) : LATENCY_DEFAULT_GAMES;
+    double max_ms = argc > 3 ? atof(argv[3]) : LATENCY_DEFAULT_MAX_MS;
+    if (n_games < 1 || n_games > LATENCY_MAX_GAMES || max_ms <= 0) {
+        fprintf(stderr, "Error: 1-%d games and a positive max_median_ms\n", LATENCY_MAX_GAMES);
+        return 1;
+    }
+
+    // The server runs in work_dir
+    char server_binary[2 * PATH_MAX];
+    char cwd[PATH_MAX];
+    if (argv[1][0] == '/') {
+        snprintf(server_binary, sizeof(server_binary), "%s", argv[1]);
+    } else if (getcwd(cwd, sizeof(cwd))) {
+        snprintf(server_binary, sizeof(server_binary), "%s/%s", cwd, argv[1]);
+    } else {
+        fprintf(stderr, "Error: getcwd: %s\n", strerror(errno));
+        return 1;
+    }
+    if (access(server_binary, X_OK) < 0) {
+        fprintf(stderr, "Error: %s: %s\n", argv[1], strerror(errno));
+        return 1;
+    }
+
+    // The server closes the FIFOs once the last level is won
+    signal(SIGPIPE, SIG_IGN);
+
+    snprintf(work_dir, sizeof(work_dir), "/tmp/latency_XXXXXX");
+    if (!mkdtemp(work_dir) || generate_levels(LATENCY_LEVELS) < 0) {
+        fprintf(stderr, "Error: cannot generate levels: %s\n", strerror(errno));
+        remove_work_dir();
+        return 1;
+    }
+
+    open_debug_file("/dev/null");
+
+    char fifo_path[128];
+    snprintf(fifo_path, sizeof(fifo_path), "%s/register", work_dir);
+    pid_t server = start_server(server_binary, fifo_path);
+    if (server < 0) {
+        fprintf(stderr, "Error: cannot start %s\n", server_binary);
+        remove_work_dir();
+        return 1;
+    }
+
+    size_t capacity = (size_t)n_games * (LATENCY_LEVELS - 1);
+    double* transitions = malloc(capacity * sizeof(double));
+    int n_transitions = 0;
+    for (int game = 0; transitions && game < n_games; game++) {
+        char req_path[64], notif_path[64];
+        snprintf(req_path, sizeof(req_path), "/tmp/latency_%d_%d_req", (int)getpid(), game);
+        snprintf(notif_path, sizeof(notif_path), "/tmp/latency_%d_%d_notif", (int)getpid(), game);
+        if (pacman_connect(req_path, notif_path, fifo_path) != 0) {
+            fprintf(stderr, "Error: cannot connect to the server\n");
+            n_transitions = -1;
+            break;
+        }
+        int measured = play(LATENCY_LEVELS, transitions + n_transitions);
+        pacman_disconnect();
+        pacman_close();
+        if (measured < 0) {
+            n_transitions = -1;
+            break;
+        }
+        n_transitions += measured;
+    }
+
+    stop_server(server);
+    remove_work_dir();
+    close_debug_file();
+    if (n_transitions <= 0) {
+        free(transitions);
+        return 1;
+    }
+
+    qsort(transitions, (size_t)n_transitions, sizeof(double), compare_doubles);
+    double median = transitions[n_transitions / 2];
+    double p99 = transitions[(size_t)n_transitions * 99 / 100];
+    printf("Level transitions: %d  min %.3f ms  median %.3f ms  p99 %.3f ms  max %.3f ms\n",
+           n_transitions, transitions[0], median, p99, transitions[n_transitions - 1]);
+    free(transitions);
+
+    if (median > max_ms) {
+        printf("FAIL: median above %g ms\n", max_ms);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -6,6 +6,9 @@
 #define MAX_FILENAME 256
 #define MAX_GHOSTS 25
 
+#include <stdbool.h>
+#include <stddef.h>
+
 typedef enum {
     REACHED_PORTAL = 2,
     MOVE_COMPLETED = 1,     // Command was consumed, advance to next
@@ -44,17 +47,14 @@ typedef struct {
     int charged;
 } ghost_t;
 
-// A single cell on the board
-typedef struct {
-    char content;   // stuff like 'P' for pacman 'M' for monster/ghost and 'W' for wall
-    int has_dot;    // whether there is a dot in this position or not
-    int has_portal; // whether there is a portal in this position or not
-} board_pos_t;
-
 // The full game board
+// Cells are stored as a structure of arrays: one content byte per cell plus
+// bit planes for the static dots and portals (use the board_*_dot/portal helpers)
 typedef struct {
     int width, height;      // dimensions of the board
-    board_pos_t* board;     // actual board, a row-major matrix
+    char* content;          // per cell: 'P' for pacman, 'M' for monster/ghost, 'W' for wall or ' ' (row-major)
+    unsigned char* dots;    // bit plane: whether there is a dot in the cell
+    unsigned char* portals; // bit plane: whether there is a portal in the cell
     int n_pacmans;          // number of pacmans in the board
     pacman_t* pacmans;      // array containing every pacman in the board to iterate through when processing (Just 1)
     int n_ghosts;           // number of ghosts in the board
@@ -63,8 +63,41 @@ typedef struct {
     char pacman_file[256];  // file with pacman movements
     char ghosts_files[MAX_GHOSTS][256]; // files with monster movements
     int tempo;              // Duration of each play
+    unsigned int rng;       // rand_r state for 'R' moves (per board, so a game replays the same)
+    
+    // Render plane: the glyph clients see for each cell ('#', 'C', 'M', '@', 'o', ' '),
+    // updated whenever a cell is mutated so frames can be sent without re-mapping
+    char* render;           // row-major, width * height glyphs
+    int* dirty;             // cells whose glyph changed since the last frame (no duplicates)
+    int n_dirty;            // number of entries in dirty
+    int dirty_capacity;     // max entries - past that a full frame is cheaper anyway
+    bool dirty_overflow;    // more cells changed than dirty can hold
+    unsigned char* dirty_mark; // bit plane: cell is already listed in dirty
 } board_t;
 
+// Bytes needed by a bit plane covering n_cells cells
+#define BOARD_BITPLANE_SIZE(n_cells) (((size_t)(n_cells) + 7) / 8)
+
+static inline bool board_bit(const unsigned char* plane, int idx) {
+    return (plane[idx >> 3] >> (idx & 7)) & 1;
+}
+
+static inline void board_set_bit(unsigned char* plane, int idx, bool on) {
+    if (on) {
+        plane[idx >> 3] |= (unsigned char)(1u << (idx & 7));
+    } else {
+        plane[idx >> 3] &= (unsigned char)~(1u << (idx & 7));
+    }
+}
+
+static inline bool board_has_dot(const board_t* board, int idx) {
+    return board_bit(board->dots, idx);
+}
+
+static inline bool board_has_portal(const board_t* board, int idx) {
+    return board_bit(board->portals, idx);
+}
+
 /*Makes the current thread sleep for 'int milliseconds' miliseconds*/
 void sleep_ms(int milliseconds);
 
@@ -77,6 +110,26 @@ int move_ghost(board_t* board, int ghost_index, command_t* command);
 /*Process the death of a Pacman*/
 void kill_pacman(board_t* board, int pacman_index);
 
+/*Forgets the cells changed so far (called once they were sent to the client)*/
+void board_clear_dirty(board_t* board);
+
+/*Packs n_cells glyphs into 3-bit codes (see BOARD_PACKED_GLYPHS), 8 cells per
+3 bytes. out may be the glyph buffer itself. Returns the packed size*/
+size_t board_pack_glyphs(const char* glyphs, size_t n_cells, unsigned char* out);
+
+/*Bytes written by board_checkpoint*/
+size_t board_checkpoint_size(const board_t* board);
+
+/*Copies everything a tick can change (cells, pacmans, ghosts and the random
+state) to out, board_checkpoint_size bytes:
+(int)width | (int)height | (int)n_pacmans | (int)n_ghosts | (unsigned)rng |
+content | dots bit plane | portals bit plane | pacmans | ghosts*/
+void board_checkpoint(const board_t* board, char* out);
+
+/*Overwrites a board instantiated from the same level with a checkpoint and
+rebuilds its render plane. Returns -1 if the checkpoint does not fit the board*/
+int board_restore(board_t* board, const char* data, size_t size);
+
 /*Unloads levels loaded by load_level_from_file*/
 void unload_level(board_t * board);
 
@@ -93,4 +146,8 @@ int load_pacman_from_file(board_t* board, const char* dir_path, const char* file
 /*Loads a level from a .lvl file in the given directory*/
 int load_level_from_file(board_t* board, const char* dir_path, const char* level_file, int accumulated_points);
 
+/*Copies a loaded level (a template, left untouched) into an unloaded board,
+giving the pacman accumulated_points. Undo with unload_level*/
+int board_instantiate(board_t* board, const board_t* level, int accumulated_points);
+
 #endif
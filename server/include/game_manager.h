@@ -4,34 +4,77 @@
 #include "pc_buffer.h"
 #include "session.h"
 #include "leaderboard.h"
+#include "scheduler.h"
+#include "reactor.h"
+#include "loader.h"
+#include "replay.h"
+#include "snapshot.h"
+#include "journal.h"
+#include "board.h"
 #include <pthread.h>
+#include <semaphore.h>
 #include <stdbool.h>
 
 // Maximum number of concurrent games
-#define MAX_CONCURRENT_GAMES 64
+#define MAX_CONCURRENT_GAMES 131072
 
-// Forward declaration
+// Maximum number of game manager threads accepting connections
+#define MAX_GAME_MANAGERS 8
+
+// Connection requests parsed per read of the registration FIFO
+#define HOST_READ_BATCH 64
+
+// How long a disconnected client's game waits for it to reconnect
+// (server argument, this is the default)
+#define PARK_GRACE_MS 30000
+
+// Park table buckets (a power of two)
+#define PARK_BUCKETS 4096
+
+// Forward declarations
 struct server_context_s;
+struct game_session_s;
+
+/**
+ * Games whose client disconnected, kept (board, level and points) until the
+ * same client id connects again or the grace period ends. Hashed by client
+ * id, so a reconnecting client finds its game in O(1).
+ * A parked game keeps its game slot and stays queued in the scheduler, due
+ * when its grace period ends.
+ */
+typedef struct {
+    pthread_mutex_t mutex;              // Protects the chains and the games' park state
+    struct game_session_s* buckets[PARK_BUCKETS];
+    int n_parked;
+    int grace_ms;                       // 0 = disconnected games end at once
+} park_table_t;
 
 /**
  * Context for a game manager thread.
- * Each manager thread handles one client session at a time.
+ * Each manager thread accepts one client at a time and hands the game to
+ * the scheduler, which plays it on its worker pool.
  */
 typedef struct {
-    int id;                             // Manager thread ID (0 to max_games-1)
+    int id;                             // Manager thread ID (0 to n_managers-1)
     pthread_t thread;                   // Thread handle
     pc_buffer_t* request_buffer;        // Shared buffer for connection requests
+    scheduler_t* scheduler;             // Runs the accepted games
+    reactor_t* reactor;                 // Reads the accepted clients' commands
+    level_loader_t* loader;             // Prefetches the games' next levels
+    replay_writer_t* replay;            // Records the games (NULL when not recording)
+    snapshot_manager_t* snapshots;      // Writes the games' quicksaves
+    park_table_t* parked;               // Games waiting for their client to reconnect
+    journal_t* journal;                 // Journals the games (NULL when not journaling)
+    sem_t* game_slots;                  // Free game slots (max_games in total)
     
-    // Level information (shared, read-only)
-    char** level_files;                 // Array of level file names
+    // Level templates (shared, read-only)
+    const board_t* levels;              // Parsed levels, in play order
     int n_levels;                       // Number of levels
-    const char* level_dir;              // Level directory path
     
     // Leaderboard reference
     leaderboard_t* leaderboard;         // Shared leaderboard for tracking scores
     
     // State
-    bool active;                        // Currently handling a session
     bool running;                       // Thread should keep running
 } game_manager_t;
 
@@ -43,10 +86,13 @@ typedef struct server_context_s {
     int max_games;
     const char* server_fifo_path;
     const char* level_dir;
+    const char* replay_dir;             // Where sessions are recorded (NULL = off)
+    const char* journal_path;           // Game journal, replayed at startup (NULL = off)
     
     // Level information
     char** level_files;
     int n_levels;
+    board_t levels[MAX_LEVELS];         // Every level parsed once at startup (templates)
     
     // Producer-consumer buffer for connection requests
     pc_buffer_t request_buffer;
@@ -55,31 +101,69 @@ typedef struct server_context_s {
     leaderboard_t leaderboard;
     
     // Game manager threads
-    game_manager_t managers[MAX_CONCURRENT_GAMES];
+    game_manager_t managers[MAX_GAME_MANAGERS];
     int n_managers;
     
+    // Worker pool that plays every game, and the slots bounding them
+    scheduler_t scheduler;
+    sem_t game_slots;
+    
+    // Input reactor for every client's request FIFO
+    reactor_t reactor;
+    
+    // Background loader for the games' next levels
+    level_loader_t level_loader;
+    
+    // Background writer for the replay files
+    replay_writer_t replay_writer;
+    
+    // Quicksave children, reaped by the host
+    snapshot_manager_t snapshots;
+    
+    // Games of disconnected clients, waiting for them to come back
+    park_table_t parked;
+    
+    // Log thread making every game's inputs durable
+    journal_t journal;
+    
     // Server state
-    bool running;
-    int server_fd;
+    volatile bool running;
+    int server_fd;                      // Registration FIFO (read end, kept open)
+    int server_keepalive_fd;            // Our own write end, so the FIFO never hits EOF
+    int host_wake_pipe[2];              // Wakes the host out of poll on shutdown
 } server_context_t;
 
 /**
  * Initialize the server context.
+ * Parses and validates every level up front; fails if any level is invalid.
+ * Every session is recorded to replay_dir, unless it is NULL. A client that
+ * disconnects can resume its game within park_grace_ms (0 = never).
+ * Games are journaled to journal_path, unless it is NULL, and the games it
+ * holds are recovered when the managers start.
  */
 int server_init(server_context_t* ctx, int max_games, const char* level_dir, 
-                const char* server_fifo_path, char** level_files, int n_levels);
+                const char* server_fifo_path, char** level_files, int n_levels,
+                const char* replay_dir, int park_grace_ms, const char* journal_path);
 
 /**
- * Start all game manager threads.
+ * Start the game scheduler, the input reactor, the level loader, the
+ * replay writer (when recording), the journal (when journaling, after
+ * parking the games recovered from it) and all game manager threads.
  */
 int server_start_managers(server_context_t* ctx);
 
 /**
- * Run the host thread (reads connection requests from FIFO).
- * This function runs in the main thread and blocks until shutdown.
+ * Run the host thread (reads connection requests from FIFO and reaps
+ * quicksave children). This function runs in the main thread and blocks
+ * until shutdown.
  */
 void server_run_host(server_context_t* ctx);
 
+/**
+ * Ask the host to stop (async-signal-safe, for the SIGINT/SIGTERM handler).
+ */
+void server_request_shutdown(server_context_t* ctx);
+
 /**
  * Shutdown the server and all threads.
  */
@@ -92,7 +176,7 @@ void server_cleanup(server_context_t* ctx);
 
 /**
  * Game manager thread function.
- * Consumes connection requests and handles client sessions.
+ * Consumes connection requests, accepts the clients and schedules their games.
  */
 void* game_manager_thread_func(void* arg);
 
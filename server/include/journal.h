@@ -0,0 +1,199 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "board.h"
+#include "leaderboard.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// =============================================================================
+// Game Journal (every game's inputs, made durable by a log thread)
+// =============================================================================
+//
+// Games append records to an in-memory queue and go on; the log thread
+// writes everything queued in one writev and makes it durable with a single
+// fdatasync (group commit), so no tick ever waits for the disk. After a
+// crash, a game is rebuilt from its last level start or checkpoint plus the
+// inputs journaled after it (ghosts move with the board's own rand_r state,
+// so replaying the inputs replays the game).
+//
+// File layout (native byte order, like the FIFO protocol), a sequence of:
+//   (uint32_t)checksum | (int)payload_size | (char)type | (char)id_length |
+//   (char[id_length])client_id | payload
+// The checksum (FNV-1a) covers everything after it; reading stops at the
+// first record that is cut short or does not match (torn by the crash).
+//
+// Payloads:
+//   JOURNAL_LEVEL       (int)level | (int)points | (unsigned)rng
+//   JOURNAL_INPUT       (int64_t)tick | (char)command
+//   JOURNAL_CHECKPOINT  (int)level | (int64_t)tick | board_checkpoint
+//   JOURNAL_END         (int)points
+//
+// At startup the journal is read, the unfinished games rebuilt, and a new
+// journal holding one checkpoint per recovered game replaces the old one.
+
+#define JOURNAL_HEADER_SIZE (sizeof(uint32_t) + sizeof(int) + 2)
+
+// After a commit the log thread lets records pile up this long before the
+// next one, so a busy server commits in large groups and games appending
+// never have to wake it (a record waits at most this plus one fdatasync)
+#define JOURNAL_COMMIT_INTERVAL_MS 5
+
+// Ticks between a game's checkpoints (bounds the inputs replayed on recovery)
+#define JOURNAL_CHECKPOINT_TICKS 256
+
+// Bytes the log thread may have queued. Past JOURNAL_CHECKPOINT_QUEUED
+// checkpoints are skipped; past JOURNAL_MAX_QUEUED a game's level and input
+// records are refused and the game is abandoned (losing an input makes the
+// rest meaningless). End records, which abandoning a game also writes, may
+// use a reserve on top
+#define JOURNAL_CHECKPOINT_QUEUED (32 * 1024 * 1024)
+#define JOURNAL_MAX_QUEUED (2 * JOURNAL_CHECKPOINT_QUEUED)
+#define JOURNAL_END_RESERVE (4 * 1024 * 1024)
+
+// Client id buckets while reading a journal (a power of two)
+#define JOURNAL_BUCKETS 4096
+
+typedef enum {
+    JOURNAL_LEVEL = 1,                  // A level started, fresh from its template
+    JOURNAL_INPUT = 2,                  // A pacman command was applied
+    JOURNAL_CHECKPOINT = 3,             // The board as it was after a tick
+    JOURNAL_END = 4                     // The game is over (not merely disconnected)
+} journal_record_type_t;
+
+/**
+ * A record waiting for the log thread.
+ */
+typedef struct journal_record_s {
+    struct journal_record_s* next;      // Queue link
+    size_t size;
+    char data[];                        // The whole record, header included
+} journal_record_t;
+
+/**
+ * The journal file and its log thread, shared by every game.
+ */
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t mutex;              // Protects the queue and the counters below
+    pthread_cond_t work;                // Signals queued records (and shutdown)
+    pthread_cond_t synced;              // Signals finished commits
+
+    journal_record_t* head;
+    journal_record_t* tail;
+    size_t queued_bytes;
+    long appended;                      // Records queued so far
+    long durable;                       // Records on disk so far
+    bool running;
+
+    const char* path;
+    char new_path[512];                 // Where the new journal is written until installed
+    int fd;                             // The new journal
+
+    atomic_long records;                // Records written
+    atomic_long commits;                // fdatasync calls (each covers a group of records)
+    atomic_long skipped;                // Checkpoints dropped (log thread too far behind)
+    atomic_long abandoned;              // Games that stopped journaling (not recoverable)
+    atomic_long bytes;                  // Bytes written
+    atomic_long errors;                 // Commits that failed (the journal is unreliable)
+} journal_t;
+
+/**
+ * A pacman command read back from the journal.
+ */
+typedef struct {
+    int64_t tick;
+    char command;
+} journal_input_t;
+
+/**
+ * What the journal says about a client's last game.
+ * The game starts from its base - the level fresh from its template
+ * (no checkpoint) or a checkpoint after base_tick - and then applies inputs.
+ */
+typedef struct journal_game_s {
+    char client_id[MAX_CLIENT_ID_LENGTH + 1];
+    bool ended;                         // The game finished, nothing to recover
+
+    int level;                          // Level being played
+    int points;                         // Points when the level started
+    unsigned int rng;                   // Random state when the level started
+    int64_t base_tick;                  // Tick of the checkpoint (0 = level start)
+    char* checkpoint;                   // board_checkpoint data (NULL = level start)
+    size_t checkpoint_size;
+
+    journal_input_t* inputs;            // Commands applied after base_tick, in order
+    size_t n_inputs;
+    size_t inputs_capacity;
+
+    struct journal_game_s* next;        // Every game read
+    struct journal_game_s* bucket_next; // Client id chain (while reading)
+} journal_game_t;
+
+/**
+ * Initialize the journal (no file is touched yet).
+ * @return  0 on success, -1 on error.
+ */
+int journal_init(journal_t* journal, const char* path);
+
+/**
+ * Read the journal left by the previous run (a missing file holds no games).
+ * @param games  Output: the last game of each client (free with journal_free_games).
+ * @return       The number of games, or -1 if the file could not be read.
+ */
+int journal_read(const char* path, journal_game_t** games);
+
+/**
+ * Release the games returned by journal_read.
+ */
+void journal_free_games(journal_game_t* games);
+
+/**
+ * Create the new journal next to the old one and start the log thread.
+ * The old journal stays in place until journal_install.
+ * @return  0 on success, -1 on error.
+ */
+int journal_start(journal_t* journal);
+
+/**
+ * Wait until everything appended so far is durable, then rename the new
+ * journal over the old one. Called once the recovered games were
+ * checkpointed into it.
+ * @return  0 on success, -1 on error (the old journal is left in place).
+ */
+int journal_install(journal_t* journal);
+
+/**
+ * Append a record (never blocks on the disk). client_id is at most
+ * MAX_CLIENT_ID_LENGTH characters.
+ * Level and input records return -1 if they were refused (no memory, or
+ * the log thread too far behind): the game's journal has a gap, so the
+ * game must be abandoned with journal_abandon. Checkpoints are skipped.
+ */
+int journal_append_level(journal_t* journal, const char* client_id, int level, int points,
+                         unsigned int rng);
+int journal_append_input(journal_t* journal, const char* client_id, int64_t tick, char command);
+void journal_append_checkpoint(journal_t* journal, const char* client_id, int level,
+                               int64_t tick, const board_t* board);
+void journal_append_end(journal_t* journal, const char* client_id, int points);
+
+/**
+ * Stop journaling a game whose record was refused: it is journaled as over,
+ * so it is not recovered after a restart (from a journal missing some of
+ * its records). The caller appends nothing more for the game.
+ */
+void journal_abandon(journal_t* journal, const char* client_id, int points);
+
+/**
+ * Commit every queued record, then stop and join the log thread.
+ */
+void journal_shutdown(journal_t* journal);
+
+/**
+ * Release journal resources.
+ */
+void journal_destroy(journal_t* journal);
+
+#endif
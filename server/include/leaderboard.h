@@ -3,37 +3,56 @@
 
 #include <pthread.h>
 #include <signal.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 
-// Maximum number of active sessions to track
-#define MAX_ACTIVE_SESSIONS 64
-
 // Maximum length of client ID
 #define MAX_CLIENT_ID_LENGTH 40
 
+// Clients listed in top5.txt
+#define LEADERBOARD_TOP_K 5
+
+// Best sessions kept sorted; more than TOP_K, so a top session leaving
+// rarely forces a rescan
+#define LEADERBOARD_TOP_CAPACITY 32
+
 /**
  * Entry for tracking active client sessions.
  */
 typedef struct {
-    char client_id[MAX_CLIENT_ID_LENGTH + 1];  // Client identifier from pipe path
-    int points;                                  // Current accumulated points
-    bool active;                                 // Is this session active?
+    char client_id[MAX_CLIENT_ID_LENGTH + 1];  // Client identifier from pipe path (set on register)
+    atomic_int points;                           // Current accumulated points (written lock-free)
+    atomic_bool in_top;                          // Listed in top (changed under top_mutex)
+    bool active;                                 // Is this session active? (under top_mutex)
 } session_entry_t;
 
 /**
  * Leaderboard structure for tracking all active sessions.
- * Protected by mutex for thread-safe access.
+ * Points are updated without a global lock: a session only takes
+ * top_mutex when it is in the top list or beats top_floor, so the top
+ * list is maintained as scores change and top 5 is read off its head.
  */
 typedef struct {
-    session_entry_t sessions[MAX_ACTIVE_SESSIONS];
-    int count;
-    pthread_mutex_t mutex;
+    session_entry_t* sessions;          // One cell per session (capacity cells)
+    int capacity;
+    
+    pthread_mutex_t slots_mutex;        // Protects the free list
+    int* free_slots;                    // Stack of unused session indices
+    int n_free;
+    
+    pthread_mutex_t top_mutex;          // Protects top, n_top, count and the active flags
+    int top[LEADERBOARD_TOP_CAPACITY];  // Best sessions, by points descending
+    int n_top;
+    atomic_int top_floor;               // No session outside top has more points than this
+    int count;                          // Active sessions
+    long rebuilds;                      // Full rescans (the top list ran short)
 } leaderboard_t;
 
 /**
  * Initialize the leaderboard.
+ * @param capacity  Maximum number of sessions registered at once.
  */
-int leaderboard_init(leaderboard_t* lb);
+int leaderboard_init(leaderboard_t* lb, int capacity);
 
 /**
  * Destroy the leaderboard.
@@ -41,7 +60,7 @@ int leaderboard_init(leaderboard_t* lb);
 void leaderboard_destroy(leaderboard_t* lb);
 
 /**
- * Register a new active session.
+ * Register a new active session (O(1), from a free list).
  * @param lb        The leaderboard.
  * @param client_id The client identifier (extracted from pipe path).
  * @return          Index of the session, or -1 on error.
@@ -49,7 +68,8 @@ void leaderboard_destroy(leaderboard_t* lb);
 int leaderboard_register(leaderboard_t* lb, const char* client_id);
 
 /**
- * Update points for a session.
+ * Update points for a session. Lock-free unless the session is (or
+ * enters) the top list.
  * @param lb        The leaderboard.
  * @param index     Session index returned by leaderboard_register.
  * @param points    New points value.
@@ -64,7 +84,8 @@ void leaderboard_update_points(leaderboard_t* lb, int index, int points);
 void leaderboard_unregister(leaderboard_t* lb, int index);
 
 /**
- * Write top 5 clients to a file.
+ * Write top 5 clients to a file. Reads the head of the top list, unless
+ * top sessions left and it must be rebuilt from every session first.
  * @param lb        The leaderboard.
  * @param filename  Output filename.
  * @return          0 on success, -1 on error.
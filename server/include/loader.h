@@ -0,0 +1,95 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include "board.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+// =============================================================================
+// Level Loader (prefetches the next level while the current one is played)
+// =============================================================================
+
+typedef enum {
+    LEVEL_JOB_IDLE,         // Not submitted (or already collected)
+    LEVEL_JOB_QUEUED,       // Waiting for the loader thread
+    LEVEL_JOB_LOADING,      // Being loaded by the loader thread
+    LEVEL_JOB_READY,        // Board loaded
+    LEVEL_JOB_FAILED        // Level could not be loaded
+} level_job_state_t;
+
+/**
+ * A request to load one level into a board.
+ * Embed it in the owning game; the loader never allocates or frees jobs.
+ */
+typedef struct level_job_s {
+    const board_t* level;               // Level template to instantiate
+    board_t* board;                     // Target (must not be loaded when submitted)
+    level_job_state_t state;            // Owned by the loader (under its mutex)
+    struct level_job_s* next;           // Queue link
+} level_job_t;
+
+/**
+ * One loader thread with a FIFO of jobs.
+ */
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t mutex;              // Protects the queue and job states
+    pthread_cond_t work;                // Signals queued jobs (and shutdown)
+    pthread_cond_t done;                // Signals finished jobs
+
+    level_job_t* head;
+    level_job_t* tail;
+    bool running;
+
+    atomic_long hits;                   // Collected jobs that were already loaded
+    atomic_long misses;                 // Collected jobs the game had to wait for
+} level_loader_t;
+
+/**
+ * Initialize the loader.
+ * @return  0 on success, -1 on error.
+ */
+int level_loader_init(level_loader_t* loader);
+
+/**
+ * Start the loader thread.
+ * @return  0 on success, -1 on error.
+ */
+int level_loader_start(level_loader_t* loader);
+
+/**
+ * Queue a level to be instantiated from its template in the background.
+ * Points are not known yet, so the board is loaded with 0; the caller sets
+ * them when it collects the job.
+ */
+void level_loader_submit(level_loader_t* loader, level_job_t* job, const board_t* level,
+                         board_t* board);
+
+/**
+ * Take the result of a submitted job, counting a hit if it was ready.
+ * A job the thread has not started yet is loaded by the caller instead;
+ * one being loaded is waited for.
+ * The job is idle afterwards.
+ * @return  0 if job->board holds the level, -1 if it failed to load.
+ */
+int level_loader_collect(level_loader_t* loader, level_job_t* job);
+
+/**
+ * Drop a job (the game ended): unqueue it, or wait for it to finish, and
+ * unload its board. Does nothing for an idle job.
+ */
+void level_loader_cancel(level_loader_t* loader, level_job_t* job);
+
+/**
+ * Stop and join the loader thread. Jobs still queued are loaded by
+ * whoever collects them.
+ */
+void level_loader_shutdown(level_loader_t* loader);
+
+/**
+ * Release loader resources.
+ */
+void level_loader_destroy(level_loader_t* loader);
+
+#endif
@@ -4,67 +4,100 @@
 #include <stddef.h>
 
 // =============================================================================
-// Low-level I/O Primitives (using unget_char - no char* next needed)
+// File Buffer (the whole file is read once, then tokenized in memory)
 // =============================================================================
 
 /**
- * "Ungets" a character by seeking back one byte.
- * Use this to return a character to the file descriptor stream.
+ * A file's contents plus a read position.
+ */
+typedef struct {
+    char *data;     // File contents, NUL-terminated
+    size_t size;    // Bytes of data (without the NUL)
+    size_t pos;     // Next byte to read
+} parse_buffer_t;
+
+/**
+ * Reads everything left in fd into a new buffer.
+ * @param buf   Output: the buffer (free with parse_buffer_free).
  * @param fd    File descriptor.
  * @return      0 on success, -1 on error.
  */
-int unget_char(int fd);
+int parse_buffer_load(parse_buffer_t *buf, int fd);
 
 /**
- * Reads a single character from the file descriptor.
- * @param fd    File descriptor.
+ * Releases a buffer filled by parse_buffer_load.
+ */
+void parse_buffer_free(parse_buffer_t *buf);
+
+// =============================================================================
+// Low-level Primitives (using unget_char - no char* next needed)
+// =============================================================================
+
+/**
+ * "Ungets" a character by moving the read position back one byte.
+ * @param buf   File buffer.
+ * @return      0 on success, -1 at the start of the buffer.
+ */
+int unget_char(parse_buffer_t *buf);
+
+/**
+ * Reads a single character from the buffer.
+ * @param buf   File buffer.
  * @param c     Output: the character read.
- * @return      1 on success, 0 on EOF, -1 on error.
+ * @return      1 on success, 0 on EOF.
  */
-int read_char(int fd, char *c);
+int read_char(parse_buffer_t *buf, char *c);
 
 /**
  * Skips whitespace characters (spaces and tabs, NOT newlines).
- * Stops at the first non-whitespace character (which is ungotten).
- * @param fd    File descriptor.
+ * Stops at the first non-whitespace character.
+ * @param buf   File buffer.
  * @return      Number of characters skipped.
  */
-int skip_spaces(int fd);
+int skip_spaces(parse_buffer_t *buf);
 
 /**
- * Reads an unsigned integer from the file descriptor.
- * Stops at the first non-digit character (which is ungotten).
- * @param fd    File descriptor.
+ * Reads an unsigned integer from the buffer.
+ * Stops at the first non-digit character.
+ * @param buf   File buffer.
  * @param value Output: the parsed integer value.
  * @return      Number of digits read, or -1 on error (no digits found).
  */
-int read_uint(int fd, int *value);
+int read_uint(parse_buffer_t *buf, int *value);
 
 /**
- * Reads a word (sequence of non-whitespace characters) from the file descriptor.
- * Stops at whitespace or newline (which is ungotten).
- * @param fd        File descriptor.
+ * Reads a word (sequence of non-whitespace characters) from the buffer.
+ * Stops at whitespace or newline.
+ * @param buf       File buffer.
  * @param buffer    Output buffer for the word.
  * @param max_len   Maximum buffer size.
  * @return          Length of the word, or -1 on error.
  */
-int read_word(int fd, char *buffer, size_t max_len);
+int read_word(parse_buffer_t *buf, char *buffer, size_t max_len);
 
 // =============================================================================
 // Line-based Utilities
 // =============================================================================
 
+/**
+ * Returns the next line in place (without the newline, not NUL-terminated).
+ * @param buf   File buffer.
+ * @param len   Output: length of the line.
+ * @return      Start of the line inside the buffer, or NULL on EOF.
+ */
+const char *next_line(parse_buffer_t *buf, size_t *len);
+
 /**
  * Skips a line (reads until newline or EOF).
- * @return 0 on success (found newline), -1 on EOF/error.
+ * @return 0 on success (found newline), -1 on EOF.
  */
-int skip_line(int fd);
+int skip_line(parse_buffer_t *buf);
 
 /**
- * Reads a line into buffer (without the newline).
- * @return Number of characters read, or -1 on error/EOF.
+ * Copies the next line into buffer (without the newline, truncated to fit).
+ * @return Number of characters copied, or -1 on EOF.
  */
-int read_line(int fd, char *buffer, size_t max_len);
+int read_line(parse_buffer_t *buf, char *buffer, size_t max_len);
 
 // =============================================================================
 // Behavior File Parsing (.m and .p files)
@@ -103,12 +136,13 @@ int parse_behavior_file(int fd, int *passo, int *row, int *col,
  * @param mon_files     Output: array of monster file names.
  * @param max_mons      Maximum number of monster files.
  * @param n_mons        Output: number of monster files.
- * @param board         Output: board matrix as string (row by row, no newlines).
- * @param max_board     Maximum size of board buffer.
- * @return              0 on success, -1 on error.
+ * @param board         Output: board matrix as string (row by row, no newlines),
+ *                      allocated to fit the file. The caller frees it.
+ * @param board_len     Output: number of board characters read.
+ * @return              0 on success, -1 on error (*board is NULL).
  */
 int parse_level_file(int fd, int *rows, int *cols, int *tempo,
                      char *pac_file, char mon_files[][256], int max_mons, int *n_mons,
-                     char *board, size_t max_board);
+                     char **board, size_t *board_len);
 
 #endif // PARSER_H
@@ -2,12 +2,16 @@
 #define PC_BUFFER_H
 
 #include "session.h"
-#include <pthread.h>
-#include <semaphore.h>
+#include <stdalign.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stddef.h>
 
-// Maximum size of the producer-consumer buffer
-#define PC_BUFFER_SIZE 16
+// Default capacity of the producer-consumer buffer (one host read batch)
+#define PC_BUFFER_SIZE 64
+
+// Keeps the producer and consumer positions on separate cache lines
+#define PC_BUFFER_CACHE_LINE 64
 
 /**
  * Connection request structure.
@@ -18,28 +22,49 @@ typedef struct {
     char notif_pipe_path[MAX_PIPE_PATH_LENGTH + 1];
 } connection_request_t;
 
+/**
+ * One ring cell. Its sequence number says whose turn it is:
+ * == position      free, the producer claiming that position may fill it
+ * == position + 1  full, the consumer claiming that position may take it
+ */
+typedef struct {
+    atomic_size_t sequence;
+    connection_request_t request;
+} pc_slot_t;
+
 /**
  * Producer-Consumer buffer for connection requests.
- * Uses semaphores for synchronization as required by the project.
+ * A bounded lock-free MPMC ring (sequence-numbered slots): producers and
+ * consumers claim positions with a CAS and never take a lock while the
+ * ring is neither full nor empty. A thread that must wait parks in a read
+ * of an eventfd, and the other side only writes a wake token when the
+ * waiter count says someone is parked.
  */
 typedef struct {
-    connection_request_t buffer[PC_BUFFER_SIZE];
-    int head;           // Index for next insert (producer)
-    int tail;           // Index for next remove (consumer)
+    pc_slot_t* slots;
+    size_t capacity;            // Power of two
+    size_t mask;                // capacity - 1
+    
+    alignas(PC_BUFFER_CACHE_LINE) atomic_size_t enqueue_pos;   // Next position to fill (producers)
+    alignas(PC_BUFFER_CACHE_LINE) atomic_size_t dequeue_pos;   // Next position to take (consumers)
     
-    pthread_mutex_t mutex;      // Protects buffer access
-    sem_t sem_empty;            // Counts empty slots
-    sem_t sem_full;             // Counts full slots
+    alignas(PC_BUFFER_CACHE_LINE) atomic_int waiting_consumers;    // Parked on not_empty_fd
+    atomic_int waiting_producers;                                  // Parked on not_full_fd
+    atomic_int not_empty_tokens;                                   // Wake tokens not yet consumed
+    atomic_int not_full_tokens;
+    int not_empty_fd;           // eventfd (semaphore mode) consumers park on
+    int not_full_fd;            // eventfd (semaphore mode) producers park on
     
-    bool shutdown;              // Signal to shutdown consumers
+    atomic_bool shutdown;       // Signal to shutdown producers and consumers
 } pc_buffer_t;
 
 /**
  * Initialize the producer-consumer buffer.
- * @param buf   Pointer to the buffer structure.
- * @return      0 on success, -1 on error.
+ * @param buf       Pointer to the buffer structure.
+ * @param capacity  Number of requests it holds (rounded up to a power of two).
+ * @return          0 on success, -1 on error.
  */
-int pc_buffer_init(pc_buffer_t* buf);
+int pc_buffer_init(pc_buffer_t* buf, size_t capacity);
 
 /**
  * Destroy the producer-consumer buffer.
@@ -56,6 +81,42 @@ void pc_buffer_destroy(pc_buffer_t* buf);
  */
 int pc_buffer_insert(pc_buffer_t* buf, const connection_request_t* request);
 
+/**
+ * Insert several connection requests (producer), in order.
+ * Blocks only while the buffer is full.
+ * @param buf       Pointer to the buffer structure.
+ * @param requests  The connection requests to insert, in order.
+ * @param count     Number of requests.
+ * @return          0 on success, -1 if shutdown.
+ */
+int pc_buffer_insert_many(pc_buffer_t* buf, const connection_request_t* requests, int count);
+
+/**
+ * Insert as many of the requests as fit without blocking (producer), in order.
+ * @param buf       Pointer to the buffer structure.
+ * @param requests  The connection requests to insert, in order.
+ * @param count     Number of requests.
+ * @return          Number inserted (0 if the buffer is full), -1 if shutdown.
+ */
+int pc_buffer_try_insert_many(pc_buffer_t* buf, const connection_request_t* requests, int count);
+
+/**
+ * Wait for room from a poll() loop rather than in insert (producer).
+ * Registers the caller as a waiting producer, so not_full_fd becomes
+ * readable once a consumer frees a slot (or at shutdown); the caller
+ * polls it and then calls pc_buffer_unwatch_not_full.
+ * @param buf   Pointer to the buffer structure.
+ * @return      true if registered, false if there is room already.
+ */
+bool pc_buffer_watch_not_full(pc_buffer_t* buf);
+
+/**
+ * End a wait begun by pc_buffer_watch_not_full, once not_full_fd polled
+ * readable: takes the wake token and unregisters the caller.
+ * @param buf   Pointer to the buffer structure.
+ */
+void pc_buffer_unwatch_not_full(pc_buffer_t* buf);
+
 /**
  * Remove a connection request from the buffer (consumer).
  * Blocks if buffer is empty.
@@ -66,7 +127,8 @@ int pc_buffer_insert(pc_buffer_t* buf, const connection_request_t* request);
 int pc_buffer_remove(pc_buffer_t* buf, connection_request_t* request);
 
 /**
- * Signal all waiting consumers to shutdown.
+ * Make every blocked and future insert/remove return -1.
+ * Async-signal-safe, so a signal handler can unblock the host.
  * @param buf   Pointer to the buffer structure.
  */
 void pc_buffer_shutdown(pc_buffer_t* buf);
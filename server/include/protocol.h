@@ -12,7 +12,11 @@ enum {
     OP_CODE_CONNECT = 1,     // Client -> Server: Request connection
     OP_CODE_DISCONNECT = 2,  // Client -> Server: Disconnect
     OP_CODE_PLAY = 3,        // Client -> Server: Send command (W/A/S/D)
-    OP_CODE_BOARD = 4,       // Server -> Client: Board update
+    OP_CODE_BOARD = 4,       // Server -> Client: Board update (full keyframe)
+    OP_CODE_BOARD_DELTA = 5, // Server -> Client: Board update (changed cells only)
+    OP_CODE_VIEWPORT = 6,    // Client -> Server: Announce visible rows and columns
+    OP_CODE_BOARD_WINDOW = 7,// Server -> Client: Board update (viewport around pacman)
+    OP_CODE_FRAME_FORMAT = 8,// Client -> Server: Choose how board cells are encoded
 };
 
 // =============================================================================
@@ -32,9 +36,55 @@ enum {
 // Format: (char)OP_CODE | (char)command
 #define PLAY_MSG_SIZE 2
 
+// Frame format message (client -> server via request FIFO)
+// Format: (char)OP_CODE | (char)format
+// Clients that can unpack cells ask for BOARD_FORMAT_PACKED once connected;
+// until then (and for older clients) every cell is one glyph byte.
+#define FRAME_FORMAT_MSG_SIZE 2
+#define BOARD_FORMAT_GLYPHS 0
+#define BOARD_FORMAT_PACKED 1
+
+// Viewport message (client -> server via request FIFO)
+// Format: (char)OP_CODE | (int)rows | (int)cols
+// Sent on connect and whenever the terminal is resized; 0 rows or columns
+// asks for the whole board again.
+#define VIEWPORT_MSG_SIZE (1 + 2 * sizeof(int))
+
 // Board update header (server -> client via notification FIFO)
-// Format: (char)OP_CODE | (int)width | (int)height | (int)tempo | 
-//         (int)victory | (int)game_over | (int)accumulated_points
-#define BOARD_HEADER_SIZE (1 + 6 * sizeof(int))
+// Format: (char)OP_CODE | (int)frame_length | (int)width | (int)height |
+//         (int)tempo | (int)victory | (int)game_over | (int)accumulated_points
+// frame_length counts every byte after itself (fields and body), so a reader
+// knows how much to wait for before parsing, and can skip unknown frames.
+#define BOARD_LENGTH_SIZE sizeof(int)
+#define BOARD_FIELDS_SIZE (6 * sizeof(int))
+#define BOARD_HEADER_SIZE (1 + BOARD_LENGTH_SIZE + BOARD_FIELDS_SIZE)
+
+// Largest board a frame may carry (width * height, e.g. 4096x4096).
+// Keyframes this big span many pipe buffers; readers must loop until complete.
+#define MAX_BOARD_CELLS (1 << 24)
+
+// Board window message (server -> client via notification FIFO)
+// Format: (board header with OP_CODE_BOARD_WINDOW, width and height being the
+//         window's) | (int)origin_x | (int)origin_y | (char[width*height])cells
+// The window is the client's viewport clamped to the board and centred on
+// pacman as far as the board edges allow; origin is its top-left cell.
+#define BOARD_WINDOW_ORIGIN_SIZE (2 * sizeof(int))
+
+// Packed cells: OP_CODE_BOARD and OP_CODE_BOARD_WINDOW frames with
+// BOARD_PACKED_FLAG set in the op code carry cells as 3-bit codes (the index
+// of the glyph in BOARD_PACKED_GLYPHS) instead of glyph bytes. Each group of
+// 8 cells is one 24-bit little-endian value, cell i in bits 3i..3i+2; the
+// last group is padded with code 0. Deltas always carry glyph bytes.
+#define BOARD_PACKED_FLAG 0x40
+#define BOARD_PACKED_GLYPHS " #o@CM"
+#define BOARD_PACKED_SIZE(n_cells) ((((size_t)(n_cells) + 7) / 8) * 3)
+
+// Board delta message (server -> client via notification FIFO)
+// Format: (board header with OP_CODE_BOARD_DELTA) | (int)n_changes |
+//         n_changes * ((int)cell_index | (char)glyph)
+// Cells are relative to the last frame delivered to the client; the FIFO is
+// reliable and ordered, so a complete write counts as acknowledged.
+#define BOARD_DELTA_COUNT_SIZE sizeof(int)
+#define BOARD_DELTA_ENTRY_SIZE (sizeof(int) + 1)
 
 #endif
@@ -0,0 +1,85 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include "session.h"
+#include "scheduler.h"
+#include <pthread.h>
+#include <stdbool.h>
+
+// Events handled per epoll_wait call
+#define REACTOR_EVENT_BATCH 256
+
+// =============================================================================
+// Input Reactor (one thread reading every client's request FIFO)
+// =============================================================================
+
+/**
+ * Registration of one session.
+ * The generation changes on every reuse, so events that were already
+ * returned by epoll for a removed session are recognised and ignored.
+ */
+typedef struct {
+    client_session_t* session;          // NULL if the slot is free
+    sched_task_t* task;                 // Game to wake when the client leaves
+    unsigned int generation;
+} reactor_slot_t;
+
+/**
+ * Epoll reactor: parses client messages into the sessions' input queues
+ * as they arrive and wakes a game as soon as its client quits or hangs up.
+ */
+typedef struct {
+    int epoll_fd;
+    int wake_fd;                        // eventfd that stops the reactor thread
+    pthread_t thread;
+    scheduler_t* scheduler;             // Runs the games that are woken
+
+    reactor_slot_t* slots;
+    int* free_slots;                    // Stack of unused slot indices
+    int n_free;
+    int capacity;
+
+    pthread_mutex_t mutex;              // Protects the slots while an event is handled
+    volatile bool running;
+} reactor_t;
+
+/**
+ * Initialize the reactor.
+ * @param reactor    The reactor.
+ * @param scheduler  Scheduler running the registered games.
+ * @param capacity   Maximum number of registered sessions.
+ * @return           0 on success, -1 on error.
+ */
+int reactor_init(reactor_t* reactor, scheduler_t* scheduler, int capacity);
+
+/**
+ * Start the reactor thread.
+ * @return  0 on success, -1 on error.
+ */
+int reactor_start(reactor_t* reactor);
+
+/**
+ * Register a session's request FIFO (must already be non-blocking).
+ * @param reactor   The reactor.
+ * @param session   Connected session; its input queue receives the commands.
+ * @param task      Game task woken when the client's input ends.
+ * @return          0 on success, -1 on error.
+ */
+int reactor_add(reactor_t* reactor, client_session_t* session, sched_task_t* task);
+
+/**
+ * Unregister a session. Once this returns the reactor no longer touches it.
+ */
+void reactor_remove(reactor_t* reactor, client_session_t* session);
+
+/**
+ * Stop and join the reactor thread.
+ */
+void reactor_shutdown(reactor_t* reactor);
+
+/**
+ * Release reactor resources.
+ */
+void reactor_destroy(reactor_t* reactor);
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "board.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+// =============================================================================
+// Replay Recording (one file per session, written in the background)
+// =============================================================================
+//
+// File layout (native byte order, like the FIFO protocol):
+//   Header:  (char[8])REPLAY_MAGIC | (int)keyframe_interval
+//   Records: (int)elapsed_ms | board frame, exactly as a client with packed
+//            cells and no viewport receives it (OP_CODE_BOARD with
+//            BOARD_PACKED_FLAG, or OP_CODE_BOARD_DELTA)
+//   Trailer: (int64_t[n_blocks])offsets | (int64_t)n_frames |
+//            (int64_t)n_blocks | (char[8])REPLAY_INDEX_MAGIC
+//
+// Records are numbered by published frame. Frame k * keyframe_interval is
+// always a keyframe, and offsets[k] is its file offset, so frame n is rebuilt
+// from offsets[n / keyframe_interval] plus fewer than keyframe_interval
+// records. Levels starting mid-block add extra keyframes, which are not
+// indexed. A file without a trailer (server killed) is still a valid stream.
+
+#define REPLAY_MAGIC "PACREPL1"
+#define REPLAY_INDEX_MAGIC "PACRIDX1"
+#define REPLAY_MAGIC_SIZE 8
+#define REPLAY_HEADER_SIZE (REPLAY_MAGIC_SIZE + sizeof(int))
+#define REPLAY_TRAILER_SIZE (2 * sizeof(int64_t) + REPLAY_MAGIC_SIZE)
+
+// Frames between indexed keyframes
+#define REPLAY_KEYFRAME_INTERVAL 64
+
+// Records are buffered per session and handed to the writer in chunks this big
+#define REPLAY_CHUNK_SIZE (64 * 1024)
+
+// Bytes the writer may have queued; past that, recordings are dropped
+// rather than making games wait for the disk
+#define REPLAY_MAX_QUEUED (32 * 1024 * 1024)
+
+/**
+ * A replay file, shared by its recorder and the chunks queued for it.
+ * Freed by the writer once the closing chunk is written.
+ */
+typedef struct {
+    int fd;
+    atomic_bool failed;                 // A write failed: later chunks are skipped (set by the writer)
+} replay_output_t;
+
+/**
+ * Bytes for the writer thread to append to a replay file.
+ */
+typedef struct replay_chunk_s {
+    replay_output_t* file;
+    char* data;                         // Owned by the chunk (may be NULL)
+    size_t size;
+    bool close_fd;                      // Last chunk of the file
+    struct replay_chunk_s* next;        // Queue link
+} replay_chunk_t;
+
+/**
+ * One writer thread with a FIFO of chunks, shared by every recorder.
+ */
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t mutex;              // Protects the queue
+    pthread_cond_t work;                // Signals queued chunks (and shutdown)
+
+    replay_chunk_t* head;
+    replay_chunk_t* tail;
+    size_t queued_bytes;
+    bool running;
+
+    const char* dir;                    // Where replay files are created
+    atomic_int next_file;               // Makes file names unique
+    atomic_long files;                  // Replays started
+    atomic_long dropped;                // Replays cut short (writer too far behind, or a write failed)
+    atomic_long bytes;                  // Bytes written
+} replay_writer_t;
+
+/**
+ * Records one session's frames. Only the thread running the session's game
+ * touches it, so it needs no locking.
+ */
+typedef struct {
+    replay_writer_t* writer;
+    replay_output_t* file;
+    bool failed;                        // Recording stopped, the file is truncated
+
+    char* chunk;                        // Records not handed to the writer yet
+    size_t chunk_size;
+    size_t chunk_capacity;
+    int64_t offset;                     // File offset of the end of chunk
+
+    int64_t* index;                     // Offsets of the indexed keyframes
+    size_t n_index;
+    size_t index_capacity;
+
+    long n_frames;
+    bool force_keyframe;                // Next frame starts a new level
+    struct timespec start;
+} replay_recorder_t;
+
+/**
+ * Initialize the writer.
+ * @param dir  Directory for the replay files (must exist).
+ * @return     0 on success, -1 on error.
+ */
+int replay_writer_init(replay_writer_t* writer, const char* dir);
+
+/**
+ * Start the writer thread.
+ * @return  0 on success, -1 on error.
+ */
+int replay_writer_start(replay_writer_t* writer);
+
+/**
+ * Write out every queued chunk, then stop and join the writer thread.
+ */
+void replay_writer_shutdown(replay_writer_t* writer);
+
+/**
+ * Release writer resources.
+ */
+void replay_writer_destroy(replay_writer_t* writer);
+
+/**
+ * Create a replay file for a new session.
+ * @return  The recorder, or NULL if the file could not be created.
+ */
+replay_recorder_t* replay_recorder_open(replay_writer_t* writer, const char* client_id);
+
+/**
+ * Make the next frame a keyframe (a new level was loaded).
+ */
+void replay_recorder_new_level(replay_recorder_t* rec);
+
+/**
+ * Append the frame about to be published: a keyframe at block boundaries
+ * and level starts, otherwise the board's dirty cells.
+ * Only copies into memory; full chunks are handed to the writer.
+ */
+void replay_record_frame(replay_recorder_t* rec, const board_t* board, int victory,
+                         int game_over, int points);
+
+/**
+ * Append the index, hand the rest to the writer (which closes the file)
+ * and free the recorder.
+ */
+void replay_recorder_close(replay_recorder_t* rec);
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <time.h>
+
+// Upper bound on worker threads (the pool is sized to the core count)
+#define SCHED_MAX_WORKERS 64
+
+// =============================================================================
+// Deadline Scheduler (M games on N worker threads)
+// =============================================================================
+
+typedef enum {
+    SCHED_TASK_CONTINUE,    // Run the task again at the deadline it returned
+    SCHED_TASK_DONE         // Task finished; the scheduler forgets it
+} sched_result_t;
+
+typedef struct sched_task_s sched_task_t;
+
+/**
+ * A unit of periodic work (one game).
+ * Embed it in the owning structure; the scheduler never allocates or frees tasks.
+ * A task is run by at most one worker at a time, so its owner needs no extra
+ * locking against itself.
+ */
+struct sched_task_s {
+    /**
+     * Runs the task. On SCHED_TASK_CONTINUE, next_deadline must hold the
+     * absolute CLOCK_MONOTONIC time of the next run.
+     */
+    sched_result_t (*run)(sched_task_t* task, struct timespec* next_deadline);
+
+    /**
+     * Called instead of run for tasks still queued at shutdown.
+     */
+    void (*cancel)(sched_task_t* task);
+
+    struct timespec deadline;   // Next run time (owned by the scheduler)
+    int heap_index;             // Position in the heap, -1 while running (owned by the scheduler)
+};
+
+/**
+ * Worker pool plus a min-heap of tasks keyed by deadline.
+ * Idle workers sleep on the condition variable until the earliest deadline.
+ */
+typedef struct {
+    pthread_t workers[SCHED_MAX_WORKERS];
+    int n_workers;
+
+    sched_task_t** heap;        // Queued tasks, heap[0] has the earliest deadline
+    int n_tasks;
+    int capacity;
+
+    pthread_mutex_t mutex;      // Protects the heap
+    pthread_cond_t cond;        // Signals heap changes (CLOCK_MONOTONIC)
+
+    bool running;
+} scheduler_t;
+
+/**
+ * Initialize the scheduler.
+ * @param sched      The scheduler.
+ * @param n_workers  Worker threads to run (0 = one per online core).
+ * @param capacity   Maximum number of tasks queued at once.
+ * @return           0 on success, -1 on error.
+ */
+int scheduler_init(scheduler_t* sched, int n_workers, int capacity);
+
+/**
+ * Start the worker threads.
+ * @return  0 on success, -1 on error.
+ */
+int scheduler_start(scheduler_t* sched);
+
+/**
+ * Queue a task to run at the given deadline.
+ * @param sched     The scheduler.
+ * @param task      Task to run.
+ * @param deadline  Absolute CLOCK_MONOTONIC time, or NULL to run as soon as possible.
+ * @return          0 on success, -1 if the scheduler is full or stopped.
+ */
+int scheduler_submit(scheduler_t* sched, sched_task_t* task, const struct timespec* deadline);
+
+/**
+ * Move a queued task's deadline to now, so a worker runs it right away.
+ * Does nothing if the task is running at the moment (it reads its state
+ * after the step) or is not queued.
+ */
+void scheduler_wake(scheduler_t* sched, sched_task_t* task);
+
+/**
+ * Stop and join the workers, then cancel every task still queued.
+ */
+void scheduler_shutdown(scheduler_t* sched);
+
+/**
+ * Release scheduler resources.
+ */
+void scheduler_destroy(scheduler_t* sched);
+
+#endif
@@ -1,14 +1,36 @@
 #ifndef SESSION_H
 #define SESSION_H
 
+#include <pthread.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "protocol.h"
 #include "board.h"
+#include "replay.h"
 
 // =============================================================================
 // Client Session Management (Exercise 1)
 // =============================================================================
 
+// Send a full board (keyframe) at least every N frames so clients can resync
+#define BOARD_KEYFRAME_INTERVAL 50
+
+// Most client messages parsed from one read of the request FIFO
+#define CLIENT_COMMAND_BATCH 64
+
+// Pacman commands received but not yet applied by the game
+#define SESSION_INPUT_QUEUE_SIZE 16
+
+// Frame bytes a client may leave unread (on top of two full boards) before
+// it is treated as gone; the notification FIFO is non-blocking, so what it
+// does not take is queued in the session instead of stalling the worker
+#define SESSION_OUTPUT_BACKLOG_MAX (1 << 20)
+
+// Input status of a session (see session_read_input)
+#define SESSION_INPUT_OPEN 0            // Client connected
+#define SESSION_INPUT_CLOSED -1         // Client disconnected or sent garbage
+#define SESSION_INPUT_QUIT -2           // Client quit ('Q' or disconnect request)
+
 // Represents a connected client session
 typedef struct {
     int client_id;                              // Client identifier (from connection)
@@ -18,6 +40,43 @@ typedef struct {
     char notif_pipe_path[MAX_PIPE_PATH_LENGTH + 1];
     bool active;                                // Session is active
     int accumulated_points;                     // Points accumulated in this session
+    
+    // Delta body buffer, sized once per level by session_prepare_frames
+    // so that sending a frame never allocates
+    char* frame_body;                           // Serialized delta entries, window or packed cells
+    size_t frame_capacity;                      // Cells the buffer can describe
+    
+    // Delta encoding state (last frame delivered to the client)
+    int last_frame_width;                       // 0 = no valid base, send a keyframe
+    int last_frame_height;
+    int frames_since_keyframe;                  // Frames sent since the last full board
+    
+    // Frame bytes the notification FIFO did not take yet, sent before
+    // anything else (bytes output_offset to output_size are pending)
+    char* output;
+    size_t output_offset;
+    size_t output_size;
+    size_t output_capacity;
+    
+    // Replay of every published frame, NULL unless recording is enabled
+    replay_recorder_t* replay;
+    
+    // Client input, filled by the input reactor and consumed by the game tick
+    // (protected by input_mutex)
+    pthread_mutex_t input_mutex;
+    char input_queue[SESSION_INPUT_QUEUE_SIZE]; // Ring of pending movement commands
+    int input_head;                             // Index of the oldest pending command
+    int input_count;                            // Number of pending commands
+    int input_status;                           // SESSION_INPUT_* 
+    int view_rows;                              // Client viewport, 0 = whole board
+    int view_cols;
+    bool view_changed;                          // Viewport changed since the last frame
+    int frame_format;                           // BOARD_FORMAT_* asked for by the client
+    
+    // Start of a message cut off by the last read (reactor only)
+    char input_partial[VIEWPORT_MSG_SIZE];
+    size_t input_partial_len;
+    int reactor_slot;                           // Input reactor registration, -1 if none
 } client_session_t;
 
 // =============================================================================
@@ -30,10 +89,18 @@ typedef struct {
 void init_session(client_session_t* session);
 
 /**
- * Cleans up a client session, closing FIFOs.
+ * Cleans up a client session, closing FIFOs and finishing its replay.
  */
 void cleanup_session(client_session_t* session);
 
+/**
+ * Detaches a session from a client that went away: closes its FIFOs and
+ * forgets the client's input and viewport, keeping the frame buffers, the
+ * replay and the points for the client's return (accept_connection again).
+ * The session must not be registered with the input reactor.
+ */
+void session_detach(client_session_t* session);
+
 /**
  * Reads a connection request from the server's registration FIFO.
  * 
@@ -45,9 +112,12 @@ int read_connect_request(int server_fd, client_session_t* session);
 
 /**
  * Opens the client's FIFOs and sends connection response.
+ * Never blocks: until the client has opened its notification FIFO for
+ * reading nothing is opened, and the caller tries again later.
  * 
  * @param session       Session with pipe paths to open
- * @return              0 on success, -1 on error
+ * @return              0 on success, 1 if the client has not opened its
+ *                      notification FIFO yet, -1 on error
  */
 int accept_connection(client_session_t* session);
 
@@ -60,8 +130,35 @@ int accept_connection(client_session_t* session);
  */
 int send_connect_response(client_session_t* session, char result);
 
+/**
+ * Prepares the session to stream a freshly loaded board: makes sure the
+ * delta buffer can hold it and forces the next frame (and replay record)
+ * to be a keyframe.
+ * Called once per level load; the buffer is reused across levels and only
+ * grows when a bigger board is loaded.
+ * 
+ * @param session       Session to prepare
+ * @param board         Board that will be sent
+ * @return              0 on success, -1 on allocation failure
+ */
+int session_prepare_frames(client_session_t* session, board_t* board);
+
 /**
  * Sends board update to the client.
+ * Sends only the cells in the board's dirty list (OP_CODE_BOARD_DELTA), or the
+ * whole render plane (OP_CODE_BOARD) on the first frame of a level, every
+ * BOARD_KEYFRAME_INTERVAL frames, or when a delta would not be smaller.
+ * If the client announced a viewport smaller than the board, only the
+ * window around pacman is sent (OP_CODE_BOARD_WINDOW), so the frame size
+ * follows the viewport rather than the map. Keyframes and windows are
+ * packed 3 bits per cell if the client asked for BOARD_FORMAT_PACKED.
+ * Header and body go out in a single writev. The FIFO is never waited on:
+ * whatever it does not take is queued and sent by later calls (or
+ * session_flush_output) before anything newer, and a client that falls
+ * more than SESSION_OUTPUT_BACKLOG_MAX bytes behind is treated as gone.
+ * The frame is recorded in the session's replay first, if any. On success
+ * (frame sent or queued) the board's dirty list is cleared, so the caller
+ * must hold the board exclusively.
  * 
  * @param session       Active session
  * @param board         Game board to send
@@ -72,12 +169,44 @@ int send_connect_response(client_session_t* session, char result);
 int send_board_update(client_session_t* session, board_t* board, int victory, int game_over);
 
 /**
- * Reads a command from the client.
+ * Sends what earlier frames left queued, as far as the notification FIFO
+ * takes it without blocking.
+ * 
+ * @param session       Active session
+ * @return              0 if nothing is left queued, 1 if some still is,
+ *                      -1 on error (client disconnected)
+ */
+int session_flush_output(client_session_t* session);
+
+/**
+ * Whether the client announced a new viewport since the last frame was
+ * sent, so the game should send one even if the board did not change.
+ */
+bool session_viewport_changed(client_session_t* session);
+
+/**
+ * Reads every message the client has sent so far, without blocking.
+ * The request FIFO is non-blocking; pending messages are fetched in large
+ * reads and parsed in bulk. Movement commands (W/A/S/D) are queued for the
+ * game (dropped if the queue is full), viewport and frame format messages
+ * change what send_board_update sends, 'Q' or a disconnect request sets
+ * SESSION_INPUT_QUIT, and end of file or a malformed message sets
+ * SESSION_INPUT_CLOSED.
+ * 
+ * @param session       Active session
+ * @return              Current input status (SESSION_INPUT_*); once it is not
+ *                      SESSION_INPUT_OPEN the FIFO needs no more reads
+ */
+int session_read_input(client_session_t* session);
+
+/**
+ * Takes the oldest queued movement command.
  * 
  * @param session       Active session
- * @param command       Output: command character (W/A/S/D/Q)
- * @return              0 on success, -1 on error/disconnect, -2 on disconnect request
+ * @param command       Output: command character (W/A/S/D)
+ * @return              1 if a command was taken, 0 if none is queued,
+ *                      or the session's closed/quit status (always reported first)
  */
-int read_client_command(client_session_t* session, char* command);
+int session_pop_command(client_session_t* session, char* command);
 
 #endif
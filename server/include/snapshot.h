@@ -0,0 +1,83 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "board.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+// =============================================================================
+// Quicksave Snapshots (a forked child writes the board, the game goes on)
+// =============================================================================
+//
+// 'G' forks the server. The child sees the board frozen at the fork
+// (copy-on-write), writes it to the session's snapshot file and exits; the
+// parent's game keeps ticking. Children are reaped by the host through a
+// signalfd for SIGCHLD, so nobody ever waits for one while playing.
+//
+// File layout (native byte order, like the FIFO protocol):
+//   (char[8])SNAPSHOT_MAGIC | (int)width | (int)height | (int)tempo |
+//   (int)n_pacmans | (int)n_ghosts | (char[256])level_name |
+//   (char[width * height])content | dots bit plane | portals bit plane |
+//   (pacman_t[n_pacmans])pacmans | (ghost_t[n_ghosts])ghosts
+// Each session has a single snapshot: a new quicksave replaces the last one
+// (written to a temporary file and renamed over it).
+
+#define SNAPSHOT_MAGIC "PACSAVE1"
+#define SNAPSHOT_MAGIC_SIZE 8
+
+// Quicksave children running at once (server-wide); more quicksaves are skipped
+#define SNAPSHOT_MAX_CHILDREN 4
+
+// Snapshot file name for a client id (in the server's working directory)
+#define SNAPSHOT_PATH_FORMAT "quicksave-%s.dat"
+#define SNAPSHOT_PATH_LENGTH 128
+
+/**
+ * The quicksave children in flight, shared by every game.
+ */
+typedef struct {
+    pthread_mutex_t mutex;              // Protects children (held across fork)
+    pid_t children[SNAPSHOT_MAX_CHILDREN]; // Running children (0 = free)
+    int signal_fd;                      // SIGCHLD notifications, polled by the host
+
+    atomic_long saved;                  // Snapshots written
+    atomic_long skipped;                // Quicksaves dropped (too many children)
+    atomic_long failed;                 // Children that could not write
+} snapshot_manager_t;
+
+/**
+ * Initialize the manager. Blocks SIGCHLD in the calling thread, so it must
+ * run before any other thread is created (they inherit the mask and the
+ * signal then only reaches the signalfd).
+ * @return  0 on success, -1 on error.
+ */
+int snapshot_manager_init(snapshot_manager_t* snapshots);
+
+/**
+ * Fork a child that writes the board to path.
+ * Does nothing if the child of a previous quicksave (previous_pid) is still
+ * running or too many children are.
+ * @return  The child's pid, or -1 if no snapshot was started.
+ */
+pid_t snapshot_save(snapshot_manager_t* snapshots, const board_t* board, const char* path,
+                    pid_t previous_pid);
+
+/**
+ * Reap the children that exited (never blocks). Called by the host when
+ * signal_fd is readable.
+ */
+void snapshot_reap(snapshot_manager_t* snapshots);
+
+/**
+ * Wait for every child still running. No quicksave may start anymore.
+ */
+void snapshot_manager_shutdown(snapshot_manager_t* snapshots);
+
+/**
+ * Release manager resources.
+ */
+void snapshot_manager_destroy(snapshot_manager_t* snapshots);
+
+#endif
@@ -3,9 +3,16 @@
 
 #include <pthread.h>
 #include <stdbool.h>
+#include <time.h>
 #include "board.h"
 #include "session.h"
 #include "leaderboard.h"
+#include "snapshot.h"
+#include "journal.h"
+
+// Idle games still get a (cheap, empty delta) frame this often so that a
+// vanished client is detected even when nothing moves on the board
+#define SESSION_HEARTBEAT_MS 1000
 
 // =============================================================================
 // Game State for Thread Synchronization
@@ -21,59 +28,93 @@ typedef enum {
     GAME_CLIENT_DISCONNECTED  // Client closed connection
 } game_state_t;
 
-// Thread-safe game context
+// What a simulated tick did to the level
+typedef enum {
+    TICK_PLAYING,                       // The level goes on
+    TICK_PORTAL,                        // Pacman reached the portal
+    TICK_PACMAN_DEAD                    // Pacman died
+} tick_result_t;
+
+// Game context (engine runtime) for one client's game
+// It lives as long as the session; each level only swaps in its board
+// (game_set_level). The game runs as a scheduler task: each tick a worker
+// applies one of the commands the input reactor queued on the session,
+// simulates one step and publishes a frame. A task is never run by
+// two workers at once, so the board has a single writer at any time.
 typedef struct {
-    board_t* board;                     // Shared game board
+    board_t* board;                     // Current level's board
     client_session_t* session;          // Client session (for network communication)
-    
+
     // Game state
     game_state_t state;                 // Current game state
     bool pacman_dead;                   // Flag: pacman died
-    bool board_changed;                 // Flag: board needs redraw
-    
+    bool last_level;                    // Flag: finishing this level wins the game
+    int level;                          // Index of the level being played
+
+    // Tick engine
+    int tempo;                          // Tick period in ms
+    long tick;                          // Ticks simulated so far
+    struct timespec next_tick;          // Absolute CLOCK_MONOTONIC deadline of the next tick
+    struct timespec last_frame_time;    // When the last frame was published (heartbeat)
+
     // Leaderboard tracking (for real-time updates)
     leaderboard_t* leaderboard;         // Pointer to global leaderboard
     int leaderboard_index;              // Index of this session in leaderboard
-    
-    // Synchronization primitives
-    pthread_rwlock_t board_lock;        // RW lock for board access (maximize parallelism)
-    pthread_mutex_t state_mutex;        // Mutex for game state changes
-    pthread_cond_t display_cond;        // Signal session thread to send update
-    pthread_cond_t game_cond;           // Signal game state changes
-    
-    // Thread handles
-    pthread_t session_thread;           // Thread that sends board updates to client
-    pthread_t pacman_thread;            // Thread that processes pacman commands
-    pthread_t* ghost_threads;           // Array of ghost thread handles
-    int n_ghost_threads;
-    
-    // Thread control
-    volatile bool threads_running;      // Flag to signal threads to stop
-    
+
+    // Quicksaves ('G')
+    snapshot_manager_t* snapshots;      // Forks the children that write them (NULL = off)
+    char quicksave_path[SNAPSHOT_PATH_LENGTH]; // This session's snapshot file
+    pid_t quicksave_pid;                // Child of the last quicksave (-1 = none)
+
+    // Journal (inputs and checkpoints, for recovery after a crash)
+    journal_t* journal;                 // NULL = not journaled
+    char client_id[MAX_CLIENT_ID_LENGTH + 1];
+
 } game_context_t;
 
 // =============================================================================
-// Thread Functions
+// Game Engine Functions
 // =============================================================================
 
-// Initialize/cleanup game context
-int init_game_context(game_context_t* ctx, board_t* board, client_session_t* session);
+// Initialize/cleanup game context (once per session)
+void init_game_context(game_context_t* ctx, client_session_t* session);
 void cleanup_game_context(game_context_t* ctx);
 
+// Swaps in the next level's board and resets the per-level state
+// (call game_begin afterwards)
+void game_set_level(game_context_t* ctx, board_t* board, int level, bool last_level);
+
+// Journal the game's inputs and checkpoints under the client's id
+void set_game_journal(game_context_t* ctx, journal_t* journal, const char* client_id);
+
 // Set leaderboard for real-time updates
 void set_game_leaderboard(game_context_t* ctx, leaderboard_t* lb, int lb_index);
 
-// Start/stop game threads
-int start_game_threads(game_context_t* ctx);
-void stop_game_threads(game_context_t* ctx);
+// Enable quicksaves, written to the client's snapshot file
+void set_game_snapshots(game_context_t* ctx, snapshot_manager_t* snapshots, const char* client_id);
+
+// Starts the level: sends the first frame and schedules the first tick
+// (ctx->next_tick). Returns -1 if the client is gone.
+int game_begin(game_context_t* ctx);
+
+// Runs one scheduler step: simulates a tick and publishes a frame. Returns the state afterwards; while
+// it is GAME_RUNNING the caller must call again at ctx->next_tick. For any
+// other state the final frame has already been sent.
+game_state_t game_step(game_context_t* ctx);
+
+// Simulates one tick: applies one queued pacman command (a move, a quicksave,
+// or the client's quit/disconnect), steps every ghost in order and resolves
+// collisions.
+// Must only be called by the engine.
+void game_tick(game_context_t* ctx);
 
-// Thread entry points
-void* session_thread_func(void* arg);   // Sends board updates to client
-void* pacman_thread_func(void* arg);    // Reads commands from client FIFO
-void* ghost_thread_func(void* arg);     // Controls ghost movement
+// The board part of a tick: moves pacman (command 0 = no move), then every
+// ghost in order. Depends on nothing but the board, so journal recovery
+// replays ticks with it.
+tick_result_t simulate_tick(board_t* board, char command);
 
-// Thread-safe board operations
-void request_display_refresh(game_context_t* ctx);
+// Game state accessors (engine only; the manager learns of a state change
+// from game_step's return value, in the same run)
 void set_game_state(game_context_t* ctx, game_state_t state);
 game_state_t get_game_state(game_context_t* ctx);
 
@@ -1,7 +1,10 @@
 #include "board.h"
 #include "display.h"
 #include "parser.h"
+#include "protocol.h"
 #include <stdlib.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
@@ -9,6 +12,23 @@
 #include <stdarg.h>
 #include <fcntl.h>
 
+// Boards seeded so far (keeps seeds apart when the clock reads the same)
+static atomic_uint boards_seeded = 0;
+
+/**
+ * A seed for a new board's rng. Boards are created from several threads at
+ * once, so rand() is out: a per-board counter is mixed with the clock.
+ */
+static unsigned int board_seed(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t x = ((uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec) ^
+                 ((uint64_t)atomic_fetch_add(&boards_seeded, 1) * 0x9E3779B97F4A7C15ULL);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return (unsigned int)(x ^ (x >> 31));
+}
+
 // Helper private function to find and kill pacman at specific position
 static int find_and_kill_pacman(board_t* board, int new_x, int new_y) {
     for (int p = 0; p < board->n_pacmans; p++) {
@@ -27,6 +47,93 @@ static inline int get_board_index(board_t* board, int x, int y) {
     return y * board->width + x;
 }
 
+// Helper private function mapping a cell to the glyph shown by clients
+static char cell_glyph(board_t* board, int idx) {
+    char content = board->content[idx];
+    if (content == 'W') return '#';
+    if (content == 'P') return 'C';
+    if (content == 'M') return 'M';
+    if (board_has_portal(board, idx)) return '@';
+    if (board_has_dot(board, idx)) return 'o';
+    return ' ';
+}
+
+// Helper private function to change a cell and keep the render plane in sync
+static void set_cell_content(board_t* board, int idx, char content) {
+    board->content[idx] = content;
+
+    char glyph = cell_glyph(board, idx);
+    if (board->render[idx] != glyph) {
+        board->render[idx] = glyph;
+        if (!board_bit(board->dirty_mark, idx)) {
+            board_set_bit(board->dirty_mark, idx, true);
+            if (board->n_dirty < board->dirty_capacity) {
+                board->dirty[board->n_dirty++] = idx;
+            } else {
+                board->dirty_overflow = true;
+            }
+        }
+    }
+}
+
+// Helper private function to build the whole render plane after loading
+static void render_board(board_t* board) {
+    int n_cells = board->width * board->height;
+    for (int idx = 0; idx < n_cells; idx++) {
+        board->render[idx] = cell_glyph(board, idx);
+    }
+    memset(board->dirty_mark, 0, BOARD_BITPLANE_SIZE(n_cells));
+    board->n_dirty = 0;
+    board->dirty_overflow = false;
+}
+
+// 3-bit code of each glyph: its index in BOARD_PACKED_GLYPHS (others are 0)
+static const unsigned char packed_codes[256] = {
+    [' '] = 0, ['#'] = 1, ['o'] = 2, ['@'] = 3, ['C'] = 4, ['M'] = 5
+};
+
+// Packed cells: groups are independent and fixed-size (the loop vectorizes
+// well), and a group is read before it is written, so packing works in place
+size_t board_pack_glyphs(const char* glyphs, size_t n_cells, unsigned char* out) {
+    const unsigned char* in = (const unsigned char*)glyphs;
+    size_t groups = n_cells / 8;
+    
+    for (size_t g = 0; g < groups; g++) {
+        uint32_t bits = 0;
+        for (int i = 0; i < 8; i++) {
+            bits |= (uint32_t)packed_codes[in[g * 8 + i]] << (3 * i);
+        }
+        out[g * 3] = (unsigned char)bits;
+        out[g * 3 + 1] = (unsigned char)(bits >> 8);
+        out[g * 3 + 2] = (unsigned char)(bits >> 16);
+    }
+    
+    size_t rest = n_cells % 8;
+    if (rest > 0) {
+        uint32_t bits = 0;
+        for (size_t i = 0; i < rest; i++) {
+            bits |= (uint32_t)packed_codes[in[groups * 8 + i]] << (3 * i);
+        }
+        out[groups * 3] = (unsigned char)bits;
+        out[groups * 3 + 1] = (unsigned char)(bits >> 8);
+        out[groups * 3 + 2] = (unsigned char)(bits >> 16);
+    }
+    
+    return BOARD_PACKED_SIZE(n_cells);
+}
+
+void board_clear_dirty(board_t* board) {
+    if (board->dirty_overflow) {
+        memset(board->dirty_mark, 0, BOARD_BITPLANE_SIZE(board->width * board->height));
+        board->dirty_overflow = false;
+    } else {
+        for (int i = 0; i < board->n_dirty; i++) {
+            board_set_bit(board->dirty_mark, board->dirty[i], false);
+        }
+    }
+    board->n_dirty = 0;
+}
+
 // Helper private function for checking valid position
 static inline int is_valid_position(board_t* board, int x, int y) {
     return (x >= 0 && x < board->width) && (y >= 0 && y < board->height); // Inside of the board boundaries
@@ -59,7 +166,7 @@ int move_pacman(board_t* board, int pacman_index, command_t* command) {
 
     if (direction == 'R') {
         char directions[] = {'W', 'S', 'A', 'D'};
-        direction = directions[rand() % 4];
+        direction = directions[rand_r(&board->rng) % 4];
     }
 
     // Calculate new position based on direction
@@ -95,7 +202,7 @@ int move_pacman(board_t* board, int pacman_index, command_t* command) {
 
     int new_index = get_board_index(board, new_x, new_y);
     int old_index = get_board_index(board, pac->pos_x, pac->pos_y);
-    char target_content = board->board[new_index].content;
+    char target_content = board->content[new_index];
 
     // Check for walls FIRST
     if (target_content == 'W') {
@@ -109,22 +216,22 @@ int move_pacman(board_t* board, int pacman_index, command_t* command) {
     }
 
     // Check for portal (only after confirming no ghost)
-    if (board->board[new_index].has_portal) {
-        board->board[old_index].content = ' ';
-        board->board[new_index].content = 'P';
+    if (board_has_portal(board, new_index)) {
+        set_cell_content(board, old_index, ' ');
+        set_cell_content(board, new_index, 'P');
         return REACHED_PORTAL;
     }
 
     // Collect points
-    if (board->board[new_index].has_dot) {
+    if (board_has_dot(board, new_index)) {
         pac->points++;
-        board->board[new_index].has_dot = 0;
+        board_set_bit(board->dots, new_index, false);
     }
 
-    board->board[old_index].content = ' ';
+    set_cell_content(board, old_index, ' ');
     pac->pos_x = new_x;
     pac->pos_y = new_y;
-    board->board[new_index].content = 'P';
+    set_cell_content(board, new_index, 'P');
 
     return VALID_MOVE;
 }
@@ -141,7 +248,7 @@ static int move_ghost_charged_direction(board_t* board, ghost_t* ghost, char dir
             if (y == 0) return INVALID_MOVE;
             *new_y = 0; // In case there is no colision
             for (int i = y - 1; i >= 0; i--) {
-                char target_content = board->board[get_board_index(board, x, i)].content;
+                char target_content = board->content[get_board_index(board, x, i)];
                 if (target_content == 'W' || target_content == 'M') {
                     *new_y = i + 1; // stop before colision
                     return VALID_MOVE;
@@ -157,7 +264,7 @@ static int move_ghost_charged_direction(board_t* board, ghost_t* ghost, char dir
             if (y == board->height - 1) return INVALID_MOVE;
             *new_y = board->height - 1; // In case there is no colision
             for (int i = y + 1; i < board->height; i++) {
-                char target_content = board->board[get_board_index(board, x, i)].content;
+                char target_content = board->content[get_board_index(board, x, i)];
                 if (target_content == 'W' || target_content == 'M') {
                     *new_y = i - 1; // stop before colision
                     return VALID_MOVE;
@@ -173,7 +280,7 @@ static int move_ghost_charged_direction(board_t* board, ghost_t* ghost, char dir
             if (x == 0) return INVALID_MOVE;
             *new_x = 0; // In case there is no colision
             for (int j = x - 1; j >= 0; j--) {
-                char target_content = board->board[get_board_index(board, j, y)].content;
+                char target_content = board->content[get_board_index(board, j, y)];
                 if (target_content == 'W' || target_content == 'M') {
                     *new_x = j + 1; // stop before colision
                     return VALID_MOVE;
@@ -189,7 +296,7 @@ static int move_ghost_charged_direction(board_t* board, ghost_t* ghost, char dir
             if (x == board->width - 1) return INVALID_MOVE;
             *new_x = board->width - 1; // In case there is no colision
             for (int j = x + 1; j < board->width; j++) {
-                char target_content = board->board[get_board_index(board, j, y)].content;
+                char target_content = board->content[get_board_index(board, j, y)];
                 if (target_content == 'W' || target_content == 'M') {
                     *new_x = j - 1; // stop before colision
                     return VALID_MOVE;
@@ -226,12 +333,12 @@ int move_ghost_charged(board_t* board, int ghost_index, char direction) {
     int new_index = get_board_index(board, new_x, new_y);
 
     // Update board - clear old position (restore what was there)
-    board->board[old_index].content = ' ';
+    set_cell_content(board, old_index, ' ');
     // Update ghost position
     ghost->pos_x = new_x;
     ghost->pos_y = new_y;
     // Update board - set new position
-    board->board[new_index].content = 'M';
+    set_cell_content(board, new_index, 'M');
     return MOVE_COMPLETED;
 }
 
@@ -251,7 +358,7 @@ int move_ghost(board_t* board, int ghost_index, command_t* command) {
     
     if (direction == 'R') {
         char directions[] = {'W', 'S', 'A', 'D'};
-        direction = directions[rand() % 4];
+        direction = directions[rand_r(&board->rng) % 4];
     }
 
     // Calculate new position based on direction
@@ -296,7 +403,7 @@ int move_ghost(board_t* board, int ghost_index, command_t* command) {
     // Check board position
     int new_index = get_board_index(board, new_x, new_y);
     int old_index = get_board_index(board, ghost->pos_x, ghost->pos_y);
-    char target_content = board->board[new_index].content;
+    char target_content = board->content[new_index];
 
     // Check for walls and ghosts
     if (target_content == 'W' || target_content == 'M') {
@@ -310,14 +417,14 @@ int move_ghost(board_t* board, int ghost_index, command_t* command) {
     }
 
     // Update board - clear old position (restore what was there)
-    board->board[old_index].content = ' ';
+    set_cell_content(board, old_index, ' ');
 
     // Update ghost position
     ghost->pos_x = new_x;
     ghost->pos_y = new_y;
 
     // Update board - set new position
-    board->board[new_index].content = 'M';
+    set_cell_content(board, new_index, 'M');
     return result;
 }
 
@@ -327,7 +434,7 @@ void kill_pacman(board_t* board, int pacman_index) {
     int index = pac->pos_y * board->width + pac->pos_x;
 
     // Remove pacman from the board
-    board->board[index].content = ' ';
+    set_cell_content(board, index, ' ');
 
     // Mark pacman as dead
     pac->alive = 0;
@@ -335,10 +442,12 @@ void kill_pacman(board_t* board, int pacman_index) {
 
 void unload_level(board_t * board) {
     // Safe cleanup - check for NULL pointers
-    if (board->board) {
-        free(board->board);
-        board->board = NULL;
-    }
+    free(board->content);
+    free(board->dots);
+    free(board->portals);
+    board->content = NULL;
+    board->dots = NULL;
+    board->portals = NULL;
     if (board->pacmans) {
         free(board->pacmans);
         board->pacmans = NULL;
@@ -347,6 +456,13 @@ void unload_level(board_t * board) {
         free(board->ghosts);
         board->ghosts = NULL;
     }
+    free(board->render);
+    free(board->dirty);
+    free(board->dirty_mark);
+    board->render = NULL;
+    board->dirty = NULL;
+    board->dirty_mark = NULL;
+    board->n_dirty = 0;
 }
 
 // =============================================================================
@@ -388,6 +504,20 @@ static int load_agent_behavior(const char* dir_path, const char* filename,
     return 0;
 }
 
+// Helper: an agent may only start inside the board, off the walls
+static int check_spawn(board_t* board, const char* filename, int row, int col) {
+    if (row < 0 || row >= board->height || col < 0 || col >= board->width) {
+        debug("Error: %s: POS %d %d is outside the %dx%d board\n",
+              filename, row, col, board->height, board->width);
+        return -1;
+    }
+    if (board->content[row * board->width + col] == 'W') {
+        debug("Error: %s: POS %d %d is a wall\n", filename, row, col);
+        return -1;
+    }
+    return 0;
+}
+
 int load_ghost_from_file(board_t* board, const char* dir_path, const char* filename, int ghost_index) {
     int passo, row, col, n_moves;
     command_t moves[MAX_MOVES];
@@ -395,6 +525,9 @@ int load_ghost_from_file(board_t* board, const char* dir_path, const char* filen
     if (load_agent_behavior(dir_path, filename, &passo, &row, &col, moves, &n_moves) < 0) {
         return -1;
     }
+    if (check_spawn(board, filename, row, col) < 0) {
+        return -1;
+    }
     
     ghost_t* ghost = &board->ghosts[ghost_index];
     ghost->pos_x = col;
@@ -410,7 +543,7 @@ int load_ghost_from_file(board_t* board, const char* dir_path, const char* filen
     
     // Place ghost on board
     int index = row * board->width + col;
-    board->board[index].content = 'M';
+    board->content[index] = 'M';
     
     return 0;
 }
@@ -422,6 +555,9 @@ int load_pacman_from_file(board_t* board, const char* dir_path, const char* file
     if (load_agent_behavior(dir_path, filename, &passo, &row, &col, moves, &n_moves) < 0) {
         return -1;
     }
+    if (check_spawn(board, filename, row, col) < 0) {
+        return -1;
+    }
     
     // Only one pacman, always index 0
     pacman_t* pac = &board->pacmans[0];
@@ -440,7 +576,7 @@ int load_pacman_from_file(board_t* board, const char* dir_path, const char* file
     
     // Place pacman on board
     int index = row * board->width + col;
-    board->board[index].content = 'P';
+    board->content[index] = 'P';
     
     return 0;
 }
@@ -458,14 +594,21 @@ int load_level_from_file(board_t* board, const char* dir_path, const char* level
     char pac_file[256] = {0};
     char mon_files[MAX_GHOSTS][256];
     int n_mons;
-    char board_data[4096];  // Should be enough for reasonable boards
+    char* board_data;
+    size_t board_len;
     
-    if (parse_level_file(fd, &rows, &cols, &tempo, pac_file, mon_files, MAX_GHOSTS, &n_mons, board_data, sizeof(board_data)) < 0) {
+    if (parse_level_file(fd, &rows, &cols, &tempo, pac_file, mon_files, MAX_GHOSTS, &n_mons, &board_data, &board_len) < 0) {
         close(fd);
         return -1;
     }
     close(fd);
     
+    if ((size_t)rows * (size_t)cols > MAX_BOARD_CELLS) {
+        debug("Level %s is too large (%dx%d)\n", level_file, cols, rows);
+        free(board_data);
+        return -1;
+    }
+    
     // Setup board dimensions
     board->height = rows;
     board->width = cols;
@@ -479,11 +622,23 @@ int load_level_from_file(board_t* board, const char* dir_path, const char* level
     if (dot) *dot = '\0';
     
     // Allocate memory
-    board->board = calloc(cols * rows, sizeof(board_pos_t));
+    size_t n_cells = (size_t)cols * rows;
+    board->content = malloc(n_cells);
+    board->dots = calloc(BOARD_BITPLANE_SIZE(n_cells), 1);
+    board->portals = calloc(BOARD_BITPLANE_SIZE(n_cells), 1);
     board->pacmans = calloc(1, sizeof(pacman_t));
     board->ghosts = calloc(n_mons, sizeof(ghost_t));
+    board->render = malloc(n_cells);
+    board->dirty_capacity = (int)(n_cells / 4) + 1;
+    board->dirty = malloc((size_t)board->dirty_capacity * sizeof(int));
+    board->dirty_mark = calloc(BOARD_BITPLANE_SIZE(n_cells), 1);
+    board->n_dirty = 0;
+    board->dirty_overflow = false;
     
-    if (!board->board || !board->pacmans || !board->ghosts) {
+    if (!board->content || !board->dots || !board->portals ||
+        !board->pacmans || !board->ghosts ||
+        !board->render || !board->dirty || !board->dirty_mark) {
+        free(board_data);
         cleanup_board(board);
         return -1;
     }
@@ -498,26 +653,28 @@ int load_level_from_file(board_t* board, const char* dir_path, const char* level
             
             switch (c) {
                 case 'X':  // Wall
-                    board->board[board_idx].content = 'W';
+                    board->content[board_idx] = 'W';
                     wall_count++;
                     break;
                 case '@':  // Portal
-                    board->board[board_idx].content = ' ';
-                    board->board[board_idx].has_portal = 1;
+                    board->content[board_idx] = ' ';
+                    board_set_bit(board->portals, board_idx, true);
                     portal_count++;
                     break;
                 case 'o':  // Walkable space (with dot)
-                    board->board[board_idx].content = ' ';
-                    board->board[board_idx].has_dot = 1;
+                    board->content[board_idx] = ' ';
+                    board_set_bit(board->dots, board_idx, true);
                     dot_count++;
                     break;
                 default:   // Anything else is empty
-                    board->board[board_idx].content = ' ';
+                    board->content[board_idx] = ' ';
                     break;
             }
         }
     }
     
+    free(board_data);
+    
     debug("Board parsed: %d walls, %d dots, %d portals\n", wall_count, dot_count, portal_count);
     
     // Store file references
@@ -556,11 +713,11 @@ int load_level_from_file(board_t* board, const char* dir_path, const char* level
         for (int i = 0; i < rows && !found; i++) {
             for (int j = 0; j < cols && !found; j++) {
                 int idx = i * cols + j;
-                if (board->board[idx].has_dot && board->board[idx].content == ' ') {
+                if (board_has_dot(board, idx) && board->content[idx] == ' ') {
                     pac->pos_x = j;
                     pac->pos_y = i;
-                    board->board[idx].content = 'P';
-                    board->board[idx].has_dot = 0;  // Pacman "eats" starting dot
+                    board->content[idx] = 'P';
+                    board_set_bit(board->dots, idx, false);  // Pacman "eats" starting dot
                     found = 1;
                 }
             }
@@ -575,5 +732,102 @@ int load_level_from_file(board_t* board, const char* dir_path, const char* level
         debug("Manual Pacman placed at (%d, %d)\n", pac->pos_x, pac->pos_y);
     }
     
+    // Everything is placed - build the glyphs clients will see
+    render_board(board);
+    board->rng = board_seed();
+    
+    return 0;
+}
+
+int board_instantiate(board_t* board, const board_t* level, int accumulated_points) {
+    // Scalars, names and file references, then private copies of the arrays
+    *board = *level;
+
+    size_t n_cells = (size_t)level->width * level->height;
+    size_t plane_size = BOARD_BITPLANE_SIZE(n_cells);
+    board->content = malloc(n_cells);
+    board->dots = malloc(plane_size);
+    board->portals = malloc(plane_size);
+    board->pacmans = malloc(sizeof(pacman_t) * (size_t)level->n_pacmans);
+    board->ghosts = calloc((size_t)level->n_ghosts, sizeof(ghost_t));
+    board->render = malloc(n_cells);
+    board->dirty = malloc((size_t)level->dirty_capacity * sizeof(int));
+    board->dirty_mark = calloc(plane_size, 1);
+    board->n_dirty = 0;
+    board->dirty_overflow = false;
+
+    if (!board->content || !board->dots || !board->portals ||
+        !board->pacmans || !board->ghosts ||
+        !board->render || !board->dirty || !board->dirty_mark) {
+        cleanup_board(board);
+        return -1;
+    }
+
+    memcpy(board->content, level->content, n_cells);
+    memcpy(board->dots, level->dots, plane_size);
+    memcpy(board->portals, level->portals, plane_size);
+    memcpy(board->render, level->render, n_cells);
+    memcpy(board->pacmans, level->pacmans, sizeof(pacman_t) * (size_t)level->n_pacmans);
+    memcpy(board->ghosts, level->ghosts, sizeof(ghost_t) * (size_t)level->n_ghosts);
+    board->pacmans[0].points = accumulated_points;
+    board->rng = board_seed();
+
+    return 0;
+}
+
+// Checkpoint header: width | height | n_pacmans | n_ghosts | rng
+#define CHECKPOINT_HEADER_SIZE (4 * sizeof(int) + sizeof(unsigned int))
+
+size_t board_checkpoint_size(const board_t* board) {
+    size_t n_cells = (size_t)board->width * board->height;
+    return CHECKPOINT_HEADER_SIZE + n_cells + 2 * BOARD_BITPLANE_SIZE(n_cells) +
+           sizeof(pacman_t) * (size_t)board->n_pacmans + sizeof(ghost_t) * (size_t)board->n_ghosts;
+}
+
+void board_checkpoint(const board_t* board, char* out) {
+    size_t n_cells = (size_t)board->width * board->height;
+    size_t plane_size = BOARD_BITPLANE_SIZE(n_cells);
+    int fields[4] = {board->width, board->height, board->n_pacmans, board->n_ghosts};
+
+    memcpy(out, fields, sizeof(fields));
+    memcpy(out + sizeof(fields), &board->rng, sizeof(unsigned int));
+    out += CHECKPOINT_HEADER_SIZE;
+    memcpy(out, board->content, n_cells);
+    out += n_cells;
+    memcpy(out, board->dots, plane_size);
+    out += plane_size;
+    memcpy(out, board->portals, plane_size);
+    out += plane_size;
+    memcpy(out, board->pacmans, sizeof(pacman_t) * (size_t)board->n_pacmans);
+    out += sizeof(pacman_t) * (size_t)board->n_pacmans;
+    memcpy(out, board->ghosts, sizeof(ghost_t) * (size_t)board->n_ghosts);
+}
+
+int board_restore(board_t* board, const char* data, size_t size) {
+    int fields[4];
+    if (size != board_checkpoint_size(board)) {
+        return -1;
+    }
+    memcpy(fields, data, sizeof(fields));
+    if (fields[0] != board->width || fields[1] != board->height ||
+        fields[2] != board->n_pacmans || fields[3] != board->n_ghosts) {
+        return -1;
+    }
+
+    size_t n_cells = (size_t)board->width * board->height;
+    size_t plane_size = BOARD_BITPLANE_SIZE(n_cells);
+    memcpy(&board->rng, data + sizeof(fields), sizeof(unsigned int));
+    data += CHECKPOINT_HEADER_SIZE;
+    memcpy(board->content, data, n_cells);
+    data += n_cells;
+    memcpy(board->dots, data, plane_size);
+    data += plane_size;
+    memcpy(board->portals, data, plane_size);
+    data += plane_size;
+    memcpy(board->pacmans, data, sizeof(pacman_t) * (size_t)board->n_pacmans);
+    data += sizeof(pacman_t) * (size_t)board->n_pacmans;
+    memcpy(board->ghosts, data, sizeof(ghost_t) * (size_t)board->n_ghosts);
+
+    render_board(board);
     return 0;
 }
@@ -0,0 +1,227 @@
+#include "board.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+// =============================================================================
+// Board Memory Benchmark
+// =============================================================================
+//
+// Usage: ./BoardMemBench [size [games]]
+// Loads a size x size level (1000 x 1000 by default) as the server does and
+// gives each of games games (64 by default) its two boards - the level in
+// play and the next one prefetched - twice: with the cell-struct layout the
+// board used to have (board_pos_t, 12 bytes per cell) and with board_t's
+// content bytes plus bit planes (board_instantiate). Prints the resident
+// memory each layout adds per game.
+
+#define BENCH_DEFAULT_SIZE 1000
+#define BENCH_DEFAULT_GAMES 64
+#define BENCH_MAX_SIZE 4096             // Largest square under MAX_BOARD_CELLS
+#define BENCH_MAX_GAMES 1024
+#define BOARDS_PER_GAME 2               // In play and prefetched
+
+static char level_dir[64];
+
+// =============================================================================
+// Level Generator
+// =============================================================================
+
+/**
+ * Writes a.lvl into level_dir: a wall border with dots inside and a portal
+ * every 97 cells. Returns 0, or -1.
+ */
+static int generate_level(int size) {
+    char path[128];
+    snprintf(path, sizeof(path), "%s/a.lvl", level_dir);
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        return -1;
+    }
+    fprintf(file, "DIM %d %d\nTEMPO 100\n", size, size);
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            char cell = 'o';
+            if (i == 0 || j == 0 || i == size - 1 || j == size - 1) {
+                cell = 'X';
+            } else if ((i * size + j) % 97 == 0) {
+                cell = '@';
+            }
+            fputc(cell, file);
+        }
+        fputc('\n', file);
+    }
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+static void remove_level(void) {
+    char path[128];
+    snprintf(path, sizeof(path), "%s/a.lvl", level_dir);
+    unlink(path);
+    rmdir(level_dir);
+}
+
+// =============================================================================
+// Cell-struct Reference Layout
+// =============================================================================
+
+typedef struct {
+    char content;
+    int has_dot;
+    int has_portal;
+} ref_cell_t;
+
+/**
+ * The cell arrays of a board in the old layout: one struct per cell, the
+ * render plane, a dirty list with room for every cell and a dirty mark byte
+ * per cell.
+ */
+typedef struct {
+    ref_cell_t* cells;
+    char* render;
+    int* dirty;
+    unsigned char* dirty_mark;
+} ref_board_t;
+
+/**
+ * Fills a board the way loading a level used to: every cell struct and
+ * glyph is written, the dirty list and marks are allocated untouched.
+ */
+static int ref_board_load(ref_board_t* board, const board_t* level) {
+    size_t n_cells = (size_t)level->width * level->height;
+    board->cells = calloc(n_cells, sizeof(ref_cell_t));
+    board->render = malloc(n_cells);
+    board->dirty = malloc(n_cells * sizeof(int));
+    board->dirty_mark = calloc(n_cells, 1);
+    if (!board->cells || !board->render || !board->dirty || !board->dirty_mark) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < n_cells; i++) {
+        board->cells[i].content = level->content[i];
+        board->cells[i].has_dot = board_has_dot(level, (int)i);
+        board->cells[i].has_portal = board_has_portal(level, (int)i);
+    }
+    memcpy(board->render, level->render, n_cells);
+    return 0;
+}
+
+static void ref_board_unload(ref_board_t* board) {
+    free(board->cells);
+    free(board->render);
+    free(board->dirty);
+    free(board->dirty_mark);
+}
+
+// =============================================================================
+// Measurement
+// =============================================================================
+
+/**
+ * Resident bytes of this process (/proc/self/statm), or -1.
+ */
+static long resident_bytes(void) {
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (!statm) {
+        return -1;
+    }
+    long size = 0, resident = -1;
+    if (fscanf(statm, "%ld %ld", &size, &resident) != 2) {
+        resident = -1;
+    }
+    fclose(statm);
+    return resident < 0 ? -1 : resident * sysconf(_SC_PAGESIZE);
+}
+
+static void print_line(const char* name, long before, long after, int games, size_t n_cells) {
+    double per_game = (double)(after - before) / games;
+    printf("%-22s %10.2f  %10.2f\n", name, per_game / (1024 * 1024),
+           per_game / (double)(BOARDS_PER_GAME * n_cells));
+}
+
+// =============================================================================
+// Main
+// =============================================================================
+
+int main(int argc, char** argv) {
+    if (argc > 3) {
+        fprintf(stderr, "Usage: %s [size [games]]\n", argv[0]);
+        return 1;
+    }
+    int size = argc > 1 ? atoi(argv[1]) : BENCH_DEFAULT_SIZE;
+    int games = argc > 2 ? atoi(argv[2]) : BENCH_DEFAULT_GAMES;
+    if (size < 4 || size > BENCH_MAX_SIZE || games < 1 || games > BENCH_MAX_GAMES) {
+        fprintf(stderr, "Error: size must be 4 to %d, games 1 to %d\n", BENCH_MAX_SIZE, BENCH_MAX_GAMES);
+        return 1;
+    }
+
+    snprintf(level_dir, sizeof(level_dir), "/tmp/board_mem_bench_XXXXXX");
+    if (!mkdtemp(level_dir) || generate_level(size) < 0) {
+        fprintf(stderr, "Error: cannot generate level: %s\n", strerror(errno));
+        remove_level();
+        return 1;
+    }
+
+    // The template every game copies (the server parses each level once)
+    board_t level;
+    memset(&level, 0, sizeof(level));
+    int loaded = load_level_from_file(&level, level_dir, "a.lvl", 0);
+    remove_level();
+    if (loaded < 0) {
+        fprintf(stderr, "Error: cannot load the generated level\n");
+        return 1;
+    }
+
+    size_t n_boards = (size_t)games * BOARDS_PER_GAME;
+    size_t n_cells = (size_t)size * size;
+    ref_board_t* ref_boards = calloc(n_boards, sizeof(ref_board_t));
+    board_t* boards = calloc(n_boards, sizeof(board_t));
+    if (!ref_boards || !boards) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+
+    printf("Level %dx%d, %d games with %d boards each\n", size, size, games, BOARDS_PER_GAME);
+    printf("                        MiB/game  bytes/cell\n");
+
+    int status = 0;
+    long before = resident_bytes();
+    for (size_t i = 0; i < n_boards && status == 0; i++) {
+        if (ref_board_load(&ref_boards[i], &level) < 0) {
+            status = 1;
+        }
+    }
+    long after = resident_bytes();
+    for (size_t i = 0; i < n_boards; i++) {
+        ref_board_unload(&ref_boards[i]);
+    }
+    if (status == 0) {
+        print_line("cell structs", before, after, games, n_cells);
+    }
+
+    before = resident_bytes();
+    size_t n_loaded = 0;
+    while (status == 0 && n_loaded < n_boards) {
+        if (board_instantiate(&boards[n_loaded], &level, 0) < 0) {
+            status = 1;
+        } else {
+            n_loaded++;
+        }
+    }
+    after = resident_bytes();
+    for (size_t i = 0; i < n_loaded; i++) {
+        unload_level(&boards[i]);
+    }
+    if (status == 0) {
+        print_line("content + bit planes", before, after, games, n_cells);
+    } else {
+        fprintf(stderr, "Error: out of memory\n");
+    }
+
+    free(ref_boards);
+    free(boards);
+    unload_level(&level);
+    return status;
+}
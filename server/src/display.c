@@ -92,7 +92,7 @@ void print_board(board_t* game_board) {
         char line[256];
         int pos = 0;
         for (int x = 0; x < game_board->width && pos < 255; x++) {
-            line[pos++] = game_board->board[y * game_board->width + x].content;
+            line[pos++] = game_board->content[y * game_board->width + x];
         }
         line[pos] = '\0';
         debug("%s\n", line);
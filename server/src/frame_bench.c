@@ -0,0 +1,238 @@
+#include "session.h"
+#include "board.h"
+#include "protocol.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+// =============================================================================
+// Frame Serialization Benchmark
+// =============================================================================
+//
+// Usage: ./FrameBench [size [frames]]
+// Loads a size x size level (100 x 100 by default) and sends frames of it
+// to /dev/null three ways: the way frames used to be built (a message
+// malloc'ed per frame, every cell mapped to its glyph), and send_board_update
+// as keyframes and as deltas with one changed cell each. Prints frames per
+// second and bytes per frame.
+
+#define BENCH_DEFAULT_SIZE 100
+#define BENCH_DEFAULT_FRAMES 200000
+#define BENCH_MAX_SIZE 4096             // Largest square under MAX_BOARD_CELLS
+
+static char level_dir[64];
+
+// =============================================================================
+// Level Generator
+// =============================================================================
+
+/**
+ * Writes a.lvl into level_dir: a wall border with dots inside and a portal
+ * in the far corner. Returns 0, or -1.
+ */
+static int generate_level(int size) {
+    char path[128];
+    snprintf(path, sizeof(path), "%s/a.lvl", level_dir);
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        return -1;
+    }
+    fprintf(file, "DIM %d %d\nTEMPO 100\n", size, size);
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            char cell = 'o';
+            if (i == 0 || j == 0 || i == size - 1 || j == size - 1) {
+                cell = 'X';
+            } else if (i == size - 2 && j == size - 2) {
+                cell = '@';
+            }
+            fputc(cell, file);
+        }
+        fputc('\n', file);
+    }
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+static void remove_level(void) {
+    char path[128];
+    snprintf(path, sizeof(path), "%s/a.lvl", level_dir);
+    unlink(path);
+    rmdir(level_dir);
+}
+
+// =============================================================================
+// Allocating Reference Serializer
+// =============================================================================
+
+/**
+ * Sends a full frame the old way: allocates the message, maps every cell
+ * from the board's content and planes, writes it and frees it.
+ */
+static int reference_send(int fd, board_t* board, int points) {
+    int board_size = board->width * board->height;
+    size_t msg_size = 1 + 6 * sizeof(int) + (size_t)board_size;
+    char* message = malloc(msg_size);
+    if (!message) {
+        return -1;
+    }
+
+    size_t offset = 0;
+    message[offset++] = OP_CODE_BOARD;
+    int header[6] = {board->width, board->height, board->tempo, 0, 0, points};
+    memcpy(&message[offset], header, sizeof(header));
+    offset += sizeof(header);
+
+    for (int idx = 0; idx < board_size; idx++) {
+        char content = board->content[idx];
+        if (content == 'W') {
+            message[offset++] = '#';
+        } else if (content == 'P') {
+            message[offset++] = 'C';
+        } else if (content == 'M') {
+            message[offset++] = 'M';
+        } else if (board_has_portal(board, idx)) {
+            message[offset++] = '@';
+        } else if (board_has_dot(board, idx)) {
+            message[offset++] = 'o';
+        } else {
+            message[offset++] = ' ';
+        }
+    }
+
+    ssize_t written = write(fd, message, msg_size);
+    free(message);
+    return written == (ssize_t)msg_size ? 0 : -1;
+}
+
+// =============================================================================
+// Measurement
+// =============================================================================
+
+typedef enum {
+    BENCH_REFERENCE,
+    BENCH_KEYFRAMES,
+    BENCH_DELTAS
+} bench_mode_t;
+
+static const char* mode_names[] = {"malloc per frame", "keyframes", "deltas (1 cell)"};
+
+/**
+ * Marks one interior cell changed, the way the board does when a cell is
+ * mutated (its glyph is flipped between a dot and empty).
+ */
+static void change_one_cell(board_t* board, long frame) {
+    int interior = (board->width - 2) * (board->height - 2);
+    int i = (int)(frame % interior);
+    int idx = (i / (board->width - 2) + 1) * board->width + i % (board->width - 2) + 1;
+    board->render[idx] = board->render[idx] == 'o' ? ' ' : 'o';
+    board->dirty[board->n_dirty++] = idx;
+}
+
+/**
+ * Sends frames in one mode. Returns frames per second, or -1 on error;
+ * bytes per frame are stored in bytes.
+ */
+static double bench(bench_mode_t mode, client_session_t* session, board_t* board, long frames,
+                    double* bytes) {
+    // A first keyframe, so deltas have a base
+    if (session_prepare_frames(session, board) < 0 || send_board_update(session, board, 0, 0) < 0) {
+        return -1;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < frames; i++) {
+        int result;
+        if (mode == BENCH_REFERENCE) {
+            result = reference_send(session->notif_pipe_fd, board, session->accumulated_points);
+        } else {
+            if (mode == BENCH_KEYFRAMES) {
+                session->last_frame_width = 0;
+            } else {
+                change_one_cell(board, i);
+            }
+            result = send_board_update(session, board, 0, 0);
+        }
+        if (result < 0) {
+            return -1;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    int board_size = board->width * board->height;
+    if (mode == BENCH_DELTAS) {
+        *bytes = (double)(BOARD_HEADER_SIZE + BOARD_DELTA_COUNT_SIZE + BOARD_DELTA_ENTRY_SIZE);
+    } else if (mode == BENCH_KEYFRAMES) {
+        *bytes = (double)(BOARD_HEADER_SIZE + board_size);
+    } else {
+        *bytes = (double)(1 + 6 * sizeof(int) + board_size);
+    }
+
+    double seconds = (double)(end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    return (double)frames / seconds;
+}
+
+// =============================================================================
+// Main
+// =============================================================================
+
+int main(int argc, char** argv) {
+    if (argc > 3) {
+        fprintf(stderr, "Usage: %s [size [frames]]\n", argv[0]);
+        return 1;
+    }
+    int size = argc > 1 ? atoi(argv[1]) : BENCH_DEFAULT_SIZE;
+    long frames = argc > 2 ? atol(argv[2]) : BENCH_DEFAULT_FRAMES;
+    if (size < 4 || size > BENCH_MAX_SIZE || frames <= 0) {
+        fprintf(stderr, "Error: size must be 4 to %d, frames positive\n", BENCH_MAX_SIZE);
+        return 1;
+    }
+
+    snprintf(level_dir, sizeof(level_dir), "/tmp/frame_bench_XXXXXX");
+    if (!mkdtemp(level_dir) || generate_level(size) < 0) {
+        fprintf(stderr, "Error: cannot generate level: %s\n", strerror(errno));
+        remove_level();
+        return 1;
+    }
+
+    board_t board;
+    memset(&board, 0, sizeof(board));
+    int loaded = load_level_from_file(&board, level_dir, "a.lvl", 0);
+    remove_level();
+    if (loaded < 0) {
+        fprintf(stderr, "Error: cannot load the generated level\n");
+        return 1;
+    }
+
+    client_session_t session;
+    init_session(&session);
+    session.notif_pipe_fd = open("/dev/null", O_WRONLY);
+    session.active = session.notif_pipe_fd >= 0;
+    if (!session.active) {
+        fprintf(stderr, "Error: cannot open /dev/null: %s\n", strerror(errno));
+        unload_level(&board);
+        return 1;
+    }
+
+    printf("Board %dx%d, %ld frames each\n", size, size, frames);
+    printf("                   frames/s  bytes/frame\n");
+    int status = 0;
+    for (int mode = BENCH_REFERENCE; mode <= BENCH_DELTAS; mode++) {
+        double bytes = 0;
+        double rate = bench((bench_mode_t)mode, &session, &board, frames, &bytes);
+        if (rate < 0) {
+            fprintf(stderr, "Error: sending %s failed\n", mode_names[mode]);
+            status = 1;
+            break;
+        }
+        printf("%-17s %10.0f  %11.0f\n", mode_names[mode], rate, bytes);
+    }
+
+    cleanup_session(&session);
+    unload_level(&board);
+    return status;
+}
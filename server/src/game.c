@@ -111,14 +111,16 @@ static void signal_handler(int sig) {
     if (sig == SIGINT || sig == SIGTERM) {
         debug("[Signal] Received signal %d, shutting down...\n", sig);
         if (g_server_ctx) {
-            g_server_ctx->running = false;
+            server_request_shutdown(g_server_ctx);
         }
     }
 }
 
 int main(int argc, char** argv) {
-    if (argc != 4) {
-        const char* usage_msg = "Usage: ./Pacmanist <level_directory> <max_games> <fifo_name>\n";
+    if (argc < 4 || argc > 7) {
+        const char* usage_msg =
+            "Usage: ./Pacmanist <level_directory> <max_games> <fifo_name> "
+            "[replay_directory|-] [resume_grace_seconds] [journal_file|-]\n";
         if (write(STDERR_FILENO, usage_msg, strlen(usage_msg)) < 0) {
             // Silently ignore write error
         }
@@ -128,6 +130,9 @@ int main(int argc, char** argv) {
     const char* level_dir = argv[1];
     int max_games = atoi(argv[2]);
     const char* server_fifo_path = argv[3];
+    const char* replay_dir = argc >= 5 && strcmp(argv[4], "-") != 0 ? argv[4] : NULL;
+    int park_grace_ms = argc >= 6 ? atoi(argv[5]) * 1000 : PARK_GRACE_MS;
+    const char* journal_path = argc == 7 && strcmp(argv[6], "-") != 0 ? argv[6] : NULL;
     
     // Validate max_games
     if (max_games <= 0) {
@@ -136,6 +141,12 @@ int main(int argc, char** argv) {
         return 1;
     }
     
+    if (park_grace_ms < 0) {
+        const char* err_msg = "Error: resume_grace_seconds must not be negative\n";
+        if (write(STDERR_FILENO, err_msg, strlen(err_msg)) < 0) {}
+        return 1;
+    }
+    
     // Scan directory for .lvl files
     char* level_files[MAX_LEVELS] = {0};
     int n_levels = scan_level_files(level_dir, level_files, MAX_LEVELS);
@@ -161,6 +172,9 @@ int main(int argc, char** argv) {
     debug("Level directory: %s\n", level_dir);
     debug("Max concurrent games: %d\n", max_games);
     debug("Server FIFO: %s\n", server_fifo_path);
+    debug("Replay directory: %s\n", replay_dir ? replay_dir : "(not recording)");
+    debug("Resume grace period: %d ms\n", park_grace_ms);
+    debug("Journal: %s\n", journal_path ? journal_path : "(not journaling)");
     debug("Found %d level files:\n", n_levels);
     for (int i = 0; i < n_levels; i++) {
         debug("  [%d] %s\n", i, level_files[i]);
@@ -169,7 +183,7 @@ int main(int argc, char** argv) {
     // Initialize server context
     server_context_t server_ctx;
     if (server_init(&server_ctx, max_games, level_dir, server_fifo_path, 
-                    level_files, n_levels) < 0) {
+                    level_files, n_levels, replay_dir, park_grace_ms, journal_path) < 0) {
         debug("Error: Failed to initialize server\n");
         free_level_files(level_files, n_levels);
         close_debug_file();
@@ -181,6 +195,10 @@ int main(int argc, char** argv) {
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
     
+    // A client closing its FIFO must only end that client's game
+    // (write() then fails with EPIPE and the session is dropped)
+    signal(SIGPIPE, SIG_IGN);
+    
     // Setup SIGUSR1 handler for leaderboard generation
     setup_sigusr1_handler();
     debug("SIGUSR1 handler installed - send 'kill -SIGUSR1 %d' to generate top5.txt\n", getpid());
@@ -4,23 +4,75 @@
 #include "threads.h"
 #include "protocol.h"
 #include "leaderboard.h"
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <poll.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
 
-// Game result codes
-#define CONTINUE_PLAY 0
-#define NEXT_LEVEL 1
-#define QUIT_GAME 2
-#define PACMAN_DIED 3
-#define CLIENT_DISCONNECTED 4
+// File descriptors each game keeps open (request + notification FIFO)
+#define FDS_PER_GAME 2
 
-// Forward declaration
-static int play_level_threaded(board_t* game_board, client_session_t* session,
-                               leaderboard_t* lb, int lb_index);
+// A game opens its client's FIFOs itself: while the client has not opened
+// its notification FIFO, the game tries again after ACCEPT_RETRY_MIN_MS,
+// doubling up to ACCEPT_RETRY_MAX_MS, and gives up after ACCEPT_TIMEOUT_MS
+#define ACCEPT_TIMEOUT_MS 2000
+#define ACCEPT_RETRY_MIN_MS 1
+#define ACCEPT_RETRY_MAX_MS 64
+
+// A finished game whose client has not read its last frames yet checks back
+// this often, and gives up on them after DRAIN_TIMEOUT_MS
+#define DRAIN_POLL_MS 5
+#define DRAIN_TIMEOUT_MS 1000
+
+typedef enum {
+    PARK_NONE,                          // Playing
+    PARKED,                             // Client gone, game in the park table
+    PARK_RESUMING                       // Client back, the game is accepting it again
+} park_state_t;
+
+/**
+ * A client's game, from accept to the end of its last level.
+ * Owned by the scheduler while queued; freed when the game ends.
+ */
+typedef struct game_session_s {
+    sched_task_t task;                  // Scheduler hook (must stay first)
+    game_manager_t* manager;            // Level list, leaderboard and game slots
+    char client_id[MAX_CLIENT_ID_LENGTH + 1];
+    
+    client_session_t session;           // Client FIFOs and frame state
+    board_t boards[2];                  // Current level and the prefetched next one
+    board_t* board;                     // Current level (one of boards)
+    level_job_t prefetch;               // Loads the next level into the other board
+    game_context_t ctx;                 // Tick engine, kept across levels
+    
+    int current_level;                  // Index into the level list
+    int lb_index;                       // Leaderboard entry
+    bool level_running;                 // board is loaded and in play
+    struct timespec level_end_time;     // When the previous level's final frame was sent
+    
+    // Opening the client's FIFOs (the paths are in session); a parked game
+    // whose client is back does so in the PARK_RESUMING state instead
+    bool accepting;                     // Runs only retry the opens
+    struct timespec accept_deadline;    // When the client is given up
+    int accept_retry_ms;                // Wait before the next attempt
+    
+    // Over, but its final frames are still queued for the client
+    bool draining;                      // Runs only send the rest
+    struct timespec drain_deadline;     // When the rest is given up
+    
+    // Parking (the task's own flag, and the rest under the park table's mutex)
+    bool parked;                        // Runs only check on the park state
+    park_state_t park_state;
+    struct timespec park_deadline;      // When a parked game is given up
+    struct game_session_s* park_next;   // Park table chain
+} game_session_t;
 
 /**
  * Extract client ID from pipe path.
@@ -44,127 +96,620 @@ static void extract_client_id(const char* pipe_path, char* client_id, size_t max
     client_id[i] = '\0';
 }
 
+static long elapsed_us(const struct timespec* from, const struct timespec* to) {
+    return (to->tv_sec - from->tv_sec) * 1000000L + (to->tv_nsec - from->tv_nsec) / 1000L;
+}
+
+static void timespec_add_ms(struct timespec* ts, int milliseconds) {
+    ts->tv_sec += milliseconds / 1000;
+    ts->tv_nsec += (long)(milliseconds % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+/**
+ * Starts accepting the client of a connection request: its FIFO paths go
+ * into the game's session, and the attempts to open them begin.
+ */
+static void begin_accept(game_session_t* game, const connection_request_t* request) {
+    client_session_t* session = &game->session;
+    strncpy(session->req_pipe_path, request->req_pipe_path, MAX_PIPE_PATH_LENGTH);
+    session->req_pipe_path[MAX_PIPE_PATH_LENGTH] = '\0';
+    strncpy(session->notif_pipe_path, request->notif_pipe_path, MAX_PIPE_PATH_LENGTH);
+    session->notif_pipe_path[MAX_PIPE_PATH_LENGTH] = '\0';
+    
+    clock_gettime(CLOCK_MONOTONIC, &game->accept_deadline);
+    timespec_add_ms(&game->accept_deadline, ACCEPT_TIMEOUT_MS);
+    game->accept_retry_ms = ACCEPT_RETRY_MIN_MS;
+}
+
+/**
+ * Whether a path field of a connection request names a FIFO the server
+ * can open: non-empty, absolute and printable up to its terminator (or
+ * the end of the field).
+ */
+static bool valid_pipe_path(const char* field) {
+    if (field[0] != '/') {
+        return false;
+    }
+    for (int i = 1; i < MAX_PIPE_PATH_LENGTH && field[i] != '\0'; i++) {
+        if (!isprint((unsigned char)field[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
 // =============================================================================
-// Game Manager Thread
+// Park Table (caller holds table->mutex)
 // =============================================================================
 
 /**
- * Handle a single client session - play all levels until game over or disconnect.
+ * FNV-1a hash of a client id, reduced to a bucket.
  */
-static void handle_client_session(game_manager_t* manager, connection_request_t* request) {
-    debug("[Manager %d] Handling new client session\n", manager->id);
-    debug("[Manager %d] req_pipe: %s\n", manager->id, request->req_pipe_path);
-    debug("[Manager %d] notif_pipe: %s\n", manager->id, request->notif_pipe_path);
-    
-    // Extract client ID from pipe path for leaderboard
-    char client_id[MAX_CLIENT_ID_LENGTH + 1];
-    extract_client_id(request->req_pipe_path, client_id, sizeof(client_id));
+static unsigned int park_bucket(const char* client_id) {
+    uint32_t hash = 2166136261u;
+    for (const char* c = client_id; *c; c++) {
+        hash = (hash ^ (unsigned char)*c) * 16777619u;
+    }
+    return hash & (PARK_BUCKETS - 1);
+}
+
+static void park_insert(park_table_t* table, game_session_t* game) {
+    unsigned int bucket = park_bucket(game->client_id);
+    game->park_next = table->buckets[bucket];
+    table->buckets[bucket] = game;
+    table->n_parked++;
+}
+
+static void park_unlink(park_table_t* table, game_session_t* game) {
+    game_session_t** link = &table->buckets[park_bucket(game->client_id)];
+    while (*link && *link != game) {
+        link = &(*link)->park_next;
+    }
+    if (*link) {
+        *link = game->park_next;
+        game->park_next = NULL;
+        table->n_parked--;
+    }
+}
+
+/**
+ * Takes the client's parked game out of the table and has it accept the
+ * client of request. The game's next run starts on it.
+ * Returns NULL if the client has none.
+ */
+static game_session_t* park_claim(park_table_t* table, const char* client_id,
+                                  const connection_request_t* request) {
+    pthread_mutex_lock(&table->mutex);
+    game_session_t* game = table->buckets[park_bucket(client_id)];
+    while (game && strcmp(game->client_id, client_id) != 0) {
+        game = game->park_next;
+    }
+    if (game) {
+        park_unlink(table, game);
+        begin_accept(game, request);
+        game->park_state = PARK_RESUMING;
+    }
+    pthread_mutex_unlock(&table->mutex);
+    return game;
+}
+
+// =============================================================================
+// Game Sessions (run by the scheduler)
+// =============================================================================
+
+/**
+ * Releases everything the game holds and frees its slot.
+ */
+static void release_game_session(game_session_t* game) {
+    game_manager_t* manager = game->manager;
     
-    // Register in leaderboard
-    int lb_index = -1;
-    if (manager->leaderboard) {
-        lb_index = leaderboard_register(manager->leaderboard, client_id);
+    level_loader_cancel(manager->loader, &game->prefetch);
+    if (game->level_running) {
+        unload_level(game->board);
+        game->level_running = false;
     }
+    cleanup_game_context(&game->ctx);
     
-    // Initialize session
-    client_session_t session;
-    init_session(&session);
+    // Cleanup session
+    debug("[Game %s] Session ended. Final score: %d\n", 
+          game->client_id, game->session.accumulated_points);
+    reactor_remove(manager->reactor, &game->session);
+    cleanup_session(&game->session);
     
-    // Copy pipe paths from request
-    strncpy(session.req_pipe_path, request->req_pipe_path, MAX_PIPE_PATH_LENGTH);
-    session.req_pipe_path[MAX_PIPE_PATH_LENGTH] = '\0';
-    strncpy(session.notif_pipe_path, request->notif_pipe_path, MAX_PIPE_PATH_LENGTH);
-    session.notif_pipe_path[MAX_PIPE_PATH_LENGTH] = '\0';
+    // Unregister from leaderboard
+    if (manager->leaderboard && game->lb_index >= 0) {
+        leaderboard_unregister(manager->leaderboard, game->lb_index);
+    }
     
-    // Accept the connection (open client FIFOs and send response)
-    if (accept_connection(&session) < 0) {
-        debug("[Manager %d] Failed to accept connection\n", manager->id);
-        cleanup_session(&session);
-        if (manager->leaderboard && lb_index >= 0) {
-            leaderboard_unregister(manager->leaderboard, lb_index);
+    free(game);
+    sem_post(manager->game_slots);
+}
+
+/**
+ * Ends a game for good: it is journaled as over, so it is not recovered
+ * after a restart (a game cancelled by shutdown is).
+ */
+static void end_game_session(game_session_t* game) {
+    if (game->ctx.journal) {
+        journal_append_end(game->ctx.journal, game->client_id, game->session.accumulated_points);
+    }
+    release_game_session(game);
+}
+
+/**
+ * One attempt at accepting the game's client: opens its FIFOs and hands
+ * its input to the reactor. A client that has not opened its notification
+ * FIFO yet is tried again later rather than waited for, so no thread ever
+ * sleeps on a client.
+ * Returns 0 once the client is accepted, 1 if the game should try again at
+ * next_deadline, -1 if the client cannot be accepted (or its time ran out).
+ */
+static int try_accept(game_session_t* game, struct timespec* next_deadline) {
+    game_manager_t* manager = game->manager;
+    client_session_t* session = &game->session;
+    
+    int result = accept_connection(session);
+    if (result > 0) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (elapsed_us(&now, &game->accept_deadline) <= 0) {
+            debug("[Game %s] Client did not open its FIFOs in time\n", game->client_id);
+            return -1;
         }
-        return;
+        *next_deadline = now;
+        timespec_add_ms(next_deadline, game->accept_retry_ms);
+        if (game->accept_retry_ms < ACCEPT_RETRY_MAX_MS) {
+            game->accept_retry_ms *= 2;
+        }
+        return 1;
+    }
+    if (result < 0) {
+        debug("[Game %s] Failed to accept connection\n", game->client_id);
+        return -1;
     }
     
-    debug("[Manager %d] Client connected successfully!\n", manager->id);
+    // A replay that cannot be created only leaves this game unrecorded
+    // (a resumed game still has its own)
+    if (manager->replay && !session->replay) {
+        session->replay = replay_recorder_open(manager->replay, game->client_id);
+    }
     
-    // Play all levels with this client
-    int current_level = 0;
-    bool game_over = false;
-    board_t game_board = {0};
+    // Commands are read by the reactor from now on
+    if (reactor_add(manager->reactor, session, &game->task) < 0) {
+        debug("[Game %s] Failed to register client input\n", game->client_id);
+        session_detach(session);
+        return -1;
+    }
     
-    while (!game_over && current_level < manager->n_levels && manager->running) {
-        // Load level from file
-        if (load_level_from_file(&game_board, manager->level_dir, 
-                                 manager->level_files[current_level], 
-                                 session.accumulated_points) < 0) {
-            debug("[Manager %d] Error loading level: %s\n", 
-                  manager->id, manager->level_files[current_level]);
-            break;
+    debug("[Game %s] Client connected successfully!\n", game->client_id);
+    return 0;
+}
+
+/**
+ * The board not in play, which the next level is prefetched into.
+ */
+static board_t* spare_board(game_session_t* game) {
+    return game->board == &game->boards[0] ? &game->boards[1] : &game->boards[0];
+}
+
+/**
+ * Loads the current level and sends its first frame.
+ * Level 0 is loaded here; later levels were prefetched while the previous
+ * one was played, so starting them is a board swap.
+ * Returns 0 on success, -1 if the game cannot go on.
+ */
+static int start_level(game_session_t* game) {
+    game_manager_t* manager = game->manager;
+    const board_t* level = &manager->levels[game->current_level];
+    
+    if (game->prefetch.state != LEVEL_JOB_IDLE) {
+        if (level_loader_collect(manager->loader, &game->prefetch) < 0) {
+            debug("[Game %s] Error loading level: %s\n", game->client_id, level->level_name);
+            return -1;
         }
+        game->board = game->prefetch.board;
         
-        debug("[Manager %d] Loaded level %d: %s\n", 
-              manager->id, current_level, manager->level_files[current_level]);
-        print_board(&game_board);
-        
-        // Play the level (passes leaderboard for real-time updates)
-        int result = play_level_threaded(&game_board, &session, 
-                                         manager->leaderboard, lb_index);
-        
-        if (result == NEXT_LEVEL) {
-            session.accumulated_points = game_board.pacmans[0].points;
-            debug("[Manager %d] Level completed! Points: %d\n", 
-                  manager->id, session.accumulated_points);
-            
-            // Update leaderboard with current points
-            if (manager->leaderboard && lb_index >= 0) {
-                leaderboard_update_points(manager->leaderboard, lb_index, 
-                                         session.accumulated_points);
-            }
-            
-            current_level++;
+        // Prefetched before the points were known
+        game->board->pacmans[0].points = game->session.accumulated_points;
+    } else if (board_instantiate(game->board, level, game->session.accumulated_points) < 0) {
+        debug("[Game %s] Error loading level: %s\n", game->client_id, level->level_name);
+        return -1;
+    }
+    
+    debug("[Game %s] Loaded level %d: %s\n", game->client_id, game->current_level, level->level_name);
+    print_board(game->board);
+    
+    // Size the session's frame buffers once for this level
+    if (session_prepare_frames(&game->session, game->board) < 0) {
+        debug("[Game %s] Failed to allocate frame buffers\n", game->client_id);
+        unload_level(game->board);
+        return -1;
+    }
+    
+    game_set_level(&game->ctx, game->board, game->current_level,
+                   game->current_level == manager->n_levels - 1);
+    game->level_running = true;
+    
+    // Recovery replays the level from here (its random state included)
+    journal_t* journal = game->ctx.journal;
+    if (journal && journal_append_level(journal, game->client_id, game->current_level,
+                                        game->session.accumulated_points, game->board->rng) < 0) {
+        journal_abandon(journal, game->client_id, game->session.accumulated_points);
+        game->ctx.journal = NULL;
+    }
+    
+    // Load the next level in the background while this one is played
+    if (game->current_level + 1 < manager->n_levels) {
+        level_loader_submit(manager->loader, &game->prefetch,
+                            &manager->levels[game->current_level + 1], spare_board(game));
+    }
+    
+    return game_begin(&game->ctx);
+}
+
+/**
+ * Wraps up a level that left GAME_RUNNING.
+ * Returns true if the game goes on with the next level.
+ */
+static bool finish_level(game_session_t* game, game_state_t state) {
+    game_manager_t* manager = game->manager;
+    bool next_level = false;
+    
+    switch (state) {
+        case GAME_NEXT_LEVEL:
+        case GAME_WON:
+            game->session.accumulated_points = game->board->pacmans[0].points;
+            debug("[Game %s] Level completed! Points: %d\n", 
+                  game->client_id, game->session.accumulated_points);
+            game->current_level++;
             
             // Check if this was the last level
-            if (current_level >= manager->n_levels) {
-                debug("[Manager %d] All levels completed!\n", manager->id);
-                game_over = true;
+            if (game->current_level >= manager->n_levels) {
+                debug("[Game %s] All levels completed!\n", game->client_id);
+            } else {
+                next_level = true;
             }
+            break;
+        case GAME_OVER:
+            if (game->ctx.pacman_dead) {
+                debug("[Game %s] Pacman died - game over\n", game->client_id);
+            } else {
+                debug("[Game %s] Game over\n", game->client_id);
+            }
+            break;
+        case GAME_QUIT:
+            debug("[Game %s] Client quit the game\n", game->client_id);
+            break;
+        case GAME_CLIENT_DISCONNECTED:
+            debug("[Game %s] Client disconnected\n", game->client_id);
+            break;
+        default:
+            break;
+    }
+    
+    // Update leaderboard with current points
+    if (manager->leaderboard && game->lb_index >= 0) {
+        leaderboard_update_points(manager->leaderboard, game->lb_index, 
+                                 game->session.accumulated_points);
+    }
+    
+    game->level_end_time = game->ctx.last_frame_time;
+    unload_level(game->board);
+    game->level_running = false;
+    
+    return next_level;
+}
+
+/**
+ * Keeps the game of a client that disconnected mid-level for it to come
+ * back: drops the client's FIFOs and queues the game until the grace
+ * period ends. Returns false if games are not parked.
+ */
+static bool park_game(game_session_t* game, struct timespec* next_deadline) {
+    game_manager_t* manager = game->manager;
+    park_table_t* table = manager->parked;
+    if (table->grace_ms <= 0 || !game->level_running) {
+        return false;
+    }
+    
+    reactor_remove(manager->reactor, &game->session);
+    session_detach(&game->session);
+    clock_gettime(CLOCK_MONOTONIC, &game->park_deadline);
+    timespec_add_ms(&game->park_deadline, table->grace_ms);
+    game->parked = true;
+    
+    pthread_mutex_lock(&table->mutex);
+    game->park_state = PARKED;
+    park_insert(table, game);
+    int n_parked = table->n_parked;
+    pthread_mutex_unlock(&table->mutex);
+    
+    debug("[Game %s] Client disconnected, game parked for %d ms (%d parked)\n",
+          game->client_id, table->grace_ms, n_parked);
+    *next_deadline = game->park_deadline;
+    return true;
+}
+
+/**
+ * A run of a parked game: ends it once the grace period is over, or, once
+ * its client is back, accepts it and picks the level up again (with a
+ * keyframe). A client that cannot be accepted leaves the game parked for
+ * the rest of its grace period.
+ */
+static sched_result_t run_parked(game_session_t* game, struct timespec* next_deadline) {
+    park_table_t* table = game->manager->parked;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    
+    pthread_mutex_lock(&table->mutex);
+    park_state_t state = game->park_state;
+    bool expired = now.tv_sec > game->park_deadline.tv_sec ||
+                   (now.tv_sec == game->park_deadline.tv_sec &&
+                    now.tv_nsec >= game->park_deadline.tv_nsec);
+    if (state == PARKED && expired) {
+        park_unlink(table, game);
+        game->park_state = PARK_NONE;
+    }
+    pthread_mutex_unlock(&table->mutex);
+    
+    if (state == PARKED) {
+        if (!expired) {
+            // Woken early, by a resume that failed
+            *next_deadline = game->park_deadline;
+            return SCHED_TASK_CONTINUE;
         }
-        else if (result == QUIT_GAME) {
-            debug("[Manager %d] Client quit the game\n", manager->id);
-            game_over = true;
+        debug("[Game %s] Client did not come back, ending game\n", game->client_id);
+        end_game_session(game);
+        return SCHED_TASK_DONE;
+    }
+    
+    // The client is back (PARK_RESUMING)
+    int accepted = try_accept(game, next_deadline);
+    if (accepted > 0) {
+        return SCHED_TASK_CONTINUE;
+    }
+    pthread_mutex_lock(&table->mutex);
+    if (accepted < 0) {
+        game->park_state = PARKED;
+        park_insert(table, game);
+    } else {
+        game->park_state = PARK_NONE;
+    }
+    pthread_mutex_unlock(&table->mutex);
+    if (accepted < 0) {
+        debug("[Game %s] Failed to resume game, parking it again\n", game->client_id);
+        *next_deadline = game->park_deadline;
+        return SCHED_TASK_CONTINUE;
+    }
+    
+    game->parked = false;
+    debug("[Game %s] Client is back, resuming level %d\n", game->client_id, game->current_level);
+    if (session_prepare_frames(&game->session, game->board) < 0) {
+        debug("[Game %s] Failed to allocate frame buffers\n", game->client_id);
+        end_game_session(game);
+        return SCHED_TASK_DONE;
+    }
+    if (game_begin(&game->ctx) < 0) {
+        if (park_game(game, next_deadline)) {
+            return SCHED_TASK_CONTINUE;
         }
-        else if (result == CLIENT_DISCONNECTED) {
-            debug("[Manager %d] Client disconnected\n", manager->id);
-            game_over = true;
+        end_game_session(game);
+        return SCHED_TASK_DONE;
+    }
+    
+    *next_deadline = game->ctx.next_tick;
+    return SCHED_TASK_CONTINUE;
+}
+
+/**
+ * Ends a game once the client has its final frames. A slow client may not
+ * have read them yet; rather than have a worker wait on its FIFO, the game
+ * checks back every DRAIN_POLL_MS for up to DRAIN_TIMEOUT_MS.
+ */
+static sched_result_t drain_game(game_session_t* game, struct timespec* next_deadline) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (!game->draining) {
+        game->draining = true;
+        game->drain_deadline = now;
+        timespec_add_ms(&game->drain_deadline, DRAIN_TIMEOUT_MS);
+    }
+    
+    if (session_flush_output(&game->session) > 0 && elapsed_us(&now, &game->drain_deadline) > 0) {
+        *next_deadline = now;
+        timespec_add_ms(next_deadline, DRAIN_POLL_MS);
+        return SCHED_TASK_CONTINUE;
+    }
+    
+    end_game_session(game);
+    return SCHED_TASK_DONE;
+}
+
+/**
+ * Scheduler entry point: one tick of the game.
+ * The next level starts in the same run that ends the previous one.
+ */
+static sched_result_t game_session_run(sched_task_t* task, struct timespec* next_deadline) {
+    game_session_t* game = (game_session_t*)task;
+    bool level_changed = game->level_running;
+    
+    if (game->accepting) {
+        int accepted = try_accept(game, next_deadline);
+        if (accepted > 0) {
+            return SCHED_TASK_CONTINUE;
         }
-        else if (result == PACMAN_DIED) {
-            debug("[Manager %d] Pacman died - game over\n", manager->id);
-            // Update final score before game over
-            if (manager->leaderboard && lb_index >= 0) {
-                leaderboard_update_points(manager->leaderboard, lb_index, 
-                                         session.accumulated_points);
-            }
-            game_over = true;
+        if (accepted < 0) {
+            // Never played, so there is nothing to journal as over
+            release_game_session(game);
+            return SCHED_TASK_DONE;
+        }
+        game->accepting = false;
+    }
+    if (game->parked) {
+        return run_parked(game, next_deadline);
+    }
+    if (game->draining) {
+        return drain_game(game, next_deadline);
+    }
+    
+    if (game->level_running) {
+        game_state_t state = game_step(&game->ctx);
+        if (state == GAME_RUNNING) {
+            *next_deadline = game->ctx.next_tick;
+            return SCHED_TASK_CONTINUE;
         }
         
-        unload_level(&game_board);
+        if (state == GAME_CLIENT_DISCONNECTED && park_game(game, next_deadline)) {
+            return SCHED_TASK_CONTINUE;
+        }
+        
+        if (!finish_level(game, state)) {
+            return drain_game(game, next_deadline);
+        }
     }
     
-    // Cleanup session
-    debug("[Manager %d] Session ended. Final score: %d\n", 
-          manager->id, session.accumulated_points);
-    cleanup_session(&session);
+    if (start_level(game) < 0) {
+        // The level is still loaded if only its first frame failed
+        if (get_game_state(&game->ctx) == GAME_CLIENT_DISCONNECTED &&
+            park_game(game, next_deadline)) {
+            return SCHED_TASK_CONTINUE;
+        }
+        end_game_session(game);
+        return SCHED_TASK_DONE;
+    }
     
-    // Unregister from leaderboard
-    if (manager->leaderboard && lb_index >= 0) {
-        leaderboard_unregister(manager->leaderboard, lb_index);
+    // Level transition latency: last frame of the old level to first frame
+    // of the new one (both stamped by publish_frame)
+    if (level_changed) {
+        debug("[Game %s] Level transition took %ld us\n", game->client_id,
+              elapsed_us(&game->level_end_time, &game->ctx.last_frame_time));
     }
+    
+    *next_deadline = game->ctx.next_tick;
+    return SCHED_TASK_CONTINUE;
+}
+
+/**
+ * Scheduler entry point for games still queued at shutdown.
+ * Not journaled as over, so a journaled game is recovered at the next start.
+ */
+static void game_session_cancel(sched_task_t* task) {
+    game_session_t* game = (game_session_t*)task;
+    debug("[Game %s] Cancelled by server shutdown\n", game->client_id);
+    if (game->parked) {
+        park_table_t* table = game->manager->parked;
+        pthread_mutex_lock(&table->mutex);
+        if (game->park_state == PARKED) {
+            park_unlink(table, game);
+        }
+        pthread_mutex_unlock(&table->mutex);
+    }
+    release_game_session(game);
+}
+
+/**
+ * Allocates a game for the client, registered in the leaderboard, with its
+ * session and engine initialized (no FIFOs open and no slot taken yet).
+ * Returns NULL on allocation failure.
+ */
+static game_session_t* new_game_session(game_manager_t* manager, const char* client_id) {
+    game_session_t* game = calloc(1, sizeof(game_session_t));
+    if (!game) {
+        return NULL;
+    }
+    game->manager = manager;
+    game->board = &game->boards[0];
+    game->task.run = game_session_run;
+    game->task.cancel = game_session_cancel;
+    
+    // Client ID (from the pipe path) for the leaderboard, resuming and the journal
+    snprintf(game->client_id, sizeof(game->client_id), "%s", client_id);
+    
+    // Register in leaderboard
+    game->lb_index = -1;
+    if (manager->leaderboard) {
+        game->lb_index = leaderboard_register(manager->leaderboard, game->client_id);
+    }
+    
+    // Initialize session and the engine that plays all of its levels
+    init_session(&game->session);
+    init_game_context(&game->ctx, &game->session);
+    set_game_leaderboard(&game->ctx, manager->leaderboard, game->lb_index);
+    set_game_snapshots(&game->ctx, manager->snapshots, game->client_id);
+    if (manager->journal) {
+        set_game_journal(&game->ctx, manager->journal, game->client_id);
+    }
+    
+    return game;
+}
+
+/**
+ * Frees a game that never reached the scheduler.
+ */
+static void free_game_session(game_session_t* game) {
+    game_manager_t* manager = game->manager;
+    cleanup_session(&game->session);
+    if (manager->leaderboard && game->lb_index >= 0) {
+        leaderboard_unregister(manager->leaderboard, game->lb_index);
+    }
+    free(game);
+}
+
+// =============================================================================
+// Game Manager Thread
+// =============================================================================
+
+/**
+ * Hands a client to a new game, or back to its parked game.
+ * The game opens the client's FIFOs in its own runs, so a client that is
+ * slow to open them (or never does) costs the manager nothing.
+ * The caller holds a game slot, which a new game releases when it ends.
+ * Returns 0 if a new game was scheduled, -1 if the slot is still the
+ * caller's (also after a resume: the parked game has a slot of its own).
+ */
+static int start_client_session(game_manager_t* manager, connection_request_t* request) {
+    debug("[Manager %d] Handling new client session\n", manager->id);
+    debug("[Manager %d] req_pipe: %s\n", manager->id, request->req_pipe_path);
+    debug("[Manager %d] notif_pipe: %s\n", manager->id, request->notif_pipe_path);
+    
+    char client_id[MAX_CLIENT_ID_LENGTH + 1];
+    extract_client_id(request->req_pipe_path, client_id, sizeof(client_id));
+    game_session_t* parked = park_claim(manager->parked, client_id, request);
+    if (parked) {
+        debug("[Manager %d] Client %s has a parked game, resuming it\n", manager->id, client_id);
+        
+        // Run it now rather than when its grace period ends
+        scheduler_wake(manager->scheduler, &parked->task);
+        return -1;
+    }
+    
+    game_session_t* game = new_game_session(manager, client_id);
+    if (!game) {
+        debug("[Manager %d] Failed to allocate game session\n", manager->id);
+        return -1;
+    }
+    begin_accept(game, request);
+    game->accepting = true;
+    
+    // The first runs accept the client and load level 0; the game now
+    // belongs to the scheduler
+    if (scheduler_submit(manager->scheduler, &game->task, NULL) < 0) {
+        debug("[Manager %d] Failed to schedule game\n", manager->id);
+        free_game_session(game);
+        return -1;
+    }
+    
+    return 0;
 }
 
 /**
  * Game manager thread function.
- * Consumes connection requests from buffer and handles sessions.
+ * Waits for a free game slot, then consumes a connection request from the
+ * buffer and starts the client's game.
  */
 void* game_manager_thread_func(void* arg) {
     game_manager_t* manager = (game_manager_t*)arg;
@@ -175,6 +720,18 @@ void* game_manager_thread_func(void* arg) {
     debug("[Manager %d] Thread started\n", manager->id);
     
     while (manager->running) {
+        // Requests stay in the buffer while all games slots are taken
+        if (sem_wait(manager->game_slots) != 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (!manager->running) {
+            sem_post(manager->game_slots);
+            break;
+        }
+        
         // Wait for a connection request from the buffer
         connection_request_t request;
         
@@ -183,80 +740,233 @@ void* game_manager_thread_func(void* arg) {
         if (pc_buffer_remove(manager->request_buffer, &request) < 0) {
             // Buffer shutdown or error
             debug("[Manager %d] Buffer remove failed, exiting\n", manager->id);
+            sem_post(manager->game_slots);
             break;
         }
         
-        // Handle the client session
-        manager->active = true;
-        handle_client_session(manager, &request);
-        manager->active = false;
+        // Start the client's game; from here on the game owns the slot
+        if (start_client_session(manager, &request) < 0) {
+            sem_post(manager->game_slots);
+        }
     }
     
     debug("[Manager %d] Thread exiting\n", manager->id);
     return NULL;
 }
 
+/**
+ * Raise the open file limit so every game slot can hold its FIFOs.
+ */
+static void raise_fd_limit(int max_games) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+        return;
+    }
+    
+    rlim_t wanted = (rlim_t)max_games * FDS_PER_GAME + 64;
+    if (limit.rlim_cur >= wanted) {
+        return;
+    }
+    
+    rlim_t old_limit = limit.rlim_cur;
+    limit.rlim_cur = (limit.rlim_max == RLIM_INFINITY || limit.rlim_max > wanted) ? wanted : limit.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &limit) != 0) {
+        limit.rlim_cur = old_limit;
+    }
+    if (limit.rlim_cur < wanted) {
+        debug("[Server] Open file limit is %lu, %d games need %lu\n", 
+              (unsigned long)limit.rlim_cur, max_games, (unsigned long)wanted);
+    }
+}
+
+/**
+ * Parse every level and its behaviour files once. Sessions copy these
+ * templates instead of reading the files again. Invalid levels are left
+ * out of the rotation.
+ * Returns 0 on success, -1 if no level is valid.
+ */
+static int load_level_templates(server_context_t* ctx) {
+    int n_valid = 0;
+    for (int i = 0; i < ctx->n_levels; i++) {
+        if (load_level_from_file(&ctx->levels[n_valid], ctx->level_dir, ctx->level_files[i], 0) < 0) {
+            debug("[Server] Skipping invalid level %s\n", ctx->level_files[i]);
+            continue;
+        }
+        n_valid++;
+    }
+    ctx->n_levels = n_valid;
+    
+    if (n_valid == 0) {
+        debug("[Server] No valid levels\n");
+        return -1;
+    }
+    debug("[Server] Loaded %d level templates\n", n_valid);
+    return 0;
+}
+
+static void unload_level_templates(server_context_t* ctx) {
+    for (int i = 0; i < ctx->n_levels; i++) {
+        unload_level(&ctx->levels[i]);
+    }
+}
+
 // =============================================================================
-// Play Level (moved from game.c to be accessible here)
+// Journal Recovery (at startup, before any client is accepted)
 // =============================================================================
 
 /**
- * Play one level using threads with a connected client.
- * Returns: NEXT_LEVEL, QUIT_GAME, PACMAN_DIED, or CLIENT_DISCONNECTED
+ * Rebuilds the board of a journaled game: its base (the level fresh from
+ * the template, or a checkpoint) plus every journaled input. Ticks after the
+ * last input only moved the ghosts and were not journaled, so the game
+ * resumes as it was after that input.
+ * Returns the tick the board is at, or -1 if the journal does not fit the
+ * levels anymore or the game was already over.
  */
-static int play_level_threaded(board_t* game_board, client_session_t* session,
-                               leaderboard_t* lb, int lb_index) {
-    game_context_t ctx;
+static long replay_journal(game_session_t* game, const journal_game_t* saved) {
+    game_manager_t* manager = game->manager;
+    if (saved->level < 0 || saved->level >= manager->n_levels) {
+        return -1;
+    }
     
-    if (init_game_context(&ctx, game_board, session) < 0) {
-        debug("Error: Failed to initialize game context\n");
-        return QUIT_GAME;
+    game->current_level = saved->level;
+    if (board_instantiate(game->board, &manager->levels[saved->level], saved->points) < 0) {
+        return -1;
+    }
+    if (!saved->checkpoint) {
+        game->board->rng = saved->rng;
+    } else if (board_restore(game->board, saved->checkpoint, saved->checkpoint_size) < 0) {
+        unload_level(game->board);
+        return -1;
     }
     
-    // Set leaderboard for real-time score updates
-    set_game_leaderboard(&ctx, lb, lb_index);
+    long tick = (long)saved->base_tick;
+    tick_result_t result = TICK_PLAYING;
+    for (size_t next = 0; next < saved->n_inputs && result == TICK_PLAYING; ) {
+        tick++;
+        char move = 0;
+        if (saved->inputs[next].tick <= tick) {
+            move = saved->inputs[next++].command;
+        }
+        result = simulate_tick(game->board, move);
+    }
     
-    // Start all game threads
-    if (start_game_threads(&ctx) < 0) {
-        debug("Error: Failed to start game threads\n");
-        cleanup_game_context(&ctx);
-        return QUIT_GAME;
+    int points = game->board->pacmans[0].points;
+    if (result == TICK_PLAYING) {
+        return tick;
     }
+    unload_level(game->board);
     
-    // Wait for game to end (threads will set state)
-    game_state_t final_state;
-    while (ctx.threads_running) {
-        sleep_ms(50);  // Check periodically
-        
-        final_state = get_game_state(&ctx);
-        if (final_state != GAME_RUNNING) {
-            break;
+    // The crash came before the next level was journaled: start it afresh
+    if (result == TICK_PORTAL && game->current_level + 1 < manager->n_levels) {
+        game->current_level++;
+        if (board_instantiate(game->board, &manager->levels[game->current_level], points) < 0) {
+            return -1;
         }
+        return 0;
+    }
+    return -1;
+}
+
+/**
+ * Puts a journaled game back as a parked game, for its client to resume
+ * within the grace period. Checkpoints it into the new journal.
+ * Returns 0 on success, -1 if the game could not be recovered.
+ */
+static int recover_game(game_manager_t* manager, const journal_game_t* saved) {
+    if (sem_trywait(manager->game_slots) != 0) {
+        debug("[Server] No game slot left to recover %s\n", saved->client_id);
+        return -1;
     }
     
-    // Get final state before stopping threads
-    final_state = get_game_state(&ctx);
-    bool pacman_died = ctx.pacman_dead;
+    game_session_t* game = new_game_session(manager, saved->client_id);
+    if (!game) {
+        sem_post(manager->game_slots);
+        return -1;
+    }
     
-    // Stop all threads
-    stop_game_threads(&ctx);
-    cleanup_game_context(&ctx);
+    long tick = replay_journal(game, saved);
+    if (tick < 0) {
+        debug("[Server] Journal of %s cannot be replayed, dropping it\n", saved->client_id);
+        free_game_session(game);
+        sem_post(manager->game_slots);
+        return -1;
+    }
     
-    // Convert game state to return value
-    switch (final_state) {
-        case GAME_NEXT_LEVEL:
-            return NEXT_LEVEL;
-        case GAME_QUIT:
-            return QUIT_GAME;
-        case GAME_CLIENT_DISCONNECTED:
-            return CLIENT_DISCONNECTED;
-        case GAME_OVER:
-            return pacman_died ? PACMAN_DIED : QUIT_GAME;
-        case GAME_WON:
-            return NEXT_LEVEL;
-        default:
-            return QUIT_GAME;
+    game->session.accumulated_points = game->board->pacmans[0].points;
+    if (manager->leaderboard && game->lb_index >= 0) {
+        leaderboard_update_points(manager->leaderboard, game->lb_index,
+                                 game->session.accumulated_points);
+    }
+    game_set_level(&game->ctx, game->board, game->current_level,
+                   game->current_level == manager->n_levels - 1);
+    game->ctx.tick = tick;
+    game->level_running = true;
+    journal_append_checkpoint(manager->journal, game->client_id, game->current_level,
+                              tick, game->board);
+    
+    if (manager->replay) {
+        game->session.replay = replay_recorder_open(manager->replay, game->client_id);
     }
+    
+    struct timespec deadline;
+    park_game(game, &deadline);
+    if (scheduler_submit(manager->scheduler, &game->task, &deadline) < 0) {
+        pthread_mutex_lock(&manager->parked->mutex);
+        park_unlink(manager->parked, game);
+        pthread_mutex_unlock(&manager->parked->mutex);
+        unload_level(game->board);
+        free_game_session(game);
+        sem_post(manager->game_slots);
+        return -1;
+    }
+    
+    debug("[Server] Recovered game of %s: level %d, tick %ld, %d points\n", game->client_id,
+          game->current_level, tick, game->session.accumulated_points);
+    return 0;
+}
+
+/**
+ * Starts the journal: replays the old one into parked games, checkpoints
+ * them into a new journal and installs it.
+ * Returns 0 on success, -1 if the server cannot journal.
+ */
+static int start_journal(server_context_t* ctx) {
+    journal_game_t* games;
+    int n_games = journal_read(ctx->journal_path, &games);
+    if (n_games < 0) {
+        debug("[Server] Failed to read journal %s: %s\n", ctx->journal_path, strerror(errno));
+        return -1;
+    }
+    
+    if (journal_start(&ctx->journal) < 0) {
+        journal_free_games(games);
+        return -1;
+    }
+    
+    // A recovered game waits for its client like any parked game
+    int n_unfinished = 0;
+    int n_recovered = 0;
+    for (journal_game_t* saved = games; saved; saved = saved->next) {
+        if (saved->ended) {
+            continue;
+        }
+        n_unfinished++;
+        if (ctx->parked.grace_ms <= 0) {
+            debug("[Server] Games are not parked, dropping the game of %s\n", saved->client_id);
+            continue;
+        }
+        if (recover_game(&ctx->managers[0], saved) == 0) {
+            n_recovered++;
+        }
+    }
+    journal_free_games(games);
+    
+    if (journal_install(&ctx->journal) < 0) {
+        journal_shutdown(&ctx->journal);
+        return -1;
+    }
+    debug("[Server] Recovered %d of %d unfinished journaled games\n", n_recovered, n_unfinished);
+    return 0;
 }
 
 // =============================================================================
@@ -264,16 +974,23 @@ static int play_level_threaded(board_t* game_board, client_session_t* session,
 // =============================================================================
 
 int server_init(server_context_t* ctx, int max_games, const char* level_dir, 
-                const char* server_fifo_path, char** level_files, int n_levels) {
+                const char* server_fifo_path, char** level_files, int n_levels,
+                const char* replay_dir, int park_grace_ms, const char* journal_path) {
     
     ctx->max_games = max_games;
     ctx->level_dir = level_dir;
+    ctx->replay_dir = replay_dir;
+    ctx->journal_path = journal_path;
     ctx->server_fifo_path = server_fifo_path;
     ctx->level_files = level_files;
     ctx->n_levels = n_levels;
     ctx->running = false;
     ctx->server_fd = -1;
+    ctx->server_keepalive_fd = -1;
     ctx->n_managers = 0;
+    memset(ctx->parked.buckets, 0, sizeof(ctx->parked.buckets));
+    ctx->parked.n_parked = 0;
+    ctx->parked.grace_ms = park_grace_ms;
     
     // Limit max_games to our maximum
     if (max_games > MAX_CONCURRENT_GAMES) {
@@ -281,28 +998,171 @@ int server_init(server_context_t* ctx, int max_games, const char* level_dir,
         ctx->max_games = MAX_CONCURRENT_GAMES;
     }
     
+    // Initialize host wake pipe (written from the signal handler, so never blocks)
+    if (pipe(ctx->host_wake_pipe) < 0 ||
+        fcntl(ctx->host_wake_pipe[1], F_SETFL, O_NONBLOCK) < 0) {
+        debug("[Server] Failed to create host wake pipe: %s\n", strerror(errno));
+        return -1;
+    }
+    
     // Initialize producer-consumer buffer
-    if (pc_buffer_init(&ctx->request_buffer) < 0) {
+    if (pc_buffer_init(&ctx->request_buffer, PC_BUFFER_SIZE) < 0) {
         debug("[Server] Failed to initialize request buffer\n");
+        close(ctx->host_wake_pipe[0]);
+        close(ctx->host_wake_pipe[1]);
         return -1;
     }
     
     // Initialize leaderboard
-    if (leaderboard_init(&ctx->leaderboard) < 0) {
+    if (leaderboard_init(&ctx->leaderboard, ctx->max_games) < 0) {
         debug("[Server] Failed to initialize leaderboard\n");
         pc_buffer_destroy(&ctx->request_buffer);
+        close(ctx->host_wake_pipe[0]);
+        close(ctx->host_wake_pipe[1]);
+        return -1;
+    }
+    
+    // Initialize scheduler (one worker per core) and the game slots
+    if (scheduler_init(&ctx->scheduler, 0, ctx->max_games) < 0) {
+        debug("[Server] Failed to initialize scheduler\n");
+        leaderboard_destroy(&ctx->leaderboard);
+        pc_buffer_destroy(&ctx->request_buffer);
+        close(ctx->host_wake_pipe[0]);
+        close(ctx->host_wake_pipe[1]);
+        return -1;
+    }
+    
+    if (sem_init(&ctx->game_slots, 0, (unsigned int)ctx->max_games) != 0) {
+        debug("[Server] Failed to initialize game slots: %s\n", strerror(errno));
+        scheduler_destroy(&ctx->scheduler);
+        leaderboard_destroy(&ctx->leaderboard);
+        pc_buffer_destroy(&ctx->request_buffer);
+        close(ctx->host_wake_pipe[0]);
+        close(ctx->host_wake_pipe[1]);
+        return -1;
+    }
+    
+    // Initialize input reactor (one registration per game slot)
+    if (reactor_init(&ctx->reactor, &ctx->scheduler, ctx->max_games) < 0) {
+        debug("[Server] Failed to initialize input reactor\n");
+        sem_destroy(&ctx->game_slots);
+        scheduler_destroy(&ctx->scheduler);
+        leaderboard_destroy(&ctx->leaderboard);
+        pc_buffer_destroy(&ctx->request_buffer);
+        close(ctx->host_wake_pipe[0]);
+        close(ctx->host_wake_pipe[1]);
         return -1;
     }
     
+    if (level_loader_init(&ctx->level_loader) < 0) {
+        debug("[Server] Failed to initialize level loader\n");
+        reactor_destroy(&ctx->reactor);
+        sem_destroy(&ctx->game_slots);
+        scheduler_destroy(&ctx->scheduler);
+        leaderboard_destroy(&ctx->leaderboard);
+        pc_buffer_destroy(&ctx->request_buffer);
+        close(ctx->host_wake_pipe[0]);
+        close(ctx->host_wake_pipe[1]);
+        return -1;
+    }
+    
+    if (replay_writer_init(&ctx->replay_writer, replay_dir) < 0) {
+        debug("[Server] Failed to initialize replay writer\n");
+        level_loader_destroy(&ctx->level_loader);
+        reactor_destroy(&ctx->reactor);
+        sem_destroy(&ctx->game_slots);
+        scheduler_destroy(&ctx->scheduler);
+        leaderboard_destroy(&ctx->leaderboard);
+        pc_buffer_destroy(&ctx->request_buffer);
+        close(ctx->host_wake_pipe[0]);
+        close(ctx->host_wake_pipe[1]);
+        return -1;
+    }
+    
+    if (journal_init(&ctx->journal, journal_path) < 0) {
+        debug("[Server] Failed to initialize journal\n");
+        replay_writer_destroy(&ctx->replay_writer);
+        level_loader_destroy(&ctx->level_loader);
+        reactor_destroy(&ctx->reactor);
+        sem_destroy(&ctx->game_slots);
+        scheduler_destroy(&ctx->scheduler);
+        leaderboard_destroy(&ctx->leaderboard);
+        pc_buffer_destroy(&ctx->request_buffer);
+        close(ctx->host_wake_pipe[0]);
+        close(ctx->host_wake_pipe[1]);
+        return -1;
+    }
+    
+    if (pthread_mutex_init(&ctx->parked.mutex, NULL) != 0) {
+        debug("[Server] Failed to initialize park table\n");
+        journal_destroy(&ctx->journal);
+        replay_writer_destroy(&ctx->replay_writer);
+        level_loader_destroy(&ctx->level_loader);
+        reactor_destroy(&ctx->reactor);
+        sem_destroy(&ctx->game_slots);
+        scheduler_destroy(&ctx->scheduler);
+        leaderboard_destroy(&ctx->leaderboard);
+        pc_buffer_destroy(&ctx->request_buffer);
+        close(ctx->host_wake_pipe[0]);
+        close(ctx->host_wake_pipe[1]);
+        return -1;
+    }
+    
+    // Before any thread exists, so that all of them block SIGCHLD
+    if (snapshot_manager_init(&ctx->snapshots) < 0) {
+        pthread_mutex_destroy(&ctx->parked.mutex);
+        debug("[Server] Failed to initialize quicksaves\n");
+        journal_destroy(&ctx->journal);
+        replay_writer_destroy(&ctx->replay_writer);
+        level_loader_destroy(&ctx->level_loader);
+        reactor_destroy(&ctx->reactor);
+        sem_destroy(&ctx->game_slots);
+        scheduler_destroy(&ctx->scheduler);
+        leaderboard_destroy(&ctx->leaderboard);
+        pc_buffer_destroy(&ctx->request_buffer);
+        close(ctx->host_wake_pipe[0]);
+        close(ctx->host_wake_pipe[1]);
+        return -1;
+    }
+    
+    // Parse every level once (validated here, not when a player reaches it)
+    // before the managers learn how many there are
+    if (load_level_templates(ctx) < 0) {
+        snapshot_manager_destroy(&ctx->snapshots);
+        pthread_mutex_destroy(&ctx->parked.mutex);
+        journal_destroy(&ctx->journal);
+        replay_writer_destroy(&ctx->replay_writer);
+        level_loader_destroy(&ctx->level_loader);
+        reactor_destroy(&ctx->reactor);
+        sem_destroy(&ctx->game_slots);
+        scheduler_destroy(&ctx->scheduler);
+        leaderboard_destroy(&ctx->leaderboard);
+        pc_buffer_destroy(&ctx->request_buffer);
+        close(ctx->host_wake_pipe[0]);
+        close(ctx->host_wake_pipe[1]);
+        return -1;
+    }
+    
+    raise_fd_limit(ctx->max_games);
+    
+    // Managers only accept clients, so a few of them serve every game slot
+    ctx->n_managers = ctx->max_games < MAX_GAME_MANAGERS ? ctx->max_games : MAX_GAME_MANAGERS;
+    
     // Initialize manager structures
-    for (int i = 0; i < ctx->max_games; i++) {
+    for (int i = 0; i < ctx->n_managers; i++) {
         ctx->managers[i].id = i;
         ctx->managers[i].request_buffer = &ctx->request_buffer;
-        ctx->managers[i].level_files = level_files;
-        ctx->managers[i].n_levels = n_levels;
-        ctx->managers[i].level_dir = level_dir;
+        ctx->managers[i].scheduler = &ctx->scheduler;
+        ctx->managers[i].reactor = &ctx->reactor;
+        ctx->managers[i].loader = &ctx->level_loader;
+        ctx->managers[i].replay = replay_dir ? &ctx->replay_writer : NULL;
+        ctx->managers[i].snapshots = &ctx->snapshots;
+        ctx->managers[i].parked = &ctx->parked;
+        ctx->managers[i].journal = journal_path ? &ctx->journal : NULL;
+        ctx->managers[i].game_slots = &ctx->game_slots;
+        ctx->managers[i].levels = ctx->levels;
+        ctx->managers[i].n_levels = ctx->n_levels;
         ctx->managers[i].leaderboard = &ctx->leaderboard;  // Share leaderboard
-        ctx->managers[i].active = false;
         ctx->managers[i].running = false;
     }
     
@@ -311,9 +1171,53 @@ int server_init(server_context_t* ctx, int max_games, const char* level_dir,
 }
 
 int server_start_managers(server_context_t* ctx) {
-    debug("[Server] Starting %d game manager threads\n", ctx->max_games);
+    // Start the workers that play the games
+    if (scheduler_start(&ctx->scheduler) < 0) {
+        debug("[Server] Failed to start scheduler\n");
+        return -1;
+    }
+    
+    // Start the thread that reads every client's commands
+    if (reactor_start(&ctx->reactor) < 0) {
+        debug("[Server] Failed to start input reactor\n");
+        scheduler_shutdown(&ctx->scheduler);
+        return -1;
+    }
+    
+    // Start the thread that prefetches levels
+    if (level_loader_start(&ctx->level_loader) < 0) {
+        debug("[Server] Failed to start level loader\n");
+        reactor_shutdown(&ctx->reactor);
+        scheduler_shutdown(&ctx->scheduler);
+        return -1;
+    }
+    
+    // Start the thread that writes the replays
+    if (ctx->replay_dir && replay_writer_start(&ctx->replay_writer) < 0) {
+        debug("[Server] Failed to start replay writer\n");
+        level_loader_shutdown(&ctx->level_loader);
+        reactor_shutdown(&ctx->reactor);
+        scheduler_shutdown(&ctx->scheduler);
+        return -1;
+    }
+    
+    // Recover the journaled games, then journal from here on
+    if (ctx->journal_path && start_journal(ctx) < 0) {
+        debug("[Server] Failed to start journal\n");
+        scheduler_shutdown(&ctx->scheduler);
+        if (ctx->replay_dir) {
+            replay_writer_shutdown(&ctx->replay_writer);
+        }
+        level_loader_shutdown(&ctx->level_loader);
+        reactor_shutdown(&ctx->reactor);
+        return -1;
+    }
     
-    for (int i = 0; i < ctx->max_games; i++) {
+    int n_managers = ctx->n_managers;
+    ctx->n_managers = 0;
+    debug("[Server] Starting %d game manager threads\n", n_managers);
+    
+    for (int i = 0; i < n_managers; i++) {
         ctx->managers[i].running = true;
         
         if (pthread_create(&ctx->managers[i].thread, NULL, 
@@ -349,6 +1253,34 @@ void server_run_host(server_context_t* ctx) {
     }
     debug("[Host] Created server FIFO: %s\n", ctx->server_fifo_path);
     
+    // Open the FIFO once for the server's lifetime. A non-blocking open of the
+    // read end does not wait for a client, and holding a write end ourselves
+    // means the FIFO never reports end of file between clients, so requests
+    // from clients connecting at the same time are never lost.
+    ctx->server_fd = open(ctx->server_fifo_path, O_RDONLY | O_NONBLOCK);
+    if (ctx->server_fd < 0) {
+        debug("[Host] Failed to open server FIFO: %s\n", strerror(errno));
+        return;
+    }
+    ctx->server_keepalive_fd = open(ctx->server_fifo_path, O_WRONLY);
+    if (ctx->server_keepalive_fd < 0) {
+        debug("[Host] Failed to open server FIFO for writing: %s\n", strerror(errno));
+        close(ctx->server_fd);
+        ctx->server_fd = -1;
+        return;
+    }
+    debug("[Host] Server FIFO opened for reading\n");
+    
+    // Connection request: (char)OP_CODE | (char[40])req_pipe | (char[40])notif_pipe
+    // Clients write each request at once (smaller than PIPE_BUF), so reads
+    // return whole requests; an incomplete tail is kept for the next read.
+    char buffer[HOST_READ_BATCH * CONNECT_REQUEST_SIZE];
+    size_t pending = 0;
+    connection_request_t requests[HOST_READ_BATCH];
+    int n_requests = 0;                 // Parsed from the last read
+    int n_queued = 0;                   // Of those, handed to the managers
+    bool watching = false;              // Waiting for room in the request buffer
+    
     while (ctx->running) {
         // Check if SIGUSR1 was received - write top 5 file immediately
         if (check_and_clear_sigusr1()) {
@@ -358,75 +1290,126 @@ void server_run_host(server_context_t* ctx) {
             } else {
                 debug("[Host] Leaderboard written to top5.txt\n");
             }
+            debug("[Host] Level prefetch: %ld hits, %ld misses\n",
+                  atomic_load(&ctx->level_loader.hits), atomic_load(&ctx->level_loader.misses));
+        }
+        
+        // Hand the requests to the managers, as many as the buffer has room
+        // for; the rest wait for room in poll, with the host free meanwhile
+        if (n_queued < n_requests && !watching) {
+            int inserted = pc_buffer_try_insert_many(&ctx->request_buffer, requests + n_queued,
+                                                     n_requests - n_queued);
+            if (inserted < 0) {
+                debug("[Host] Failed to insert requests into buffer\n");
+                break;
+            }
+            n_queued += inserted;
+            if (n_queued < n_requests && !(watching = pc_buffer_watch_not_full(&ctx->request_buffer))) {
+                continue;  // Room was freed meanwhile
+            }
         }
         
         debug("\n[Host] === Waiting for client connection ===\n");
         
-        // Open server FIFO for reading (blocks until a client connects)
-        ctx->server_fd = open(ctx->server_fifo_path, O_RDONLY);
-        if (ctx->server_fd < 0) {
+        // Wait for requests (once the last ones are all handed over), room
+        // for them, exited quicksave children or for shutdown
+        // (SIGUSR1 interrupts the poll)
+        struct pollfd fds[4] = {
+            { .fd = n_queued < n_requests ? -1 : ctx->server_fd, .events = POLLIN },
+            { .fd = ctx->host_wake_pipe[0], .events = POLLIN },
+            { .fd = ctx->snapshots.signal_fd, .events = POLLIN },
+            { .fd = watching ? ctx->request_buffer.not_full_fd : -1, .events = POLLIN }
+        };
+        if (poll(fds, 4, -1) < 0) {
             if (errno == EINTR) {
-                // Interrupted by signal - check for SIGUSR1
-                continue;
+                continue;  // Go back to check for SIGUSR1
             }
-            debug("[Host] Failed to open server FIFO: %s\n", strerror(errno));
+            debug("[Host] Failed to poll server FIFO: %s\n", strerror(errno));
             break;
         }
-        debug("[Host] Server FIFO opened for reading\n");
-        
-        // Read connection request from client
-        // Format: (char)OP_CODE | (char[40])req_pipe | (char[40])notif_pipe
-        char buffer[CONNECT_REQUEST_SIZE];
-        ssize_t bytes_read = read(ctx->server_fd, buffer, sizeof(buffer));
-        
-        // Close server FIFO (we'll reopen it for next client)
-        close(ctx->server_fd);
-        ctx->server_fd = -1;
-        
-        // Check for signal interruption
-        if (bytes_read < 0 && errno == EINTR) {
-            continue;  // Go back to check for SIGUSR1
+        if (fds[1].revents & POLLIN) {
+            continue;  // Shutdown requested - running is already false
         }
-        
-        if (bytes_read <= 0) {
-            debug("[Host] Failed to read from server FIFO\n");
-            continue;
+        if (fds[2].revents & POLLIN) {
+            snapshot_reap(&ctx->snapshots);
         }
-        
-        if (bytes_read != sizeof(buffer)) {
-            debug("[Host] Incomplete connection request: %zd bytes\n", bytes_read);
-            continue;
+        if (fds[3].revents & POLLIN) {
+            pc_buffer_unwatch_not_full(&ctx->request_buffer);
+            watching = false;
         }
-        
-        // Verify OP_CODE
-        if (buffer[0] != OP_CODE_CONNECT) {
-            debug("[Host] Invalid OP_CODE: %d\n", buffer[0]);
+        if (!(fds[0].revents & POLLIN)) {
             continue;
         }
         
-        // Extract pipe paths
-        connection_request_t request;
-        memcpy(request.req_pipe_path, &buffer[1], MAX_PIPE_PATH_LENGTH);
-        request.req_pipe_path[MAX_PIPE_PATH_LENGTH] = '\0';
-        memcpy(request.notif_pipe_path, &buffer[1 + MAX_PIPE_PATH_LENGTH], MAX_PIPE_PATH_LENGTH);
-        request.notif_pipe_path[MAX_PIPE_PATH_LENGTH] = '\0';
-        
-        debug("[Host] Received connection request:\n");
-        debug("[Host]   req_pipe: %s\n", request.req_pipe_path);
-        debug("[Host]   notif_pipe: %s\n", request.notif_pipe_path);
+        ssize_t bytes_read = read(ctx->server_fd, buffer + pending, sizeof(buffer) - pending);
+        if (bytes_read < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) {
+                continue;
+            }
+            debug("[Host] Failed to read from server FIFO: %s\n", strerror(errno));
+            break;
+        }
         
-        // Insert into buffer (will block if buffer is full)
-        if (pc_buffer_insert(&ctx->request_buffer, &request) < 0) {
-            debug("[Host] Failed to insert request into buffer\n");
-            continue;
+        // Split the chunk into connection requests. The FIFO stays open for
+        // the server's lifetime, so bytes that are not a valid request
+        // (a stray write, a short one) are skipped up to the next
+        // OP_CODE_CONNECT, keeping the requests after them aligned
+        size_t available = pending + (size_t)bytes_read;
+        size_t offset = 0;
+        n_requests = 0;
+        n_queued = 0;
+        while (offset < available) {
+            const char* record = buffer + offset;
+            bool valid = record[0] == OP_CODE_CONNECT;
+            if (valid && available - offset < CONNECT_REQUEST_SIZE) {
+                break;  // Rest of the request comes with the next read
+            }
+            if (valid) {
+                valid = valid_pipe_path(&record[1]) &&
+                        valid_pipe_path(&record[1 + MAX_PIPE_PATH_LENGTH]);
+            }
+            if (!valid) {
+                const char* next = memchr(record + 1, OP_CODE_CONNECT, available - offset - 1);
+                size_t skipped = next ? (size_t)(next - record) : available - offset;
+                debug("[Host] Invalid connection request (OP_CODE %d), skipped %zu bytes\n",
+                      record[0], skipped);
+                offset += skipped;
+                continue;
+            }
+            
+            // Extract pipe paths
+            connection_request_t* request = &requests[n_requests++];
+            memcpy(request->req_pipe_path, &record[1], MAX_PIPE_PATH_LENGTH);
+            request->req_pipe_path[MAX_PIPE_PATH_LENGTH] = '\0';
+            memcpy(request->notif_pipe_path, &record[1 + MAX_PIPE_PATH_LENGTH], MAX_PIPE_PATH_LENGTH);
+            request->notif_pipe_path[MAX_PIPE_PATH_LENGTH] = '\0';
+            offset += CONNECT_REQUEST_SIZE;
         }
+        pending = available - offset;
+        memmove(buffer, buffer + offset, pending);
         
-        debug("[Host] Request inserted into buffer\n");
+        if (n_requests > 0) {
+            debug("[Host] Received %d connection request(s)\n", n_requests);
+        }
     }
     
+    close(ctx->server_keepalive_fd);
+    ctx->server_keepalive_fd = -1;
+    close(ctx->server_fd);
+    ctx->server_fd = -1;
+    
     debug("[Host] Host thread exiting\n");
 }
 
+void server_request_shutdown(server_context_t* ctx) {
+    ctx->running = false;
+    
+    char byte = 0;
+    if (write(ctx->host_wake_pipe[1], &byte, 1) < 0) {
+        // Pipe full - the host is being woken already
+    }
+}
+
 void server_shutdown(server_context_t* ctx) {
     debug("[Server] Shutting down...\n");
     
@@ -441,10 +1424,13 @@ void server_shutdown(server_context_t* ctx) {
     // Shutdown buffer to wake up all waiting managers
     pc_buffer_shutdown(&ctx->request_buffer);
     
-    // Signal managers to stop
+    // Signal managers to stop, waking those waiting for a game slot
     for (int i = 0; i < ctx->n_managers; i++) {
         ctx->managers[i].running = false;
     }
+    for (int i = 0; i < ctx->n_managers; i++) {
+        sem_post(&ctx->game_slots);
+    }
     
     // Wait for all manager threads to finish
     for (int i = 0; i < ctx->n_managers; i++) {
@@ -452,12 +1438,37 @@ void server_shutdown(server_context_t* ctx) {
         debug("[Server] Manager %d joined\n", i);
     }
     
+    // Stop the workers and end the games still being played,
+    // then the reactor that fed them input and the loader.
+    // The games closed their replays, so the writer can drain and stop
+    scheduler_shutdown(&ctx->scheduler);
+    reactor_shutdown(&ctx->reactor);
+    level_loader_shutdown(&ctx->level_loader);
+    snapshot_manager_shutdown(&ctx->snapshots);
+    if (ctx->replay_dir) {
+        replay_writer_shutdown(&ctx->replay_writer);
+    }
+    if (ctx->journal_path) {
+        journal_shutdown(&ctx->journal);
+    }
+    
     debug("[Server] All threads stopped\n");
 }
 
 void server_cleanup(server_context_t* ctx) {
+    snapshot_manager_destroy(&ctx->snapshots);
+    pthread_mutex_destroy(&ctx->parked.mutex);
+    journal_destroy(&ctx->journal);
+    replay_writer_destroy(&ctx->replay_writer);
+    level_loader_destroy(&ctx->level_loader);
+    reactor_destroy(&ctx->reactor);
+    sem_destroy(&ctx->game_slots);
+    scheduler_destroy(&ctx->scheduler);
     pc_buffer_destroy(&ctx->request_buffer);
     leaderboard_destroy(&ctx->leaderboard);
+    unload_level_templates(ctx);
+    close(ctx->host_wake_pipe[0]);
+    close(ctx->host_wake_pipe[1]);
     unlink(ctx->server_fifo_path);
     debug("[Server] Cleanup complete\n");
 }
@@ -0,0 +1,542 @@
+#include "journal.h"
+#include "parser.h"
+#include "display.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+// Records handed to a single writev
+#define JOURNAL_IOV_MAX 1024
+
+static uint32_t fnv1a(const char* data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ (unsigned char)data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// =============================================================================
+// Log Thread
+// =============================================================================
+
+/**
+ * Writes a batch of records, in order (no lock held).
+ * Returns -1 if the file could not be written.
+ */
+static int write_batch(int fd, journal_record_t* batch) {
+    struct iovec iov[JOURNAL_IOV_MAX];
+    journal_record_t* record = batch;
+    size_t done = 0;                    // Bytes of record already written
+
+    while (record) {
+        int n_iov = 0;
+        size_t skip = done;
+        for (journal_record_t* r = record; r && n_iov < JOURNAL_IOV_MAX; r = r->next) {
+            iov[n_iov].iov_base = r->data + skip;
+            iov[n_iov].iov_len = r->size - skip;
+            skip = 0;
+            n_iov++;
+        }
+
+        ssize_t written = writev(fd, iov, n_iov);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+
+        // Skip the records written in full; a short write resumes mid-record
+        size_t left = (size_t)written;
+        while (record && left >= record->size - done) {
+            left -= record->size - done;
+            done = 0;
+            record = record->next;
+        }
+        done += left;
+    }
+    return 0;
+}
+
+static void* journal_thread_func(void* arg) {
+    journal_t* journal = (journal_t*)arg;
+
+    // Block SIGUSR1 - only host thread should receive it
+    block_sigusr1();
+
+    pthread_mutex_lock(&journal->mutex);
+    while (journal->running || journal->head) {
+        if (!journal->head) {
+            pthread_cond_wait(&journal->work, &journal->mutex);
+            continue;
+        }
+
+        // Group commit: whatever queued up during the last commit goes together
+        journal_record_t* batch = journal->head;
+        journal->head = NULL;
+        journal->tail = NULL;
+        pthread_mutex_unlock(&journal->mutex);
+
+        long n_records = 0;
+        size_t batch_bytes = 0;
+        for (journal_record_t* r = batch; r; r = r->next) {
+            uint32_t checksum = fnv1a(r->data + sizeof(uint32_t), r->size - sizeof(uint32_t));
+            memcpy(r->data, &checksum, sizeof(uint32_t));
+            batch_bytes += r->size;
+            n_records++;
+        }
+
+        if (write_batch(journal->fd, batch) < 0 || fdatasync(journal->fd) < 0) {
+            debug("[Journal] Failed to write journal: %s\n", strerror(errno));
+            atomic_fetch_add(&journal->errors, 1);
+        } else {
+            atomic_fetch_add(&journal->records, n_records);
+            atomic_fetch_add(&journal->commits, 1);
+            atomic_fetch_add(&journal->bytes, (long)batch_bytes);
+        }
+
+        while (batch) {
+            journal_record_t* next = batch->next;
+            free(batch);
+            batch = next;
+        }
+
+        pthread_mutex_lock(&journal->mutex);
+        journal->queued_bytes -= batch_bytes;
+        journal->durable += n_records;
+        pthread_cond_broadcast(&journal->synced);
+        
+        // Let the next group build up
+        if (journal->running) {
+            pthread_mutex_unlock(&journal->mutex);
+            sleep_ms(JOURNAL_COMMIT_INTERVAL_MS);
+            pthread_mutex_lock(&journal->mutex);
+        }
+    }
+    pthread_mutex_unlock(&journal->mutex);
+
+    return NULL;
+}
+
+// =============================================================================
+// Appending
+// =============================================================================
+
+/**
+ * Allocates a record and fills its header (the log thread adds the checksum).
+ * Returns NULL on allocation failure; *payload is where the payload goes.
+ */
+static journal_record_t* new_record(char type, const char* client_id, size_t payload_size,
+                                    char** payload) {
+    size_t id_length = strnlen(client_id, MAX_CLIENT_ID_LENGTH);
+    size_t size = JOURNAL_HEADER_SIZE + id_length + payload_size;
+    journal_record_t* record = malloc(sizeof(journal_record_t) + size);
+    if (!record) {
+        return NULL;
+    }
+    record->next = NULL;
+    record->size = size;
+
+    int payload_field = (int)payload_size;
+    char* header = record->data + sizeof(uint32_t);
+    memcpy(header, &payload_field, sizeof(int));
+    header[sizeof(int)] = type;
+    header[sizeof(int) + 1] = (char)id_length;
+    memcpy(record->data + JOURNAL_HEADER_SIZE, client_id, id_length);
+
+    *payload = record->data + JOURNAL_HEADER_SIZE + id_length;
+    return record;
+}
+
+/**
+ * Queues a record for the log thread, which takes ownership of it.
+ * Returns -1 (and frees the record) if it would take the queue past limit
+ * bytes.
+ */
+static int submit_record(journal_t* journal, journal_record_t* record, size_t limit) {
+    pthread_mutex_lock(&journal->mutex);
+    if (journal->queued_bytes + record->size > limit) {
+        pthread_mutex_unlock(&journal->mutex);
+        free(record);
+        return -1;
+    }
+    journal->queued_bytes += record->size;
+    journal->appended++;
+    if (journal->tail) {
+        // The log thread only waits on an empty queue - no need to wake it
+        journal->tail->next = record;
+    } else {
+        journal->head = record;
+        pthread_cond_signal(&journal->work);
+    }
+    journal->tail = record;
+    pthread_mutex_unlock(&journal->mutex);
+    return 0;
+}
+
+int journal_append_level(journal_t* journal, const char* client_id, int level, int points,
+                         unsigned int rng) {
+    char* payload;
+    journal_record_t* record = new_record(JOURNAL_LEVEL, client_id,
+                                          2 * sizeof(int) + sizeof(unsigned int), &payload);
+    if (!record) {
+        debug("[Journal] Failed to allocate record for %s\n", client_id);
+        return -1;
+    }
+    memcpy(payload, &level, sizeof(int));
+    memcpy(payload + sizeof(int), &points, sizeof(int));
+    memcpy(payload + 2 * sizeof(int), &rng, sizeof(unsigned int));
+    return submit_record(journal, record, JOURNAL_MAX_QUEUED);
+}
+
+int journal_append_input(journal_t* journal, const char* client_id, int64_t tick, char command) {
+    char* payload;
+    journal_record_t* record = new_record(JOURNAL_INPUT, client_id, sizeof(int64_t) + 1, &payload);
+    if (!record) {
+        debug("[Journal] Failed to allocate record for %s\n", client_id);
+        return -1;
+    }
+    memcpy(payload, &tick, sizeof(int64_t));
+    payload[sizeof(int64_t)] = command;
+    return submit_record(journal, record, JOURNAL_MAX_QUEUED);
+}
+
+void journal_append_checkpoint(journal_t* journal, const char* client_id, int level,
+                               int64_t tick, const board_t* board) {
+    char* payload;
+    size_t board_size = board_checkpoint_size(board);
+    journal_record_t* record = new_record(JOURNAL_CHECKPOINT, client_id,
+                                          sizeof(int) + sizeof(int64_t) + board_size, &payload);
+    if (!record) {
+        atomic_fetch_add(&journal->skipped, 1);
+        return;
+    }
+    memcpy(payload, &level, sizeof(int));
+    memcpy(payload + sizeof(int), &tick, sizeof(int64_t));
+    board_checkpoint(board, payload + sizeof(int) + sizeof(int64_t));
+    if (submit_record(journal, record, JOURNAL_CHECKPOINT_QUEUED) < 0) {
+        atomic_fetch_add(&journal->skipped, 1);
+    }
+}
+
+void journal_append_end(journal_t* journal, const char* client_id, int points) {
+    char* payload;
+    journal_record_t* record = new_record(JOURNAL_END, client_id, sizeof(int), &payload);
+    if (record) {
+        memcpy(payload, &points, sizeof(int));
+        if (submit_record(journal, record, JOURNAL_MAX_QUEUED + JOURNAL_END_RESERVE) == 0) {
+            return;
+        }
+    }
+    
+    // The game would be recovered although it is over
+    debug("[Journal] Failed to journal the end of %s's game\n", client_id);
+    atomic_fetch_add(&journal->errors, 1);
+}
+
+void journal_abandon(journal_t* journal, const char* client_id, int points) {
+    debug("[Journal] Record refused, no longer journaling %s's game\n", client_id);
+    atomic_fetch_add(&journal->abandoned, 1);
+    journal_append_end(journal, client_id, points);
+}
+
+// =============================================================================
+// Reading (startup only)
+// =============================================================================
+
+static journal_game_t* find_game(journal_game_t** buckets, journal_game_t** games,
+                                 const char* client_id) {
+    unsigned int bucket = fnv1a(client_id, strlen(client_id)) & (JOURNAL_BUCKETS - 1);
+    journal_game_t* game = buckets[bucket];
+    while (game && strcmp(game->client_id, client_id) != 0) {
+        game = game->bucket_next;
+    }
+    if (game) {
+        return game;
+    }
+
+    game = calloc(1, sizeof(journal_game_t));
+    if (!game) {
+        return NULL;
+    }
+    strcpy(game->client_id, client_id);
+    game->bucket_next = buckets[bucket];
+    buckets[bucket] = game;
+    game->next = *games;
+    *games = game;
+    return game;
+}
+
+/**
+ * A new base for the game: the inputs before it are no longer needed.
+ */
+static void reset_base(journal_game_t* game) {
+    free(game->checkpoint);
+    game->checkpoint = NULL;
+    game->checkpoint_size = 0;
+    game->base_tick = 0;
+    game->n_inputs = 0;
+    game->ended = false;
+}
+
+/**
+ * Applies one record to its game. Returns -1 if the record makes no sense
+ * (or memory ran out), which ends the read like a torn record.
+ */
+static int apply_record(journal_game_t* game, char type, const char* payload, size_t size) {
+    switch (type) {
+        case JOURNAL_LEVEL:
+            if (size != 2 * sizeof(int) + sizeof(unsigned int)) return -1;
+            reset_base(game);
+            memcpy(&game->level, payload, sizeof(int));
+            memcpy(&game->points, payload + sizeof(int), sizeof(int));
+            memcpy(&game->rng, payload + 2 * sizeof(int), sizeof(unsigned int));
+            return 0;
+
+        case JOURNAL_INPUT: {
+            if (size != sizeof(int64_t) + 1) return -1;
+            journal_input_t input;
+            memcpy(&input.tick, payload, sizeof(int64_t));
+            input.command = payload[sizeof(int64_t)];
+            if (game->ended || input.tick <= game->base_tick) {
+                return 0;
+            }
+            if (game->n_inputs == game->inputs_capacity) {
+                size_t capacity = game->inputs_capacity ? game->inputs_capacity * 2 : 64;
+                journal_input_t* grown = realloc(game->inputs, capacity * sizeof(journal_input_t));
+                if (!grown) return -1;
+                game->inputs = grown;
+                game->inputs_capacity = capacity;
+            }
+            game->inputs[game->n_inputs++] = input;
+            return 0;
+        }
+
+        case JOURNAL_CHECKPOINT: {
+            size_t fields = sizeof(int) + sizeof(int64_t);
+            if (size < fields) return -1;
+            char* checkpoint = malloc(size - fields);
+            if (!checkpoint) return -1;
+            reset_base(game);
+            memcpy(&game->level, payload, sizeof(int));
+            memcpy(&game->base_tick, payload + sizeof(int), sizeof(int64_t));
+            memcpy(checkpoint, payload + fields, size - fields);
+            game->checkpoint = checkpoint;
+            game->checkpoint_size = size - fields;
+            return 0;
+        }
+
+        case JOURNAL_END:
+            if (size != sizeof(int)) return -1;
+            reset_base(game);
+            memcpy(&game->points, payload, sizeof(int));
+            game->ended = true;
+            return 0;
+
+        default:
+            return -1;
+    }
+}
+
+int journal_read(const char* path, journal_game_t** games) {
+    *games = NULL;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return errno == ENOENT ? 0 : -1;
+    }
+    parse_buffer_t buf;
+    int loaded = parse_buffer_load(&buf, fd);
+    close(fd);
+    if (loaded < 0) {
+        return -1;
+    }
+
+    journal_game_t** buckets = calloc(JOURNAL_BUCKETS, sizeof(journal_game_t*));
+    if (!buckets) {
+        parse_buffer_free(&buf);
+        return -1;
+    }
+
+    long n_records = 0;
+    size_t offset = 0;
+    while (offset + JOURNAL_HEADER_SIZE <= buf.size) {
+        const char* record = buf.data + offset;
+        uint32_t checksum;
+        int payload_size;
+        memcpy(&checksum, record, sizeof(uint32_t));
+        memcpy(&payload_size, record + sizeof(uint32_t), sizeof(int));
+        char type = record[sizeof(uint32_t) + sizeof(int)];
+        size_t id_length = (unsigned char)record[sizeof(uint32_t) + sizeof(int) + 1];
+
+        if (payload_size < 0 || id_length > MAX_CLIENT_ID_LENGTH ||
+            (size_t)payload_size > buf.size - offset - JOURNAL_HEADER_SIZE - id_length) {
+            break;
+        }
+        size_t size = JOURNAL_HEADER_SIZE + id_length + (size_t)payload_size;
+        if (fnv1a(record + sizeof(uint32_t), size - sizeof(uint32_t)) != checksum) {
+            break;
+        }
+
+        char client_id[MAX_CLIENT_ID_LENGTH + 1];
+        memcpy(client_id, record + JOURNAL_HEADER_SIZE, id_length);
+        client_id[id_length] = '\0';
+        journal_game_t* game = find_game(buckets, games, client_id);
+        if (!game || apply_record(game, type, record + JOURNAL_HEADER_SIZE + id_length,
+                                  (size_t)payload_size) < 0) {
+            break;
+        }
+
+        offset += size;
+        n_records++;
+    }
+
+    if (offset < buf.size) {
+        debug("[Journal] %s: ignoring %zu bytes after record %ld (torn or corrupt)\n",
+              path, buf.size - offset, n_records);
+    }
+
+    int n_games = 0;
+    for (journal_game_t* game = *games; game; game = game->next) {
+        game->bucket_next = NULL;
+        n_games++;
+    }
+    free(buckets);
+    parse_buffer_free(&buf);
+
+    debug("[Journal] Read %ld records for %d clients from %s\n", n_records, n_games, path);
+    return n_games;
+}
+
+void journal_free_games(journal_game_t* games) {
+    while (games) {
+        journal_game_t* next = games->next;
+        free(games->checkpoint);
+        free(games->inputs);
+        free(games);
+        games = next;
+    }
+}
+
+// =============================================================================
+// Journal Management
+// =============================================================================
+
+int journal_init(journal_t* journal, const char* path) {
+    memset(journal, 0, sizeof(journal_t));
+    journal->path = path;
+    journal->fd = -1;
+    atomic_init(&journal->records, 0);
+    atomic_init(&journal->commits, 0);
+    atomic_init(&journal->skipped, 0);
+    atomic_init(&journal->abandoned, 0);
+    atomic_init(&journal->bytes, 0);
+    atomic_init(&journal->errors, 0);
+
+    if (path && snprintf(journal->new_path, sizeof(journal->new_path), "%s.new", path) >=
+                (int)sizeof(journal->new_path)) {
+        return -1;
+    }
+
+    if (pthread_mutex_init(&journal->mutex, NULL) != 0) {
+        return -1;
+    }
+    if (pthread_cond_init(&journal->work, NULL) != 0) {
+        pthread_mutex_destroy(&journal->mutex);
+        return -1;
+    }
+    if (pthread_cond_init(&journal->synced, NULL) != 0) {
+        pthread_cond_destroy(&journal->work);
+        pthread_mutex_destroy(&journal->mutex);
+        return -1;
+    }
+
+    return 0;
+}
+
+int journal_start(journal_t* journal) {
+    journal->fd = open(journal->new_path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (journal->fd < 0) {
+        debug("[Journal] Failed to create %s: %s\n", journal->new_path, strerror(errno));
+        return -1;
+    }
+
+    journal->running = true;
+    if (pthread_create(&journal->thread, NULL, journal_thread_func, journal) != 0) {
+        debug("[Journal] Failed to create log thread: %s\n", strerror(errno));
+        journal->running = false;
+        close(journal->fd);
+        journal->fd = -1;
+        unlink(journal->new_path);
+        return -1;
+    }
+
+    return 0;
+}
+
+int journal_install(journal_t* journal) {
+    pthread_mutex_lock(&journal->mutex);
+    long target = journal->appended;
+    while (journal->durable < target) {
+        pthread_cond_wait(&journal->synced, &journal->mutex);
+    }
+    pthread_mutex_unlock(&journal->mutex);
+
+    if (atomic_load(&journal->errors) > 0) {
+        debug("[Journal] New journal is incomplete, keeping %s\n", journal->path);
+        return -1;
+    }
+    if (rename(journal->new_path, journal->path) < 0) {
+        debug("[Journal] Failed to replace %s: %s\n", journal->path, strerror(errno));
+        return -1;
+    }
+
+    // The rename itself is only durable once the directory is
+    char dir[PATH_MAX];
+    const char* slash = strrchr(journal->path, '/');
+    if (slash) {
+        snprintf(dir, sizeof(dir), "%.*s", (int)(slash - journal->path + 1), journal->path);
+    } else {
+        strcpy(dir, ".");
+    }
+    int dir_fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+
+    debug("[Journal] Journaling to %s\n", journal->path);
+    return 0;
+}
+
+void journal_shutdown(journal_t* journal) {
+    pthread_mutex_lock(&journal->mutex);
+    bool was_running = journal->running;
+    journal->running = false;
+    pthread_cond_broadcast(&journal->work);
+    pthread_mutex_unlock(&journal->mutex);
+
+    if (was_running) {
+        pthread_join(journal->thread, NULL);
+    }
+    if (journal->fd >= 0) {
+        close(journal->fd);
+        journal->fd = -1;
+    }
+
+    debug("[Journal] Stopped (records=%ld commits=%ld skipped=%ld abandoned=%ld errors=%ld "
+          "bytes=%ld)\n",
+          atomic_load(&journal->records), atomic_load(&journal->commits),
+          atomic_load(&journal->skipped), atomic_load(&journal->abandoned),
+          atomic_load(&journal->errors), atomic_load(&journal->bytes));
+}
+
+void journal_destroy(journal_t* journal) {
+    pthread_cond_destroy(&journal->synced);
+    pthread_cond_destroy(&journal->work);
+    pthread_mutex_destroy(&journal->mutex);
+}
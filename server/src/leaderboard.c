@@ -6,6 +6,7 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <errno.h>
+#include <limits.h>
 
 // =============================================================================
 // Signal Handling
@@ -56,118 +57,252 @@ void block_sigusr1(void) {
     }
 }
 
+// =============================================================================
+// Top List (caller holds top_mutex)
+// =============================================================================
+
+/**
+ * A top entry copied out for writing, so the file is written unlocked.
+ */
+typedef struct {
+    char client_id[MAX_CLIENT_ID_LENGTH + 1];
+    int points;
+} top_entry_t;
+
+static int entry_points(leaderboard_t* lb, int index) {
+    return atomic_load(&lb->sessions[index].points);
+}
+
+static void top_remove(leaderboard_t* lb, int index) {
+    for (int i = 0; i < lb->n_top; i++) {
+        if (lb->top[i] == index) {
+            memmove(&lb->top[i], &lb->top[i + 1], (size_t)(lb->n_top - i - 1) * sizeof(int));
+            lb->n_top--;
+            atomic_store(&lb->sessions[index].in_top, false);
+            return;
+        }
+    }
+}
+
+/**
+ * Inserts a session that is not listed, in points order (the list has room).
+ */
+static void top_insert(leaderboard_t* lb, int index) {
+    int points = entry_points(lb, index);
+    int pos = lb->n_top;
+    while (pos > 0 && entry_points(lb, lb->top[pos - 1]) < points) {
+        lb->top[pos] = lb->top[pos - 1];
+        pos--;
+    }
+    lb->top[pos] = index;
+    lb->n_top++;
+    atomic_store(&lb->sessions[index].in_top, true);
+}
+
+/**
+ * Puts a session whose points changed where it belongs: moved within the
+ * list, let in (pushing the last one out) or left out. Whoever ends up
+ * outside is covered by top_floor, which only ever rises here.
+ */
+static void top_place(leaderboard_t* lb, int index) {
+    session_entry_t* entry = &lb->sessions[index];
+    if (!entry->active) {
+        return;
+    }
+    if (atomic_load(&entry->in_top)) {
+        top_remove(lb, index);
+        top_insert(lb, index);
+        return;
+    }
+    
+    int points = atomic_load(&entry->points);
+    if (points <= atomic_load(&lb->top_floor)) {
+        return;
+    }
+    if (lb->n_top == LEADERBOARD_TOP_CAPACITY) {
+        int last = lb->top[lb->n_top - 1];
+        int last_points = entry_points(lb, last);
+        if (last_points >= points) {
+            atomic_store(&lb->top_floor, points);
+            return;
+        }
+        
+        // The floor covers the pushed out session before it stops being listed
+        if (last_points > atomic_load(&lb->top_floor)) {
+            atomic_store(&lb->top_floor, last_points);
+        }
+        lb->n_top--;
+        atomic_store(&lb->sessions[last].in_top, false);
+    }
+    top_insert(lb, index);
+}
+
+/**
+ * Whether the list's head is not the real top anymore: top sessions left
+ * (or lost points) and nobody outside is known to be behind them.
+ */
+static bool top_short(leaderboard_t* lb) {
+    int wanted = lb->count < LEADERBOARD_TOP_K ? lb->count : LEADERBOARD_TOP_K;
+    if (lb->n_top < wanted) {
+        return true;
+    }
+    return wanted > 0 && entry_points(lb, lb->top[wanted - 1]) < atomic_load(&lb->top_floor);
+}
+
+/**
+ * Rebuilds the list from every session (O(capacity)).
+ */
+static void top_rebuild(leaderboard_t* lb) {
+    // With no floor, updates racing with the scan take the lock and
+    // place themselves once it is done
+    atomic_store(&lb->top_floor, INT_MIN);
+    for (int i = 0; i < lb->n_top; i++) {
+        atomic_store(&lb->sessions[lb->top[i]].in_top, false);
+    }
+    lb->n_top = 0;
+    
+    for (int index = 0; index < lb->capacity; index++) {
+        top_place(lb, index);
+    }
+    lb->rebuilds++;
+}
+
 // =============================================================================
 // Leaderboard Management
 // =============================================================================
 
-int leaderboard_init(leaderboard_t* lb) {
-    memset(lb->sessions, 0, sizeof(lb->sessions));
+int leaderboard_init(leaderboard_t* lb, int capacity) {
+    lb->capacity = capacity;
+    lb->sessions = calloc((size_t)capacity, sizeof(session_entry_t));
+    lb->free_slots = malloc(sizeof(int) * (size_t)capacity);
+    if (!lb->sessions || !lb->free_slots) {
+        debug("[Leaderboard] Failed to allocate %d sessions\n", capacity);
+        free(lb->sessions);
+        free(lb->free_slots);
+        return -1;
+    }
+    
+    // Lowest indices are handed out first
+    for (int i = 0; i < capacity; i++) {
+        atomic_init(&lb->sessions[i].points, 0);
+        atomic_init(&lb->sessions[i].in_top, false);
+        lb->free_slots[i] = capacity - 1 - i;
+    }
+    lb->n_free = capacity;
+    lb->n_top = 0;
     lb->count = 0;
+    lb->rebuilds = 0;
+    atomic_init(&lb->top_floor, INT_MIN);
     
-    if (pthread_mutex_init(&lb->mutex, NULL) != 0) {
+    if (pthread_mutex_init(&lb->slots_mutex, NULL) != 0) {
         debug("[Leaderboard] Failed to init mutex\n");
+        free(lb->sessions);
+        free(lb->free_slots);
+        return -1;
+    }
+    if (pthread_mutex_init(&lb->top_mutex, NULL) != 0) {
+        debug("[Leaderboard] Failed to init mutex\n");
+        pthread_mutex_destroy(&lb->slots_mutex);
+        free(lb->sessions);
+        free(lb->free_slots);
         return -1;
     }
     
-    debug("[Leaderboard] Initialized\n");
+    debug("[Leaderboard] Initialized (%d sessions)\n", capacity);
     return 0;
 }
 
 void leaderboard_destroy(leaderboard_t* lb) {
-    pthread_mutex_destroy(&lb->mutex);
-    debug("[Leaderboard] Destroyed\n");
+    pthread_mutex_destroy(&lb->top_mutex);
+    pthread_mutex_destroy(&lb->slots_mutex);
+    free(lb->sessions);
+    free(lb->free_slots);
+    lb->sessions = NULL;
+    lb->free_slots = NULL;
+    debug("[Leaderboard] Destroyed (top list rebuilt %ld times)\n", lb->rebuilds);
 }
 
 int leaderboard_register(leaderboard_t* lb, const char* client_id) {
-    pthread_mutex_lock(&lb->mutex);
-    
-    // Find empty slot
-    int index = -1;
-    for (int i = 0; i < MAX_ACTIVE_SESSIONS; i++) {
-        if (!lb->sessions[i].active) {
-            index = i;
-            break;
-        }
-    }
-    
-    if (index < 0) {
+    pthread_mutex_lock(&lb->slots_mutex);
+    if (lb->n_free == 0) {
+        pthread_mutex_unlock(&lb->slots_mutex);
         debug("[Leaderboard] No free slots for client: %s\n", client_id);
-        pthread_mutex_unlock(&lb->mutex);
         return -1;
     }
+    int index = lb->free_slots[--lb->n_free];
+    pthread_mutex_unlock(&lb->slots_mutex);
     
-    // Register session
-    strncpy(lb->sessions[index].client_id, client_id, MAX_CLIENT_ID_LENGTH);
-    lb->sessions[index].client_id[MAX_CLIENT_ID_LENGTH] = '\0';
-    lb->sessions[index].points = 0;
-    lb->sessions[index].active = true;
-    lb->count++;
+    // Register session (the slot is ours alone until it is active)
+    session_entry_t* entry = &lb->sessions[index];
+    strncpy(entry->client_id, client_id, MAX_CLIENT_ID_LENGTH);
+    entry->client_id[MAX_CLIENT_ID_LENGTH] = '\0';
+    atomic_store(&entry->points, 0);
     
-    debug("[Leaderboard] Registered client '%s' at index %d (total: %d)\n", 
-          client_id, index, lb->count);
+    pthread_mutex_lock(&lb->top_mutex);
+    entry->active = true;
+    int total = ++lb->count;
+    top_place(lb, index);
+    pthread_mutex_unlock(&lb->top_mutex);
     
-    pthread_mutex_unlock(&lb->mutex);
+    debug("[Leaderboard] Registered client '%s' at index %d (total: %d)\n", 
+          client_id, index, total);
     return index;
 }
 
 void leaderboard_update_points(leaderboard_t* lb, int index, int points) {
-    if (index < 0 || index >= MAX_ACTIVE_SESSIONS) return;
+    if (index < 0 || index >= lb->capacity) return;
     
-    pthread_mutex_lock(&lb->mutex);
+    session_entry_t* entry = &lb->sessions[index];
+    atomic_store(&entry->points, points);
     
-    if (lb->sessions[index].active) {
-        lb->sessions[index].points = points;
-        debug("[Leaderboard] Updated client '%s' points to %d\n", 
-              lb->sessions[index].client_id, points);
+    // Most sessions are nowhere near the top: no lock at all
+    if (!atomic_load(&entry->in_top) && points <= atomic_load(&lb->top_floor)) {
+        return;
     }
     
-    pthread_mutex_unlock(&lb->mutex);
+    pthread_mutex_lock(&lb->top_mutex);
+    top_place(lb, index);
+    pthread_mutex_unlock(&lb->top_mutex);
 }
 
 void leaderboard_unregister(leaderboard_t* lb, int index) {
-    if (index < 0 || index >= MAX_ACTIVE_SESSIONS) return;
+    if (index < 0 || index >= lb->capacity) return;
     
-    pthread_mutex_lock(&lb->mutex);
-    
-    if (lb->sessions[index].active) {
-        debug("[Leaderboard] Unregistered client '%s'\n", lb->sessions[index].client_id);
-        lb->sessions[index].active = false;
-        lb->sessions[index].points = 0;
-        lb->sessions[index].client_id[0] = '\0';
-        lb->count--;
+    session_entry_t* entry = &lb->sessions[index];
+    pthread_mutex_lock(&lb->top_mutex);
+    if (!entry->active) {
+        pthread_mutex_unlock(&lb->top_mutex);
+        return;
     }
+    entry->active = false;
+    lb->count--;
+    if (atomic_load(&entry->in_top)) {
+        top_remove(lb, index);
+    }
+    pthread_mutex_unlock(&lb->top_mutex);
     
-    pthread_mutex_unlock(&lb->mutex);
-}
-
-/**
- * Comparison function for qsort - sort by points descending.
- */
-static int compare_entries(const void* a, const void* b) {
-    const session_entry_t* ea = (const session_entry_t*)a;
-    const session_entry_t* eb = (const session_entry_t*)b;
-    
-    // Inactive entries go to the end
-    if (!ea->active && !eb->active) return 0;
-    if (!ea->active) return 1;
-    if (!eb->active) return -1;
+    debug("[Leaderboard] Unregistered client '%s'\n", entry->client_id);
     
-    // Sort by points descending
-    return eb->points - ea->points;
+    pthread_mutex_lock(&lb->slots_mutex);
+    lb->free_slots[lb->n_free++] = index;
+    pthread_mutex_unlock(&lb->slots_mutex);
 }
 
 int leaderboard_write_top5(leaderboard_t* lb, const char* filename) {
-    pthread_mutex_lock(&lb->mutex);
+    top_entry_t best[LEADERBOARD_TOP_K];
     
-    // Make a copy of sessions to sort
-    session_entry_t sorted[MAX_ACTIVE_SESSIONS];
-    memcpy(sorted, lb->sessions, sizeof(sorted));
+    pthread_mutex_lock(&lb->top_mutex);
+    if (top_short(lb)) {
+        top_rebuild(lb);
+    }
+    int n_best = lb->n_top < LEADERBOARD_TOP_K ? lb->n_top : LEADERBOARD_TOP_K;
+    for (int i = 0; i < n_best; i++) {
+        const session_entry_t* entry = &lb->sessions[lb->top[i]];
+        memcpy(best[i].client_id, entry->client_id, sizeof(best[i].client_id));
+        best[i].points = atomic_load(&entry->points);
+    }
     int total = lb->count;
-    
-    pthread_mutex_unlock(&lb->mutex);
-    
-    // Sort by points (descending)
-    qsort(sorted, MAX_ACTIVE_SESSIONS, sizeof(session_entry_t), compare_entries);
+    pthread_mutex_unlock(&lb->top_mutex);
     
     // Open file for writing
     int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
@@ -190,21 +325,17 @@ int leaderboard_write_top5(leaderboard_t* lb, const char* filename) {
     }
     
     // Write top 5 (or less if fewer active)
-    int written = 0;
-    for (int i = 0; i < MAX_ACTIVE_SESSIONS && written < 5; i++) {
-        if (sorted[i].active) {
-            len = snprintf(buffer, sizeof(buffer), 
-                          "  %d  | %-20s | %6d\n",
-                          written + 1, sorted[i].client_id, sorted[i].points);
-            if (write(fd, buffer, (size_t)len) < 0) {
-                close(fd);
-                return -1;
-            }
-            written++;
+    for (int i = 0; i < n_best; i++) {
+        len = snprintf(buffer, sizeof(buffer), 
+                      "  %d  | %-20s | %6d\n",
+                      i + 1, best[i].client_id, best[i].points);
+        if (write(fd, buffer, (size_t)len) < 0) {
+            close(fd);
+            return -1;
         }
     }
     
-    if (written == 0) {
+    if (n_best == 0) {
         len = snprintf(buffer, sizeof(buffer), "(No active clients)\n");
         if (write(fd, buffer, (size_t)len) < 0) {
             // ignore
@@ -212,6 +343,6 @@ int leaderboard_write_top5(leaderboard_t* lb, const char* filename) {
     }
     
     close(fd);
-    debug("[Leaderboard] Wrote top %d clients to '%s'\n", written, filename);
+    debug("[Leaderboard] Wrote top %d clients to '%s'\n", n_best, filename);
     return 0;
 }
@@ -0,0 +1,211 @@
+#include "loader.h"
+#include "display.h"
+#include "leaderboard.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+// =============================================================================
+// Job Queue (caller holds loader->mutex)
+// =============================================================================
+
+static void queue_push(level_loader_t* loader, level_job_t* job) {
+    job->next = NULL;
+    if (loader->tail) {
+        loader->tail->next = job;
+    } else {
+        loader->head = job;
+    }
+    loader->tail = job;
+}
+
+static level_job_t* queue_pop(level_loader_t* loader) {
+    level_job_t* job = loader->head;
+    loader->head = job->next;
+    if (!loader->head) {
+        loader->tail = NULL;
+    }
+    job->next = NULL;
+    return job;
+}
+
+static void queue_unlink(level_loader_t* loader, level_job_t* job) {
+    level_job_t* prev = NULL;
+    for (level_job_t* it = loader->head; it; prev = it, it = it->next) {
+        if (it != job) {
+            continue;
+        }
+        if (prev) {
+            prev->next = job->next;
+        } else {
+            loader->head = job->next;
+        }
+        if (loader->tail == job) {
+            loader->tail = prev;
+        }
+        job->next = NULL;
+        return;
+    }
+}
+
+/**
+ * Loads the job's level (no lock held).
+ */
+static level_job_state_t run_job(level_job_t* job) {
+    if (board_instantiate(job->board, job->level, 0) < 0) {
+        debug("[Loader] Failed to load level %s\n", job->level->level_name);
+        return LEVEL_JOB_FAILED;
+    }
+    return LEVEL_JOB_READY;
+}
+
+// =============================================================================
+// Loader Thread
+// =============================================================================
+
+static void* level_loader_thread_func(void* arg) {
+    level_loader_t* loader = (level_loader_t*)arg;
+
+    // Block SIGUSR1 - only host thread should receive it
+    block_sigusr1();
+
+    pthread_mutex_lock(&loader->mutex);
+    while (loader->running) {
+        if (!loader->head) {
+            pthread_cond_wait(&loader->work, &loader->mutex);
+            continue;
+        }
+
+        level_job_t* job = queue_pop(loader);
+        job->state = LEVEL_JOB_LOADING;
+        pthread_mutex_unlock(&loader->mutex);
+
+        level_job_state_t result = run_job(job);
+
+        pthread_mutex_lock(&loader->mutex);
+        job->state = result;
+        pthread_cond_broadcast(&loader->done);
+    }
+    pthread_mutex_unlock(&loader->mutex);
+
+    return NULL;
+}
+
+// =============================================================================
+// Loader Management
+// =============================================================================
+
+int level_loader_init(level_loader_t* loader) {
+    memset(loader, 0, sizeof(level_loader_t));
+    atomic_init(&loader->hits, 0);
+    atomic_init(&loader->misses, 0);
+
+    if (pthread_mutex_init(&loader->mutex, NULL) != 0) {
+        return -1;
+    }
+    if (pthread_cond_init(&loader->work, NULL) != 0) {
+        pthread_mutex_destroy(&loader->mutex);
+        return -1;
+    }
+    if (pthread_cond_init(&loader->done, NULL) != 0) {
+        pthread_cond_destroy(&loader->work);
+        pthread_mutex_destroy(&loader->mutex);
+        return -1;
+    }
+
+    return 0;
+}
+
+int level_loader_start(level_loader_t* loader) {
+    loader->running = true;
+
+    if (pthread_create(&loader->thread, NULL, level_loader_thread_func, loader) != 0) {
+        debug("[Loader] Failed to create thread: %s\n", strerror(errno));
+        loader->running = false;
+        return -1;
+    }
+
+    return 0;
+}
+
+void level_loader_submit(level_loader_t* loader, level_job_t* job, const board_t* level,
+                         board_t* board) {
+    job->level = level;
+    job->board = board;
+
+    pthread_mutex_lock(&loader->mutex);
+    job->state = LEVEL_JOB_QUEUED;
+    queue_push(loader, job);
+    pthread_cond_signal(&loader->work);
+    pthread_mutex_unlock(&loader->mutex);
+}
+
+int level_loader_collect(level_loader_t* loader, level_job_t* job) {
+    pthread_mutex_lock(&loader->mutex);
+
+    level_job_state_t state = job->state;
+    if (state == LEVEL_JOB_READY || state == LEVEL_JOB_FAILED) {
+        atomic_fetch_add(&loader->hits, 1);
+    } else {
+        atomic_fetch_add(&loader->misses, 1);
+
+        if (state == LEVEL_JOB_QUEUED) {
+            // Not started - cheaper to load it here than to wait in line
+            queue_unlink(loader, job);
+            job->state = LEVEL_JOB_LOADING;
+            pthread_mutex_unlock(&loader->mutex);
+            state = run_job(job);
+            pthread_mutex_lock(&loader->mutex);
+        } else {
+            while (job->state == LEVEL_JOB_LOADING) {
+                pthread_cond_wait(&loader->done, &loader->mutex);
+            }
+            state = job->state;
+        }
+    }
+
+    job->state = LEVEL_JOB_IDLE;
+    pthread_mutex_unlock(&loader->mutex);
+
+    return state == LEVEL_JOB_READY ? 0 : -1;
+}
+
+void level_loader_cancel(level_loader_t* loader, level_job_t* job) {
+    pthread_mutex_lock(&loader->mutex);
+
+    if (job->state == LEVEL_JOB_QUEUED) {
+        queue_unlink(loader, job);
+    }
+    while (job->state == LEVEL_JOB_LOADING) {
+        pthread_cond_wait(&loader->done, &loader->mutex);
+    }
+    bool loaded = job->state == LEVEL_JOB_READY;
+    job->state = LEVEL_JOB_IDLE;
+
+    pthread_mutex_unlock(&loader->mutex);
+
+    if (loaded) {
+        unload_level(job->board);
+    }
+}
+
+void level_loader_shutdown(level_loader_t* loader) {
+    pthread_mutex_lock(&loader->mutex);
+    bool was_running = loader->running;
+    loader->running = false;
+    pthread_cond_broadcast(&loader->work);
+    pthread_mutex_unlock(&loader->mutex);
+
+    if (was_running) {
+        pthread_join(loader->thread, NULL);
+    }
+
+    debug("[Loader] Stopped (prefetch hits=%ld misses=%ld)\n",
+          atomic_load(&loader->hits), atomic_load(&loader->misses));
+}
+
+void level_loader_destroy(level_loader_t* loader) {
+    pthread_cond_destroy(&loader->done);
+    pthread_cond_destroy(&loader->work);
+    pthread_mutex_destroy(&loader->mutex);
+}
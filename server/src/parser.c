@@ -4,85 +4,128 @@
 #include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+// Initial buffer size when the file size is unknown (pipes, empty stat)
+#define PARSE_BUFFER_MIN 4096
 
 // =============================================================================
-// Low-level I/O Primitives (using unget_char)
+// File Buffer
 // =============================================================================
 
-int unget_char(int fd) {
-    // Seek back one byte to "unget" the last read character
-    if (lseek(fd, -1, SEEK_CUR) < 0) {
+int parse_buffer_load(parse_buffer_t *buf, int fd) {
+    struct stat st;
+    size_t capacity = PARSE_BUFFER_MIN;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        capacity = (size_t)st.st_size + 1;  // +1 so EOF is seen without growing
+    }
+
+    buf->data = malloc(capacity + 1);
+    buf->size = 0;
+    buf->pos = 0;
+    if (!buf->data) {
         return -1;
     }
+
+    while (1) {
+        if (buf->size == capacity) {
+            char *grown = realloc(buf->data, capacity * 2 + 1);
+            if (!grown) {
+                parse_buffer_free(buf);
+                return -1;
+            }
+            buf->data = grown;
+            capacity *= 2;
+        }
+
+        ssize_t r = read(fd, buf->data + buf->size, capacity - buf->size);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            parse_buffer_free(buf);
+            return -1;
+        }
+        if (r == 0) break;  // EOF
+        buf->size += (size_t)r;
+    }
+
+    buf->data[buf->size] = '\0';
     return 0;
 }
 
-int read_char(int fd, char *c) {
-    ssize_t r = read(fd, c, 1);
-    if (r < 0) return -1;  // Error
-    if (r == 0) return 0;  // EOF
-    return 1;              // Success
+void parse_buffer_free(parse_buffer_t *buf) {
+    free(buf->data);
+    buf->data = NULL;
+    buf->size = 0;
+    buf->pos = 0;
 }
 
-int skip_spaces(int fd) {
+// =============================================================================
+// Low-level Primitives (in memory, using unget_char)
+// =============================================================================
+
+int unget_char(parse_buffer_t *buf) {
+    if (buf->pos == 0) {
+        return -1;
+    }
+    buf->pos--;
+    return 0;
+}
+
+int read_char(parse_buffer_t *buf, char *c) {
+    if (buf->pos >= buf->size) return 0;  // EOF
+    *c = buf->data[buf->pos++];
+    return 1;
+}
+
+int skip_spaces(parse_buffer_t *buf) {
     int count = 0;
-    char c;
-    
-    while (read_char(fd, &c) == 1) {
-        if (c == ' ' || c == '\t') {
-            count++;
-        } else {
-            // Non-whitespace found - unget it and stop
-            unget_char(fd);
-            break;
-        }
+
+    while (buf->pos < buf->size &&
+           (buf->data[buf->pos] == ' ' || buf->data[buf->pos] == '\t')) {
+        buf->pos++;
+        count++;
     }
-    
+
     return count;
 }
 
-int read_uint(int fd, int *value) {
+int read_uint(parse_buffer_t *buf, int *value) {
     int digits = 0;
     *value = 0;
-    char c;
-    
-    while (read_char(fd, &c) == 1) {
-        if (c >= '0' && c <= '9') {
-            *value = (*value * 10) + (c - '0');
-            digits++;
-        } else {
-            // Non-digit found - unget it and stop
-            unget_char(fd);
-            break;
-        }
+
+    while (buf->pos < buf->size &&
+           buf->data[buf->pos] >= '0' && buf->data[buf->pos] <= '9') {
+        *value = (*value * 10) + (buf->data[buf->pos++] - '0');
+        digits++;
     }
-    
+
     if (digits == 0) {
         return -1;  // No digits found
     }
-    
+
     return digits;
 }
 
-int read_word(int fd, char *buffer, size_t max_len) {
+int read_word(parse_buffer_t *buf, char *buffer, size_t max_len) {
     size_t len = 0;
-    char c;
-    
-    while (len < max_len - 1 && read_char(fd, &c) == 1) {
+
+    while (len < max_len - 1 && buf->pos < buf->size) {
         // Stop at whitespace, newline, or EOF
+        char c = buf->data[buf->pos];
         if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
-            unget_char(fd);
             break;
         }
         buffer[len++] = c;
+        buf->pos++;
     }
-    
+
     buffer[len] = '\0';
-    
+
     if (len == 0) {
         return -1;  // No word found
     }
-    
+
     return (int)len;
 }
 
@@ -90,91 +133,142 @@ int read_word(int fd, char *buffer, size_t max_len) {
 // Line-based Utilities
 // =============================================================================
 
+const char *next_line(parse_buffer_t *buf, size_t *len) {
+    if (buf->pos >= buf->size) {
+        return NULL;  // EOF
+    }
+
+    const char *start = buf->data + buf->pos;
+    const char *newline = memchr(start, '\n', buf->size - buf->pos);
+    size_t line_len = newline ? (size_t)(newline - start) : buf->size - buf->pos;
+
+    buf->pos += line_len + (newline ? 1 : 0);
+    *len = line_len;
+    return start;
+}
+
 /**
  * Skip to the end of the current line (after newline or EOF).
  * Returns 0 on success, -1 on EOF/error.
  */
-int skip_line(int fd) {
-    char c;
-    while (read(fd, &c, 1) == 1) {
-        if (c == '\n') return 0;  // Found newline
+int skip_line(parse_buffer_t *buf) {
+    const char *start = buf->data + buf->pos;
+    const char *newline = memchr(start, '\n', buf->size - buf->pos);
+    if (!newline) {
+        buf->pos = buf->size;
+        return -1;  // EOF
     }
-    return -1;  // EOF or error
+    buf->pos += (size_t)(newline - start) + 1;
+    return 0;
 }
 
-int read_line(int fd, char *buffer, size_t max_len) {
-    size_t i = 0;
-    char c;
-    
-    while (i < max_len - 1) {
-        ssize_t r = read(fd, &c, 1);
-        if (r <= 0) {
-            // EOF or error
-            if (i == 0) return -1;
-            break;
-        }
-        if (c == '\n') {
-            break;
-        }
-        buffer[i++] = c;
+int read_line(parse_buffer_t *buf, char *buffer, size_t max_len) {
+    size_t len;
+    const char *line = next_line(buf, &len);
+    if (!line) return -1;  // EOF
+
+    if (len > max_len - 1) {
+        len = max_len - 1;
     }
-    
-    buffer[i] = '\0';
-    return (int)i;
+    memcpy(buffer, line, len);
+    buffer[len] = '\0';
+    return (int)len;
 }
 
 /**
- * Reads the next non-comment, non-empty line.
+ * Returns the next non-comment, non-empty line (not NUL-terminated).
  * Skips lines starting with '#' and empty lines.
  */
-static int read_next_line(int fd, char *buffer, size_t max_len) {
+static const char *next_content_line(parse_buffer_t *buf, size_t *len) {
     while (1) {
-        int len = read_line(fd, buffer, max_len);
-        if (len < 0) return -1;  // EOF
-        if (len == 0) continue;  // Empty line
-        if (buffer[0] == '#') continue;  // Comment
-        return len;
+        const char *line = next_line(buf, len);
+        if (!line) return NULL;  // EOF
+        if (*len == 0) continue;  // Empty line
+        if (line[0] == '#') continue;  // Comment
+        return line;
     }
 }
 
+/**
+ * Whether the line starts with the given keyword (including its space).
+ */
+static int line_starts_with(const char *line, size_t len, const char *keyword) {
+    size_t keyword_len = strlen(keyword);
+    return len >= keyword_len && memcmp(line, keyword, keyword_len) == 0;
+}
+
+/**
+ * Parses an integer at ptr, stopping at the line end (like atoi).
+ */
+static int line_atoi(const char *ptr, const char *end) {
+    while (ptr < end && (*ptr == ' ' || *ptr == '\t')) ptr++;
+    int sign = 1;
+    if (ptr < end && (*ptr == '-' || *ptr == '+')) {
+        if (*ptr == '-') sign = -1;
+        ptr++;
+    }
+    int value = 0;
+    while (ptr < end && *ptr >= '0' && *ptr <= '9') {
+        value = value * 10 + (*ptr++ - '0');
+    }
+    return sign * value;
+}
+
+/**
+ * Parses two space-separated integers ("DIM 5 10", "POS 2 3").
+ */
+static void line_two_ints(const char *ptr, const char *end, int *first, int *second) {
+    *first = line_atoi(ptr, end);
+    while (ptr < end && *ptr != ' ') ptr++;
+    while (ptr < end && *ptr == ' ') ptr++;
+    *second = line_atoi(ptr, end);
+}
+
 // =============================================================================
 // Behavior File Parsing (.m and .p files)
 // =============================================================================
 
 int parse_behavior_file(int fd, int *passo, int *row, int *col,
                         char *commands, int *turns, int max_cmds, int *n_cmds) {
-    char line[256];
-    
+    parse_buffer_t buf;
+    const char *line;
+    size_t len;
+
     *passo = 0;
     *row = 0;
     *col = 0;
     *n_cmds = 0;
-    
+
+    if (parse_buffer_load(&buf, fd) < 0) return -1;
+
     // Parse PASSO line
-    if (read_next_line(fd, line, sizeof(line)) < 0) return -1;
-    if (strncmp(line, "PASSO ", 6) == 0) {
-        *passo = atoi(line + 6);
+    line = next_content_line(&buf, &len);
+    if (!line) {
+        parse_buffer_free(&buf);
+        return -1;
+    }
+    if (line_starts_with(line, len, "PASSO ")) {
+        *passo = line_atoi(line + 6, line + len);
     }
-    
+
     // Parse POS line
-    if (read_next_line(fd, line, sizeof(line)) < 0) return -1;
-    if (strncmp(line, "POS ", 4) == 0) {
-        char *ptr = line + 4;
-        *row = atoi(ptr);
-        // Find next number
-        while (*ptr && *ptr != ' ') ptr++;
-        while (*ptr == ' ') ptr++;
-        *col = atoi(ptr);
+    line = next_content_line(&buf, &len);
+    if (!line) {
+        parse_buffer_free(&buf);
+        return -1;
+    }
+    if (line_starts_with(line, len, "POS ")) {
+        line_two_ints(line + 4, line + len, row, col);
     }
-    
+
     // Parse movement commands
     while (*n_cmds < max_cmds) {
-        int len = read_next_line(fd, line, sizeof(line));
-        if (len < 0) break;  // EOF
-        
+        line = next_content_line(&buf, &len);
+        if (!line) break;  // EOF
+
         char cmd = line[0];
         int turn_count = 1;
-        
+
         switch (cmd) {
             case 'W':
             case 'A':
@@ -188,23 +282,24 @@ int parse_behavior_file(int fd, int *passo, int *row, int *col,
                 turns[*n_cmds] = 1;
                 (*n_cmds)++;
                 break;
-                
+
             case 'T':
                 // T command has a number after it: "T 2"
                 if (len > 2) {
-                    turn_count = atoi(line + 2);
+                    turn_count = line_atoi(line + 2, line + len);
                 }
                 commands[*n_cmds] = 'T';
                 turns[*n_cmds] = turn_count;
                 (*n_cmds)++;
                 break;
-                
+
             default:
                 // Unknown command, skip
                 break;
         }
     }
-    
+
+    parse_buffer_free(&buf);
     return 0;
 }
 
@@ -214,102 +309,109 @@ int parse_behavior_file(int fd, int *passo, int *row, int *col,
 
 int parse_level_file(int fd, int *rows, int *cols, int *tempo,
                      char *pac_file, char mon_files[][256], int max_mons, int *n_mons,
-                     char *board, size_t max_board) {
-    char line[512];
-    
+                     char **board, size_t *board_len) {
+    parse_buffer_t buf;
+    const char *line;
+    size_t len;
+
     *rows = 0;
     *cols = 0;
     *tempo = 0;
     pac_file[0] = '\0';
     *n_mons = 0;
-    board[0] = '\0';
-    
+    *board = NULL;
+    *board_len = 0;
+
+    if (parse_buffer_load(&buf, fd) < 0) return -1;
+
+    // The matrix is a subset of the file, so a file-sized buffer always fits it
+    char *matrix = malloc(buf.size + 1);
+    if (!matrix) {
+        parse_buffer_free(&buf);
+        return -1;
+    }
+
     size_t board_offset = 0;
     int reading_board = 0;
-    
-    while (1) {
-        int len = read_line(fd, line, sizeof(line));
-        if (len < 0) break;  // EOF
-        
+
+    while ((line = next_line(&buf, &len)) != NULL) {
+        const char *end = line + len;
+
         // Skip empty lines before board
         if (len == 0 && !reading_board) continue;
-        
+
         // Skip comments
-        if (line[0] == '#') continue;
-        
+        if (len > 0 && line[0] == '#') continue;
+
         // Check for commands
         if (!reading_board) {
-            if (strncmp(line, "DIM ", 4) == 0) {
-                char *ptr = line + 4;
-                *rows = atoi(ptr);
-                while (*ptr && *ptr != ' ') ptr++;
-                while (*ptr == ' ') ptr++;
-                *cols = atoi(ptr);
+            if (line_starts_with(line, len, "DIM ")) {
+                line_two_ints(line + 4, end, rows, cols);
                 continue;
             }
-            
-            if (strncmp(line, "TEMPO ", 6) == 0) {
-                *tempo = atoi(line + 6);
+
+            if (line_starts_with(line, len, "TEMPO ")) {
+                *tempo = line_atoi(line + 6, end);
                 continue;
             }
-            
-            if (strncmp(line, "PAC ", 4) == 0) {
+
+            if (line_starts_with(line, len, "PAC ")) {
                 // Copy filename (skip "PAC ")
-                char *ptr = line + 4;
-                while (*ptr == ' ') ptr++;  // Skip extra spaces
-                strncpy(pac_file, ptr, 255);
-                pac_file[255] = '\0';
+                const char *ptr = line + 4;
+                while (ptr < end && *ptr == ' ') ptr++;  // Skip extra spaces
+                size_t fname_len = (size_t)(end - ptr);
+                if (fname_len > 255) fname_len = 255;
+                memcpy(pac_file, ptr, fname_len);
+                pac_file[fname_len] = '\0';
                 continue;
             }
-            
-            if (strncmp(line, "MON ", 4) == 0) {
+
+            if (line_starts_with(line, len, "MON ")) {
                 // Parse multiple filenames separated by spaces
-                char *ptr = line + 4;
-                while (*ptr && *n_mons < max_mons) {
-                    while (*ptr == ' ') ptr++;  // Skip spaces
-                    if (*ptr == '\0') break;
-                    
+                const char *ptr = line + 4;
+                while (ptr < end && *n_mons < max_mons) {
+                    while (ptr < end && *ptr == ' ') ptr++;  // Skip spaces
+                    if (ptr == end) break;
+
                     // Read filename
-                    char *start = ptr;
-                    while (*ptr && *ptr != ' ') ptr++;
-                    
+                    const char *start = ptr;
+                    while (ptr < end && *ptr != ' ') ptr++;
+
                     size_t fname_len = (size_t)(ptr - start);
                     if (fname_len > 0 && fname_len < 256) {
-                        strncpy(mon_files[*n_mons], start, fname_len);
+                        memcpy(mon_files[*n_mons], start, fname_len);
                         mon_files[*n_mons][fname_len] = '\0';
                         (*n_mons)++;
                     }
                 }
                 continue;
             }
-            
+
             // If line starts with X or o, it's the board
-            if (line[0] == 'X' || line[0] == 'o' || line[0] == '@') {
+            if (len > 0 && (line[0] == 'X' || line[0] == 'o' || line[0] == '@')) {
                 reading_board = 1;
             }
         }
-        
-        // Reading board matrix
-        if (reading_board || line[0] == 'X' || line[0] == 'o' || line[0] == '@') {
-            reading_board = 1;
-            
-            // Copy this line to board buffer
-            size_t line_len = strlen(line);
-            if (board_offset + line_len < max_board) {
-                memcpy(board + board_offset, line, line_len);
-                board_offset += line_len;
-            }
+
+        // Reading board matrix - copied straight out of the file buffer
+        if (reading_board) {
+            memcpy(matrix + board_offset, line, len);
+            board_offset += len;
         }
     }
-    
-    board[board_offset] = '\0';
-    
+
+    matrix[board_offset] = '\0';
+    parse_buffer_free(&buf);
+
     // Validate board size matches dimensions
     size_t expected_size = (size_t)(*rows) * (size_t)(*cols);
-    if (board_offset < expected_size) {
+    if (*rows <= 0 || *cols <= 0 || board_offset < expected_size) {
         // Board data is smaller than declared dimensions
+        free(matrix);
         return -1;
     }
-    
+
+    *board = matrix;
+    *board_len = board_offset;
     return 0;
 }
@@ -0,0 +1,310 @@
+#include "parser.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+// =============================================================================
+// Level Parser Benchmark
+// =============================================================================
+//
+// Usage: ./ParserBench [rows cols [iterations]]
+// Generates a rows x cols level (1000 x 1000 by default) in a temporary file
+// and parses it with parse_level_file and with a byte-at-a-time reader
+// (one read() per byte, an lseek(-1) per unget - how the parser used to
+// work). Prints the read syscalls (from /proc/self/io), the lseeks (the
+// reference counts its own; parse_level_file makes none) and the wall time
+// of a parse.
+
+#define BENCH_DEFAULT_SIZE 1000
+#define BENCH_DEFAULT_ITERATIONS 5
+#define BENCH_MAX_MONS 16
+
+// =============================================================================
+// Level Generator
+// =============================================================================
+
+/**
+ * Writes a level with a wall border, dots inside and a portal every 97
+ * cells to a new temporary file. Returns its fd, or -1.
+ */
+static int generate_level(int rows, int cols, char* path, size_t path_size) {
+    snprintf(path, path_size, "/tmp/parser_bench_XXXXXX");
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return -1;
+    }
+
+    int write_fd = dup(fd);
+    FILE* file = write_fd >= 0 ? fdopen(write_fd, "w") : NULL;
+    if (!file) {
+        if (write_fd >= 0) close(write_fd);
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+    fprintf(file, "# Generated by ParserBench\nDIM %d %d\nTEMPO 100\nMON g1.m g2.m\n", rows, cols);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            char cell = 'o';
+            if (i == 0 || j == 0 || i == rows - 1 || j == cols - 1) {
+                cell = 'X';
+            } else if ((i * cols + j) % 97 == 0) {
+                cell = '@';
+            }
+            fputc(cell, file);
+        }
+        fputc('\n', file);
+    }
+    if (fclose(file) != 0) {
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+    return fd;
+}
+
+// =============================================================================
+// Byte-at-a-time Reference Reader
+// =============================================================================
+
+static long reference_lseeks = 0;
+
+static int ref_read_char(int fd, char* c) {
+    return read(fd, c, 1) == 1;
+}
+
+static void ref_unget_char(int fd) {
+    reference_lseeks++;
+    if (lseek(fd, -1, SEEK_CUR) < 0) {
+        // Nothing was read yet
+    }
+}
+
+static void ref_skip_spaces(int fd) {
+    char c;
+    while (ref_read_char(fd, &c)) {
+        if (c != ' ' && c != '\t') {
+            ref_unget_char(fd);
+            break;
+        }
+    }
+}
+
+static int ref_read_uint(int fd) {
+    int value = 0;
+    char c;
+    while (ref_read_char(fd, &c)) {
+        if (c < '0' || c > '9') {
+            ref_unget_char(fd);
+            break;
+        }
+        value = value * 10 + (c - '0');
+    }
+    return value;
+}
+
+static int ref_read_word(int fd, char* word, size_t max_len) {
+    size_t len = 0;
+    char c;
+    while (len < max_len - 1 && ref_read_char(fd, &c)) {
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            ref_unget_char(fd);
+            break;
+        }
+        word[len++] = c;
+    }
+    word[len] = '\0';
+    return (int)len;
+}
+
+/**
+ * Appends the rest of the line to out (if any), consuming the newline.
+ * Returns the characters read, or -1 at EOF.
+ */
+static long ref_read_line(int fd, char* out) {
+    long len = 0;
+    char c;
+    bool any = false;
+    while (ref_read_char(fd, &c)) {
+        any = true;
+        if (c == '\n') {
+            break;
+        }
+        if (out) {
+            out[len] = c;
+        }
+        len++;
+    }
+    return any ? len : -1;
+}
+
+/**
+ * Parses the generated level the old way. Returns the board (rows * cols
+ * characters), or NULL.
+ */
+static char* reference_parse(int fd, int* rows, int* cols, size_t* board_len) {
+    char* board = NULL;
+    size_t offset = 0;
+    *rows = 0;
+    *cols = 0;
+
+    char c;
+    while (ref_read_char(fd, &c)) {
+        if (c == 'X' || c == 'o' || c == '@') {
+            ref_unget_char(fd);
+            if (!board) {
+                board = malloc((size_t)*rows * (size_t)*cols + (size_t)*cols + 1);
+                if (!board) {
+                    return NULL;
+                }
+            }
+            long len = ref_read_line(fd, board + offset);
+            offset += (size_t)len;
+            continue;
+        }
+        if (c == '#' || c == '\n') {
+            if (c == '#') ref_read_line(fd, NULL);
+            continue;
+        }
+
+        ref_unget_char(fd);
+        char word[16];
+        ref_read_word(fd, word, sizeof(word));
+        ref_skip_spaces(fd);
+        if (strcmp(word, "DIM") == 0) {
+            *rows = ref_read_uint(fd);
+            ref_skip_spaces(fd);
+            *cols = ref_read_uint(fd);
+        } else if (strcmp(word, "TEMPO") == 0) {
+            ref_read_uint(fd);
+        }
+        ref_read_line(fd, NULL);
+    }
+
+    *board_len = offset;
+    return board;
+}
+
+// =============================================================================
+// Measurement
+// =============================================================================
+
+/**
+ * Read syscalls made by this process so far (/proc/self/io), or -1.
+ */
+static long read_syscalls(void) {
+    FILE* io = fopen("/proc/self/io", "r");
+    if (!io) {
+        return -1;
+    }
+    char line[128];
+    long syscr = -1;
+    while (fgets(line, sizeof(line), io)) {
+        if (sscanf(line, "syscr: %ld", &syscr) == 1) {
+            break;
+        }
+    }
+    fclose(io);
+    return syscr;
+}
+
+static double elapsed_ms(const struct timespec* start, const struct timespec* end) {
+    return (double)(end->tv_sec - start->tv_sec) * 1e3 + (end->tv_nsec - start->tv_nsec) / 1e6;
+}
+
+// =============================================================================
+// Main
+// =============================================================================
+
+int main(int argc, char** argv) {
+    if (argc != 1 && argc != 3 && argc != 4) {
+        fprintf(stderr, "Usage: %s [rows cols [iterations]]\n", argv[0]);
+        return 1;
+    }
+    int rows = argc > 1 ? atoi(argv[1]) : BENCH_DEFAULT_SIZE;
+    int cols = argc > 1 ? atoi(argv[2]) : BENCH_DEFAULT_SIZE;
+    int iterations = argc > 3 ? atoi(argv[3]) : BENCH_DEFAULT_ITERATIONS;
+    if (rows < 3 || cols < 3 || iterations <= 0) {
+        fprintf(stderr, "Error: rows and cols must be at least 3, iterations positive\n");
+        return 1;
+    }
+
+    char path[64];
+    int fd = generate_level(rows, cols, path, sizeof(path));
+    if (fd < 0) {
+        fprintf(stderr, "Error: cannot generate level: %s\n", strerror(errno));
+        return 1;
+    }
+    unlink(path);
+    off_t file_size = lseek(fd, 0, SEEK_END);
+
+    int ref_rows = 0, ref_cols = 0;
+    size_t ref_len = 0;
+    char* ref_board = NULL;
+    long ref_reads = 0, ref_lseeks = 0;
+    double ref_ms = 0;
+
+    int lvl_rows = 0, lvl_cols = 0, tempo, n_mons;
+    char pac_file[256];
+    char mon_files[BENCH_MAX_MONS][256];
+    size_t lvl_len = 0;
+    char* lvl_board = NULL;
+    long lvl_reads = 0, lvl_lseeks = 0;
+    double lvl_ms = 0;
+
+    // Reads made by read_syscalls itself, taken off every count
+    long overhead = read_syscalls();
+    overhead = read_syscalls() - overhead;
+
+    for (int i = 0; i < iterations; i++) {
+        struct timespec start, end;
+
+        free(ref_board);
+        lseek(fd, 0, SEEK_SET);
+        long reads = read_syscalls();
+        long lseeks = reference_lseeks;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        ref_board = reference_parse(fd, &ref_rows, &ref_cols, &ref_len);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ref_reads += read_syscalls() - reads - overhead;
+        ref_lseeks += reference_lseeks - lseeks;
+        ref_ms += elapsed_ms(&start, &end);
+
+        free(lvl_board);
+        lseek(fd, 0, SEEK_SET);
+        reads = read_syscalls();
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int result = parse_level_file(fd, &lvl_rows, &lvl_cols, &tempo, pac_file, mon_files,
+                                      BENCH_MAX_MONS, &n_mons, &lvl_board, &lvl_len);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        lvl_reads += read_syscalls() - reads - overhead;
+        lvl_ms += elapsed_ms(&start, &end);
+        if (result < 0) {
+            fprintf(stderr, "Error: parse_level_file failed\n");
+            close(fd);
+            return 1;
+        }
+    }
+    close(fd);
+
+    // Both must read the same board
+    bool same = ref_board && lvl_board && ref_rows == lvl_rows && ref_cols == lvl_cols &&
+                ref_len == lvl_len && memcmp(ref_board, lvl_board, lvl_len) == 0;
+    free(ref_board);
+    free(lvl_board);
+
+    printf("Level %dx%d (%ld bytes), %d parses each\n", rows, cols, (long)file_size, iterations);
+    printf("                  reads/parse  lseeks/parse  ms/parse\n");
+    printf("byte-at-a-time   %12ld  %12ld  %8.2f\n", ref_reads / iterations,
+           ref_lseeks / iterations, ref_ms / iterations);
+    printf("parse_level_file %12ld  %12ld  %8.2f\n", lvl_reads / iterations,
+           lvl_lseeks / iterations, lvl_ms / iterations);
+    printf("Boards %s\n", same ? "match" : "DIFFER");
+
+    return same ? 0 : 1;
+}
@@ -1,114 +1,324 @@
 #include "pc_buffer.h"
 #include "display.h"
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 
-int pc_buffer_init(pc_buffer_t* buf) {
-    buf->head = 0;
-    buf->tail = 0;
-    buf->shutdown = false;
-    
-    // Initialize mutex
-    if (pthread_mutex_init(&buf->mutex, NULL) != 0) {
-        debug("[PC Buffer] Failed to init mutex: %s\n", strerror(errno));
+// Times a full/empty ring is retried (yielding the CPU) before parking
+#define PC_BUFFER_SPIN_TRIES 4
+
+// Wake tokens posted at shutdown (more than there are threads)
+#define PC_BUFFER_SHUTDOWN_TOKENS (1u << 20)
+
+// =============================================================================
+// Lock-Free Ring
+// =============================================================================
+
+/**
+ * Claims the next free slot and fills it.
+ * Returns false if the ring is full.
+ */
+static bool try_enqueue(pc_buffer_t* buf, const connection_request_t* request) {
+    size_t pos = atomic_load_explicit(&buf->enqueue_pos, memory_order_relaxed);
+    pc_slot_t* slot;
+
+    while (true) {
+        slot = &buf->slots[pos & buf->mask];
+        size_t seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if (diff == 0) {
+            // Slot is free for this position - claim it
+            if (atomic_compare_exchange_weak_explicit(&buf->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Slot still holds the request from one lap ago
+            return false;
+        } else {
+            // Another producer claimed this position
+            pos = atomic_load_explicit(&buf->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    memcpy(&slot->request, request, sizeof(connection_request_t));
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * Claims the oldest full slot and empties it.
+ * Returns false if the ring is empty.
+ */
+static bool try_dequeue(pc_buffer_t* buf, connection_request_t* request) {
+    size_t pos = atomic_load_explicit(&buf->dequeue_pos, memory_order_relaxed);
+    pc_slot_t* slot;
+
+    while (true) {
+        slot = &buf->slots[pos & buf->mask];
+        size_t seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+
+        if (diff == 0) {
+            // Slot is full for this position - claim it
+            if (atomic_compare_exchange_weak_explicit(&buf->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Not filled yet
+            return false;
+        } else {
+            // Another consumer claimed this position
+            pos = atomic_load_explicit(&buf->dequeue_pos, memory_order_relaxed);
+        }
+    }
+
+    memcpy(request, &slot->request, sizeof(connection_request_t));
+    // Free the slot for the producer one lap ahead
+    atomic_store_explicit(&slot->sequence, pos + buf->mask + 1, memory_order_release);
+    return true;
+}
+
+static bool ring_full(pc_buffer_t* buf) {
+    size_t pos = atomic_load(&buf->enqueue_pos);
+    size_t seq = atomic_load(&buf->slots[pos & buf->mask].sequence);
+    return (intptr_t)seq - (intptr_t)pos < 0;
+}
+
+static bool ring_empty(pc_buffer_t* buf) {
+    size_t pos = atomic_load(&buf->dequeue_pos);
+    size_t seq = atomic_load(&buf->slots[pos & buf->mask].sequence);
+    return (intptr_t)seq - (intptr_t)(pos + 1) < 0;
+}
+
+// =============================================================================
+// Parking (slow path only)
+// =============================================================================
+
+/**
+ * Wakes one thread parked on event_fd, unless every parked thread already
+ * has a wake token on its way (a write is a syscall; skipping redundant
+ * ones keeps a busy producer from paying for it on every insert).
+ * The fence pairs with the one in park(): either the waiter sees our
+ * update to the ring, or we see its waiter count.
+ */
+static void wake_one(atomic_int* waiting, atomic_int* tokens, int event_fd) {
+    atomic_thread_fence(memory_order_seq_cst);
+    int n_waiting = atomic_load_explicit(waiting, memory_order_relaxed);
+    int n_tokens = atomic_load_explicit(tokens, memory_order_relaxed);
+
+    while (n_tokens < n_waiting) {
+        if (atomic_compare_exchange_weak(tokens, &n_tokens, n_tokens + 1)) {
+            uint64_t one = 1;
+            if (write(event_fd, &one, sizeof(one)) < 0) {
+                // Counter saturated - every parked thread is being woken anyway
+            }
+            return;
+        }
+    }
+}
+
+/**
+ * Sleeps until a wake token arrives, unless blocked() is already false or
+ * the buffer is shut down. A token meant for another waiter (or left over)
+ * only costs the caller one more retry.
+ */
+static void park(pc_buffer_t* buf, atomic_int* waiting, atomic_int* tokens, int event_fd,
+                 bool (*blocked)(pc_buffer_t*)) {
+    atomic_fetch_add(waiting, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if (!atomic_load(&buf->shutdown) && blocked(buf)) {
+        uint64_t token;
+        while (read(event_fd, &token, sizeof(token)) < 0 && errno == EINTR) {
+            // Signal handler ran - keep waiting for the token
+        }
+        // Still counted as waiting here, so wakers never see us as covered twice
+        atomic_fetch_sub(tokens, 1);
+    }
+
+    atomic_fetch_sub(waiting, 1);
+}
+
+// =============================================================================
+// Buffer API
+// =============================================================================
+
+int pc_buffer_init(pc_buffer_t* buf, size_t capacity) {
+    // Round capacity up to a power of two (positions are masked, not divided)
+    size_t size = 2;
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    buf->slots = malloc(sizeof(pc_slot_t) * size);
+    if (!buf->slots) {
+        debug("[PC Buffer] Failed to allocate %zu slots\n", size);
         return -1;
     }
-    
-    // Initialize semaphore for empty slots (starts at buffer size)
-    if (sem_init(&buf->sem_empty, 0, PC_BUFFER_SIZE) != 0) {
-        debug("[PC Buffer] Failed to init sem_empty: %s\n", strerror(errno));
-        pthread_mutex_destroy(&buf->mutex);
+    buf->capacity = size;
+    buf->mask = size - 1;
+
+    for (size_t i = 0; i < size; i++) {
+        atomic_init(&buf->slots[i].sequence, i);
+    }
+    atomic_init(&buf->enqueue_pos, 0);
+    atomic_init(&buf->dequeue_pos, 0);
+    atomic_init(&buf->waiting_consumers, 0);
+    atomic_init(&buf->waiting_producers, 0);
+    atomic_init(&buf->not_empty_tokens, 0);
+    atomic_init(&buf->not_full_tokens, 0);
+    atomic_init(&buf->shutdown, false);
+
+    // Semaphore-mode eventfds: each token written wakes one parked thread
+    buf->not_empty_fd = eventfd(0, EFD_SEMAPHORE | EFD_CLOEXEC);
+    if (buf->not_empty_fd < 0) {
+        debug("[PC Buffer] Failed to create not_empty eventfd: %s\n", strerror(errno));
+        free(buf->slots);
         return -1;
     }
-    
-    // Initialize semaphore for full slots (starts at 0)
-    if (sem_init(&buf->sem_full, 0, 0) != 0) {
-        debug("[PC Buffer] Failed to init sem_full: %s\n", strerror(errno));
-        sem_destroy(&buf->sem_empty);
-        pthread_mutex_destroy(&buf->mutex);
+
+    buf->not_full_fd = eventfd(0, EFD_SEMAPHORE | EFD_CLOEXEC);
+    if (buf->not_full_fd < 0) {
+        debug("[PC Buffer] Failed to create not_full eventfd: %s\n", strerror(errno));
+        close(buf->not_empty_fd);
+        free(buf->slots);
         return -1;
     }
-    
-    debug("[PC Buffer] Initialized successfully\n");
+
+    debug("[PC Buffer] Initialized successfully (capacity %zu)\n", size);
     return 0;
 }
 
 void pc_buffer_destroy(pc_buffer_t* buf) {
-    sem_destroy(&buf->sem_full);
-    sem_destroy(&buf->sem_empty);
-    pthread_mutex_destroy(&buf->mutex);
+    close(buf->not_full_fd);
+    close(buf->not_empty_fd);
+    free(buf->slots);
+    buf->slots = NULL;
     debug("[PC Buffer] Destroyed\n");
 }
 
 int pc_buffer_insert(pc_buffer_t* buf, const connection_request_t* request) {
-    // Wait for an empty slot
-    if (sem_wait(&buf->sem_empty) != 0) {
-        return -1;
-    }
-    
-    // Check for shutdown
-    if (buf->shutdown) {
-        sem_post(&buf->sem_empty);  // Release for others
-        return -1;
+    int tries = 0;
+    while (true) {
+        // Check for shutdown
+        if (atomic_load(&buf->shutdown)) {
+            return -1;
+        }
+
+        if (try_enqueue(buf, request)) {
+            break;
+        }
+
+        // Full - give consumers a moment, then wait for one
+        if (++tries <= PC_BUFFER_SPIN_TRIES) {
+            sched_yield();
+            continue;
+        }
+        park(buf, &buf->waiting_producers, &buf->not_full_tokens, buf->not_full_fd, ring_full);
     }
-    
-    // Lock mutex to access buffer
-    pthread_mutex_lock(&buf->mutex);
-    
-    // Insert request at head
-    memcpy(&buf->buffer[buf->head], request, sizeof(connection_request_t));
-    buf->head = (buf->head + 1) % PC_BUFFER_SIZE;
-    
-    debug("[PC Buffer] Inserted request (req=%s, notif=%s)\n", 
+
+    debug("[PC Buffer] Inserted request (req=%s, notif=%s)\n",
           request->req_pipe_path, request->notif_pipe_path);
-    
-    pthread_mutex_unlock(&buf->mutex);
-    
+
     // Signal that there's a full slot
-    sem_post(&buf->sem_full);
-    
+    wake_one(&buf->waiting_consumers, &buf->not_empty_tokens, buf->not_empty_fd);
+
     return 0;
 }
 
-int pc_buffer_remove(pc_buffer_t* buf, connection_request_t* request) {
-    // Wait for a full slot
-    if (sem_wait(&buf->sem_full) != 0) {
-        return -1;
+int pc_buffer_insert_many(pc_buffer_t* buf, const connection_request_t* requests, int count) {
+    for (int i = 0; i < count; i++) {
+        if (pc_buffer_insert(buf, &requests[i]) < 0) {
+            return -1;
+        }
     }
-    
-    // Check for shutdown
-    if (buf->shutdown) {
-        sem_post(&buf->sem_full);  // Release for others
+
+    return 0;
+}
+
+int pc_buffer_try_insert_many(pc_buffer_t* buf, const connection_request_t* requests, int count) {
+    if (atomic_load(&buf->shutdown)) {
         return -1;
     }
-    
-    // Lock mutex to access buffer
-    pthread_mutex_lock(&buf->mutex);
-    
-    // Remove request from tail
-    memcpy(request, &buf->buffer[buf->tail], sizeof(connection_request_t));
-    buf->tail = (buf->tail + 1) % PC_BUFFER_SIZE;
-    
-    debug("[PC Buffer] Removed request (req=%s, notif=%s)\n", 
+
+    int inserted = 0;
+    while (inserted < count && try_enqueue(buf, &requests[inserted])) {
+        inserted++;
+    }
+
+    // Signal the full slots, one parked consumer each
+    for (int i = 0; i < inserted; i++) {
+        wake_one(&buf->waiting_consumers, &buf->not_empty_tokens, buf->not_empty_fd);
+    }
+
+    return inserted;
+}
+
+bool pc_buffer_watch_not_full(pc_buffer_t* buf) {
+    // Same handshake as park(), with the caller's poll() as the read
+    atomic_fetch_add(&buf->waiting_producers, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if (atomic_load(&buf->shutdown) || !ring_full(buf)) {
+        atomic_fetch_sub(&buf->waiting_producers, 1);
+        return false;
+    }
+    return true;
+}
+
+void pc_buffer_unwatch_not_full(pc_buffer_t* buf) {
+    uint64_t token;
+    while (read(buf->not_full_fd, &token, sizeof(token)) < 0 && errno == EINTR) {
+        // Signal handler ran - the token is still there
+    }
+    atomic_fetch_sub(&buf->not_full_tokens, 1);
+    atomic_fetch_sub(&buf->waiting_producers, 1);
+}
+
+int pc_buffer_remove(pc_buffer_t* buf, connection_request_t* request) {
+    int tries = 0;
+    while (true) {
+        // Check for shutdown
+        if (atomic_load(&buf->shutdown)) {
+            return -1;
+        }
+
+        if (try_dequeue(buf, request)) {
+            break;
+        }
+
+        // Empty - give producers a moment, then wait for one
+        if (++tries <= PC_BUFFER_SPIN_TRIES) {
+            sched_yield();
+            continue;
+        }
+        park(buf, &buf->waiting_consumers, &buf->not_empty_tokens, buf->not_empty_fd, ring_empty);
+    }
+
+    debug("[PC Buffer] Removed request (req=%s, notif=%s)\n",
           request->req_pipe_path, request->notif_pipe_path);
-    
-    pthread_mutex_unlock(&buf->mutex);
-    
+
     // Signal that there's an empty slot
-    sem_post(&buf->sem_empty);
-    
+    wake_one(&buf->waiting_producers, &buf->not_full_tokens, buf->not_full_fd);
+
     return 0;
 }
 
 void pc_buffer_shutdown(pc_buffer_t* buf) {
-    buf->shutdown = true;
-    
-    // Wake up all waiting threads by posting to both semaphores
-    // Post multiple times to ensure all consumers wake up
-    for (int i = 0; i < PC_BUFFER_SIZE + 1; i++) {
-        sem_post(&buf->sem_full);
-        sem_post(&buf->sem_empty);
-    }
-    
-    debug("[PC Buffer] Shutdown signaled\n");
+    atomic_store(&buf->shutdown, true);
+
+    // Wake up all parked threads: enough tokens for every one of them,
+    // and threads parking from now on see the flag first
+    uint64_t tokens = PC_BUFFER_SHUTDOWN_TOKENS;
+    if (write(buf->not_empty_fd, &tokens, sizeof(tokens)) < 0 ||
+        write(buf->not_full_fd, &tokens, sizeof(tokens)) < 0) {
+        // Counter saturated - already shut down
+    }
 }
@@ -0,0 +1,244 @@
+#include "pc_buffer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+#include <unistd.h>
+
+// =============================================================================
+// Request Buffer Contention Benchmark
+// =============================================================================
+//
+// Usage: ./PcBufferBench [producers consumers [capacity [requests]]]
+// Without arguments, runs a matrix of thread counts and capacities.
+// Each run moves the same requests through pc_buffer and through a
+// mutex + two semaphores queue (the design pc_buffer replaced) and prints
+// their throughput in millions of requests per second.
+
+#define BENCH_DEFAULT_REQUESTS 2000000
+#define BENCH_MAX_THREADS 64
+
+// =============================================================================
+// Reference Queue (mutex + two semaphores)
+// =============================================================================
+
+typedef struct {
+    connection_request_t* slots;
+    size_t capacity;
+    size_t head;
+    size_t tail;
+    pthread_mutex_t mutex;
+    sem_t empty;                        // Free slots
+    sem_t full;                         // Filled slots
+    atomic_bool shutdown;
+} locked_queue_t;
+
+static int locked_queue_init(locked_queue_t* queue, size_t capacity) {
+    memset(queue, 0, sizeof(locked_queue_t));
+    queue->slots = malloc(sizeof(connection_request_t) * capacity);
+    if (!queue->slots) {
+        return -1;
+    }
+    queue->capacity = capacity;
+    atomic_init(&queue->shutdown, false);
+    pthread_mutex_init(&queue->mutex, NULL);
+    sem_init(&queue->empty, 0, (unsigned int)capacity);
+    sem_init(&queue->full, 0, 0);
+    return 0;
+}
+
+static void locked_queue_destroy(locked_queue_t* queue) {
+    sem_destroy(&queue->full);
+    sem_destroy(&queue->empty);
+    pthread_mutex_destroy(&queue->mutex);
+    free(queue->slots);
+}
+
+static int locked_queue_insert(locked_queue_t* queue, const connection_request_t* request) {
+    while (sem_wait(&queue->empty) < 0 && errno == EINTR) {
+    }
+    if (atomic_load(&queue->shutdown)) {
+        return -1;
+    }
+    pthread_mutex_lock(&queue->mutex);
+    queue->slots[queue->tail] = *request;
+    queue->tail = (queue->tail + 1) % queue->capacity;
+    pthread_mutex_unlock(&queue->mutex);
+    sem_post(&queue->full);
+    return 0;
+}
+
+static int locked_queue_remove(locked_queue_t* queue, connection_request_t* request) {
+    while (sem_wait(&queue->full) < 0 && errno == EINTR) {
+    }
+    if (atomic_load(&queue->shutdown)) {
+        return -1;
+    }
+    pthread_mutex_lock(&queue->mutex);
+    *request = queue->slots[queue->head];
+    queue->head = (queue->head + 1) % queue->capacity;
+    pthread_mutex_unlock(&queue->mutex);
+    sem_post(&queue->empty);
+    return 0;
+}
+
+static void locked_queue_shutdown(locked_queue_t* queue) {
+    atomic_store(&queue->shutdown, true);
+    for (int i = 0; i < BENCH_MAX_THREADS; i++) {
+        sem_post(&queue->full);
+        sem_post(&queue->empty);
+    }
+}
+
+// =============================================================================
+// Benchmark Threads
+// =============================================================================
+
+/**
+ * One run: the same request count through either queue.
+ */
+typedef struct {
+    bool use_ring;
+    pc_buffer_t ring;
+    locked_queue_t locked;
+
+    long per_producer;
+    long total;
+    atomic_long consumed;
+} bench_run_t;
+
+static int run_insert(bench_run_t* run, const connection_request_t* request) {
+    return run->use_ring ? pc_buffer_insert(&run->ring, request) :
+                           locked_queue_insert(&run->locked, request);
+}
+
+static int run_remove(bench_run_t* run, connection_request_t* request) {
+    return run->use_ring ? pc_buffer_remove(&run->ring, request) :
+                           locked_queue_remove(&run->locked, request);
+}
+
+static void* producer_func(void* arg) {
+    bench_run_t* run = arg;
+    connection_request_t request;
+    memset(&request, 0, sizeof(request));
+    snprintf(request.req_pipe_path, sizeof(request.req_pipe_path), "/tmp/bench_req");
+    snprintf(request.notif_pipe_path, sizeof(request.notif_pipe_path), "/tmp/bench_notif");
+
+    for (long i = 0; i < run->per_producer; i++) {
+        if (run_insert(run, &request) < 0) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+static void* consumer_func(void* arg) {
+    bench_run_t* run = arg;
+    connection_request_t request;
+
+    // The consumer taking the last request stops the others
+    while (run_remove(run, &request) == 0) {
+        if (atomic_fetch_add(&run->consumed, 1) + 1 == run->total) {
+            if (run->use_ring) {
+                pc_buffer_shutdown(&run->ring);
+            } else {
+                locked_queue_shutdown(&run->locked);
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Moves requests through one queue. Returns millions of requests per
+ * second, or -1 on error.
+ */
+static double bench(bool use_ring, int producers, int consumers, size_t capacity, long requests) {
+    bench_run_t* run = calloc(1, sizeof(bench_run_t));
+    if (!run) {
+        return -1;
+    }
+    run->use_ring = use_ring;
+    run->per_producer = requests / producers;
+    run->total = run->per_producer * producers;
+    atomic_init(&run->consumed, 0);
+
+    int result = use_ring ? pc_buffer_init(&run->ring, capacity) :
+                            locked_queue_init(&run->locked, capacity);
+    if (result < 0) {
+        free(run);
+        return -1;
+    }
+
+    pthread_t threads[2 * BENCH_MAX_THREADS];
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < consumers; i++) {
+        pthread_create(&threads[i], NULL, consumer_func, run);
+    }
+    for (int i = 0; i < producers; i++) {
+        pthread_create(&threads[consumers + i], NULL, producer_func, run);
+    }
+    for (int i = 0; i < producers + consumers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (use_ring) {
+        pc_buffer_destroy(&run->ring);
+    } else {
+        locked_queue_destroy(&run->locked);
+    }
+    double seconds = (double)(end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    double mops = (double)run->total / seconds / 1e6;
+    free(run);
+    return mops;
+}
+
+static void bench_line(int producers, int consumers, size_t capacity, long requests) {
+    double locked = bench(false, producers, consumers, capacity, requests);
+    double ring = bench(true, producers, consumers, capacity, requests);
+    printf("%3d x %-3d  %8zu  %12.2f  %12.2f\n", producers, consumers, capacity, locked, ring);
+}
+
+// =============================================================================
+// Main
+// =============================================================================
+
+int main(int argc, char** argv) {
+    if (argc != 1 && argc != 3 && argc != 4 && argc != 5) {
+        fprintf(stderr, "Usage: %s [producers consumers [capacity [requests]]]\n", argv[0]);
+        return 1;
+    }
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    printf("Online cores: %ld\n", cores);
+    printf("  P x C    capacity  locked Mops/s  ring Mops/s\n");
+
+    if (argc == 1) {
+        static const int threads[] = {1, 4, 8, 16};
+        static const size_t capacities[] = {16, 1024};
+        for (size_t c = 0; c < sizeof(capacities) / sizeof(capacities[0]); c++) {
+            for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+                bench_line(threads[t], threads[t], capacities[c], BENCH_DEFAULT_REQUESTS);
+            }
+        }
+        return 0;
+    }
+
+    int producers = atoi(argv[1]);
+    int consumers = atoi(argv[2]);
+    long capacity = argc > 3 ? atol(argv[3]) : PC_BUFFER_SIZE;
+    long requests = argc > 4 ? atol(argv[4]) : BENCH_DEFAULT_REQUESTS;
+    if (producers <= 0 || consumers <= 0 || producers > BENCH_MAX_THREADS ||
+        consumers > BENCH_MAX_THREADS || capacity <= 0 || requests < producers) {
+        fprintf(stderr, "Error: 1-%d producers and consumers, a positive capacity, "
+                "and at least one request per producer\n", BENCH_MAX_THREADS);
+        return 1;
+    }
+    bench_line(producers, consumers, (size_t)capacity, requests);
+    return 0;
+}
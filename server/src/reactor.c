@@ -0,0 +1,224 @@
+#include "reactor.h"
+#include "display.h"
+#include "leaderboard.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+// epoll data of the stop eventfd (no slot uses it)
+#define REACTOR_WAKE_TOKEN UINT64_MAX
+
+// =============================================================================
+// Event Handling
+// =============================================================================
+
+static uint64_t slot_token(reactor_t* reactor, int index) {
+    return ((uint64_t)reactor->slots[index].generation << 32) | (uint32_t)index;
+}
+
+/**
+ * Reads one session's pending messages.
+ * Called with reactor->mutex held, so the session cannot be removed meanwhile.
+ */
+static void handle_session_event(reactor_t* reactor, int index) {
+    reactor_slot_t* slot = &reactor->slots[index];
+    client_session_t* session = slot->session;
+
+    int status = session_read_input(session);
+    if (status == SESSION_INPUT_OPEN) {
+        return;
+    }
+
+    // Input is over - stop watching the FIFO (it would stay readable at EOF)
+    // and let the game end now instead of at its next tick
+    epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, session->req_pipe_fd, NULL);
+    scheduler_wake(reactor->scheduler, slot->task);
+}
+
+static void* reactor_thread_func(void* arg) {
+    reactor_t* reactor = (reactor_t*)arg;
+    struct epoll_event events[REACTOR_EVENT_BATCH];
+
+    // Block SIGUSR1 - only host thread should receive it
+    block_sigusr1();
+
+    debug("[Reactor] Thread started\n");
+
+    while (reactor->running) {
+        int n_events = epoll_wait(reactor->epoll_fd, events, REACTOR_EVENT_BATCH, -1);
+        if (n_events < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            debug("[Reactor] epoll_wait failed: %s\n", strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < n_events; i++) {
+            uint64_t token = events[i].data.u64;
+            if (token == REACTOR_WAKE_TOKEN) {
+                continue;  // Shutdown - running is already false
+            }
+
+            int index = (int)(uint32_t)token;
+            pthread_mutex_lock(&reactor->mutex);
+            if (reactor->slots[index].session && slot_token(reactor, index) == token) {
+                handle_session_event(reactor, index);
+            }
+            pthread_mutex_unlock(&reactor->mutex);
+        }
+    }
+
+    debug("[Reactor] Thread exiting\n");
+    return NULL;
+}
+
+// =============================================================================
+// Reactor Management
+// =============================================================================
+
+int reactor_init(reactor_t* reactor, scheduler_t* scheduler, int capacity) {
+    memset(reactor, 0, sizeof(reactor_t));
+    reactor->scheduler = scheduler;
+    reactor->capacity = capacity;
+
+    reactor->slots = calloc((size_t)capacity, sizeof(reactor_slot_t));
+    reactor->free_slots = malloc(sizeof(int) * (size_t)capacity);
+    if (!reactor->slots || !reactor->free_slots) {
+        debug("[Reactor] Failed to allocate %d slots\n", capacity);
+        free(reactor->slots);
+        free(reactor->free_slots);
+        return -1;
+    }
+
+    // Hand out low indices first
+    for (int i = 0; i < capacity; i++) {
+        reactor->free_slots[i] = capacity - 1 - i;
+    }
+    reactor->n_free = capacity;
+
+    reactor->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (reactor->epoll_fd < 0) {
+        debug("[Reactor] Failed to create epoll instance: %s\n", strerror(errno));
+        free(reactor->slots);
+        free(reactor->free_slots);
+        return -1;
+    }
+
+    reactor->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    struct epoll_event ev = { .events = EPOLLIN, .data.u64 = REACTOR_WAKE_TOKEN };
+    if (reactor->wake_fd < 0 ||
+        epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, reactor->wake_fd, &ev) < 0) {
+        debug("[Reactor] Failed to set up wake eventfd: %s\n", strerror(errno));
+        if (reactor->wake_fd >= 0) {
+            close(reactor->wake_fd);
+        }
+        close(reactor->epoll_fd);
+        free(reactor->slots);
+        free(reactor->free_slots);
+        return -1;
+    }
+
+    if (pthread_mutex_init(&reactor->mutex, NULL) != 0) {
+        close(reactor->wake_fd);
+        close(reactor->epoll_fd);
+        free(reactor->slots);
+        free(reactor->free_slots);
+        return -1;
+    }
+
+    return 0;
+}
+
+int reactor_start(reactor_t* reactor) {
+    reactor->running = true;
+
+    if (pthread_create(&reactor->thread, NULL, reactor_thread_func, reactor) != 0) {
+        debug("[Reactor] Failed to create thread: %s\n", strerror(errno));
+        reactor->running = false;
+        return -1;
+    }
+
+    return 0;
+}
+
+int reactor_add(reactor_t* reactor, client_session_t* session, sched_task_t* task) {
+    pthread_mutex_lock(&reactor->mutex);
+
+    if (reactor->n_free == 0) {
+        pthread_mutex_unlock(&reactor->mutex);
+        debug("[Reactor] No free slot for session\n");
+        return -1;
+    }
+
+    int index = reactor->free_slots[--reactor->n_free];
+    reactor_slot_t* slot = &reactor->slots[index];
+    slot->session = session;
+    slot->task = task;
+    slot->generation++;
+
+    // Level-triggered: a read that stops early is simply resumed
+    struct epoll_event ev = { .events = EPOLLIN, .data.u64 = slot_token(reactor, index) };
+    if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, session->req_pipe_fd, &ev) < 0) {
+        debug("[Reactor] Failed to watch request FIFO: %s\n", strerror(errno));
+        slot->session = NULL;
+        slot->task = NULL;
+        reactor->free_slots[reactor->n_free++] = index;
+        pthread_mutex_unlock(&reactor->mutex);
+        return -1;
+    }
+
+    session->reactor_slot = index;
+    pthread_mutex_unlock(&reactor->mutex);
+    return 0;
+}
+
+void reactor_remove(reactor_t* reactor, client_session_t* session) {
+    if (session->reactor_slot < 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&reactor->mutex);
+
+    int index = session->reactor_slot;
+    reactor_slot_t* slot = &reactor->slots[index];
+
+    // Already removed if the client's input ended - ENOENT is fine
+    epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, session->req_pipe_fd, NULL);
+    slot->session = NULL;
+    slot->task = NULL;
+    slot->generation++;
+    reactor->free_slots[reactor->n_free++] = index;
+    session->reactor_slot = -1;
+
+    pthread_mutex_unlock(&reactor->mutex);
+}
+
+void reactor_shutdown(reactor_t* reactor) {
+    if (!reactor->running) {
+        return;
+    }
+
+    reactor->running = false;
+    uint64_t one = 1;
+    if (write(reactor->wake_fd, &one, sizeof(one)) < 0) {
+        debug("[Reactor] Failed to wake thread: %s\n", strerror(errno));
+    }
+
+    pthread_join(reactor->thread, NULL);
+    debug("[Reactor] Stopped\n");
+}
+
+void reactor_destroy(reactor_t* reactor) {
+    pthread_mutex_destroy(&reactor->mutex);
+    close(reactor->wake_fd);
+    close(reactor->epoll_fd);
+    free(reactor->slots);
+    free(reactor->free_slots);
+    reactor->slots = NULL;
+    reactor->free_slots = NULL;
+}
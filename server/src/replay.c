@@ -0,0 +1,371 @@
+#include "replay.h"
+#include "protocol.h"
+#include "display.h"
+#include "leaderboard.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// =============================================================================
+// Writer Thread
+// =============================================================================
+
+/**
+ * Writes a whole chunk (no lock held). After a failed write the file is cut
+ * back to the end of the last whole chunk (chunks hold whole records) and
+ * nothing more is written to it, so it stays a valid stream, just shorter.
+ */
+static void write_chunk(replay_writer_t* writer, replay_chunk_t* chunk) {
+    replay_output_t* file = chunk->file;
+    size_t done = 0;
+    while (!atomic_load(&file->failed) && done < chunk->size) {
+        ssize_t written = write(file->fd, chunk->data + done, chunk->size - done);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            debug("[Replay] Failed to write replay, truncating it: %s\n", strerror(errno));
+            off_t end = lseek(file->fd, 0, SEEK_CUR);
+            if (end >= 0 && ftruncate(file->fd, end - (off_t)done) < 0) {
+                debug("[Replay] Failed to truncate replay: %s\n", strerror(errno));
+            }
+            atomic_store(&file->failed, true);
+            atomic_fetch_add(&writer->dropped, 1);
+            done = 0;
+            break;
+        }
+        done += (size_t)written;
+    }
+    atomic_fetch_add(&writer->bytes, (long)done);
+
+    if (chunk->close_fd) {
+        close(file->fd);
+        free(file);
+    }
+}
+
+static void* replay_writer_thread_func(void* arg) {
+    replay_writer_t* writer = (replay_writer_t*)arg;
+
+    // Block SIGUSR1 - only host thread should receive it
+    block_sigusr1();
+
+    pthread_mutex_lock(&writer->mutex);
+    while (writer->running || writer->head) {
+        if (!writer->head) {
+            pthread_cond_wait(&writer->work, &writer->mutex);
+            continue;
+        }
+
+        replay_chunk_t* chunk = writer->head;
+        writer->head = chunk->next;
+        if (!writer->head) {
+            writer->tail = NULL;
+        }
+        pthread_mutex_unlock(&writer->mutex);
+
+        write_chunk(writer, chunk);
+
+        pthread_mutex_lock(&writer->mutex);
+        writer->queued_bytes -= chunk->size;
+        free(chunk->data);
+        free(chunk);
+    }
+    pthread_mutex_unlock(&writer->mutex);
+
+    return NULL;
+}
+
+/**
+ * Queues bytes for the writer, which takes ownership of data.
+ * Returns -1 (data freed) if the writer is too far behind, unless the chunk
+ * closes the file (the file must always be closed).
+ */
+static int submit_chunk(replay_writer_t* writer, replay_output_t* file, char* data, size_t size,
+                        bool close_fd) {
+    replay_chunk_t* chunk = malloc(sizeof(replay_chunk_t));
+    if (!chunk) {
+        free(data);
+        if (close_fd) {
+            close(file->fd);
+            free(file);
+        }
+        return -1;
+    }
+    chunk->file = file;
+    chunk->data = data;
+    chunk->size = size;
+    chunk->close_fd = close_fd;
+    chunk->next = NULL;
+
+    pthread_mutex_lock(&writer->mutex);
+    if (!close_fd && writer->queued_bytes + size > REPLAY_MAX_QUEUED) {
+        pthread_mutex_unlock(&writer->mutex);
+        free(data);
+        free(chunk);
+        return -1;
+    }
+    writer->queued_bytes += size;
+    if (writer->tail) {
+        writer->tail->next = chunk;
+    } else {
+        writer->head = chunk;
+    }
+    writer->tail = chunk;
+    pthread_cond_signal(&writer->work);
+    pthread_mutex_unlock(&writer->mutex);
+
+    return 0;
+}
+
+// =============================================================================
+// Writer Management
+// =============================================================================
+
+int replay_writer_init(replay_writer_t* writer, const char* dir) {
+    memset(writer, 0, sizeof(replay_writer_t));
+    writer->dir = dir;
+    atomic_init(&writer->next_file, 0);
+    atomic_init(&writer->files, 0);
+    atomic_init(&writer->dropped, 0);
+    atomic_init(&writer->bytes, 0);
+
+    if (pthread_mutex_init(&writer->mutex, NULL) != 0) {
+        return -1;
+    }
+    if (pthread_cond_init(&writer->work, NULL) != 0) {
+        pthread_mutex_destroy(&writer->mutex);
+        return -1;
+    }
+
+    return 0;
+}
+
+int replay_writer_start(replay_writer_t* writer) {
+    writer->running = true;
+
+    if (pthread_create(&writer->thread, NULL, replay_writer_thread_func, writer) != 0) {
+        debug("[Replay] Failed to create writer thread: %s\n", strerror(errno));
+        writer->running = false;
+        return -1;
+    }
+
+    return 0;
+}
+
+void replay_writer_shutdown(replay_writer_t* writer) {
+    pthread_mutex_lock(&writer->mutex);
+    bool was_running = writer->running;
+    writer->running = false;
+    pthread_cond_broadcast(&writer->work);
+    pthread_mutex_unlock(&writer->mutex);
+
+    if (was_running) {
+        pthread_join(writer->thread, NULL);
+    }
+
+    debug("[Replay] Stopped (replays=%ld truncated=%ld bytes=%ld)\n",
+          atomic_load(&writer->files), atomic_load(&writer->dropped),
+          atomic_load(&writer->bytes));
+}
+
+void replay_writer_destroy(replay_writer_t* writer) {
+    pthread_cond_destroy(&writer->work);
+    pthread_mutex_destroy(&writer->mutex);
+}
+
+// =============================================================================
+// Recorder
+// =============================================================================
+
+/**
+ * Hands the buffered records to the writer. On failure the recording stops.
+ */
+static void flush_chunk(replay_recorder_t* rec) {
+    if (rec->chunk_size == 0) {
+        return;
+    }
+
+    if (atomic_load(&rec->file->failed)) {
+        // The writer hit an error and already counted it
+        free(rec->chunk);
+        rec->failed = true;
+    } else if (submit_chunk(rec->writer, rec->file, rec->chunk, rec->chunk_size, false) < 0) {
+        debug("[Replay] Writer is behind, truncating replay (fd %d)\n", rec->file->fd);
+        atomic_fetch_add(&rec->writer->dropped, 1);
+        rec->failed = true;
+    }
+    rec->chunk = NULL;
+    rec->chunk_size = 0;
+    rec->chunk_capacity = 0;
+}
+
+/**
+ * Returns room for size more bytes at the end of the chunk, or NULL if the
+ * recording stopped. A full chunk goes to the writer first.
+ */
+static char* reserve(replay_recorder_t* rec, size_t size) {
+    if (rec->chunk_size > 0 && rec->chunk_size + size > rec->chunk_capacity) {
+        flush_chunk(rec);
+    }
+    if (rec->failed) {
+        return NULL;
+    }
+
+    if (rec->chunk_size + size > rec->chunk_capacity) {
+        // Empty here; a record larger than a chunk gets a chunk of its own
+        size_t capacity = size > REPLAY_CHUNK_SIZE ? size : REPLAY_CHUNK_SIZE;
+        rec->chunk = malloc(capacity);
+        if (!rec->chunk) {
+            rec->failed = true;
+            return NULL;
+        }
+        rec->chunk_capacity = capacity;
+    }
+
+    char* ptr = rec->chunk + rec->chunk_size;
+    rec->chunk_size += size;
+    rec->offset += (int64_t)size;
+    return ptr;
+}
+
+replay_recorder_t* replay_recorder_open(replay_writer_t* writer, const char* client_id) {
+    char path[512];
+    int seq = atomic_fetch_add(&writer->next_file, 1);
+    snprintf(path, sizeof(path), "%s/%s-%ld-%d.replay", writer->dir, client_id,
+             (long)time(NULL), seq);
+
+    replay_recorder_t* rec = calloc(1, sizeof(replay_recorder_t));
+    if (!rec) {
+        return NULL;
+    }
+
+    rec->file = malloc(sizeof(replay_output_t));
+    if (!rec->file) {
+        free(rec);
+        return NULL;
+    }
+    rec->file->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (rec->file->fd < 0) {
+        debug("[Replay] Failed to create %s: %s\n", path, strerror(errno));
+        free(rec->file);
+        free(rec);
+        return NULL;
+    }
+    atomic_init(&rec->file->failed, false);
+    rec->writer = writer;
+    rec->force_keyframe = true;
+    clock_gettime(CLOCK_MONOTONIC, &rec->start);
+
+    char* header = reserve(rec, REPLAY_HEADER_SIZE);
+    if (!header) {
+        close(rec->file->fd);
+        free(rec->file);
+        free(rec);
+        return NULL;
+    }
+    int interval = REPLAY_KEYFRAME_INTERVAL;
+    memcpy(header, REPLAY_MAGIC, REPLAY_MAGIC_SIZE);
+    memcpy(header + REPLAY_MAGIC_SIZE, &interval, sizeof(int));
+
+    atomic_fetch_add(&writer->files, 1);
+    debug("[Replay] Recording to %s\n", path);
+    return rec;
+}
+
+void replay_recorder_new_level(replay_recorder_t* rec) {
+    rec->force_keyframe = true;
+}
+
+void replay_record_frame(replay_recorder_t* rec, const board_t* board, int victory,
+                         int game_over, int points) {
+    if (rec->failed) {
+        return;
+    }
+
+    size_t cells = (size_t)board->width * (size_t)board->height;
+    bool indexed = rec->n_frames % REPLAY_KEYFRAME_INTERVAL == 0;
+    bool keyframe = indexed || rec->force_keyframe || board->dirty_overflow;
+
+    // Remember where the indexed keyframe starts before reserving it
+    if (indexed) {
+        if (rec->n_index == rec->index_capacity) {
+            size_t capacity = rec->index_capacity ? rec->index_capacity * 2 : 64;
+            int64_t* grown = realloc(rec->index, capacity * sizeof(int64_t));
+            if (!grown) {
+                rec->failed = true;
+                return;
+            }
+            rec->index = grown;
+            rec->index_capacity = capacity;
+        }
+        rec->index[rec->n_index++] = rec->offset;
+    }
+
+    // Record: (int)elapsed_ms | (char)OP_CODE | (int)frame_length | 6 fields | body
+    size_t body_size = keyframe ? BOARD_PACKED_SIZE(cells) :
+                       BOARD_DELTA_COUNT_SIZE + (size_t)board->n_dirty * BOARD_DELTA_ENTRY_SIZE;
+    size_t frame_size = BOARD_HEADER_SIZE + body_size;
+    char* record = reserve(rec, sizeof(int) + frame_size);
+    if (!record) {
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int elapsed_ms = (int)((now.tv_sec - rec->start.tv_sec) * 1000 +
+                           (now.tv_nsec - rec->start.tv_nsec) / 1000000);
+    int frame_length = (int)(frame_size - 1 - BOARD_LENGTH_SIZE);
+    int fields[6] = {board->width, board->height, board->tempo, victory, game_over, points};
+
+    memcpy(record, &elapsed_ms, sizeof(int));
+    char* frame = record + sizeof(int);
+    frame[0] = keyframe ? OP_CODE_BOARD | BOARD_PACKED_FLAG : OP_CODE_BOARD_DELTA;
+    memcpy(&frame[1], &frame_length, BOARD_LENGTH_SIZE);
+    memcpy(&frame[1 + BOARD_LENGTH_SIZE], fields, sizeof(fields));
+
+    char* body = frame + BOARD_HEADER_SIZE;
+    if (keyframe) {
+        board_pack_glyphs(board->render, cells, (unsigned char*)body);
+    } else {
+        memcpy(body, &board->n_dirty, sizeof(int));
+        body += BOARD_DELTA_COUNT_SIZE;
+        for (int i = 0; i < board->n_dirty; i++) {
+            int idx = board->dirty[i];
+            memcpy(body, &idx, sizeof(int));
+            body[sizeof(int)] = board->render[idx];
+            body += BOARD_DELTA_ENTRY_SIZE;
+        }
+    }
+
+    rec->force_keyframe = false;
+    rec->n_frames++;
+}
+
+void replay_recorder_close(replay_recorder_t* rec) {
+    if (!rec->failed) {
+        // Trailer: offsets | (int64_t)n_frames | (int64_t)n_blocks | magic
+        size_t index_size = rec->n_index * sizeof(int64_t);
+        char* trailer = reserve(rec, index_size + REPLAY_TRAILER_SIZE);
+        if (trailer) {
+            int64_t counts[2] = {rec->n_frames, (int64_t)rec->n_index};
+            memcpy(trailer, rec->index, index_size);
+            memcpy(trailer + index_size, counts, sizeof(counts));
+            memcpy(trailer + index_size + sizeof(counts), REPLAY_INDEX_MAGIC, REPLAY_MAGIC_SIZE);
+        }
+    }
+
+    // The last chunk closes the file, even after a failure
+    if (rec->failed) {
+        free(rec->chunk);
+        rec->chunk = NULL;
+        rec->chunk_size = 0;
+    }
+    submit_chunk(rec->writer, rec->file, rec->chunk, rec->chunk_size, true);
+
+    debug("[Replay] Closed replay (%ld frames, %zu indexed keyframes%s)\n",
+          rec->n_frames, rec->n_index, rec->failed ? ", truncated" : "");
+    free(rec->index);
+    free(rec);
+}
@@ -0,0 +1,370 @@
+#include "replay.h"
+#include "protocol.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// =============================================================================
+// Replay Viewer
+// =============================================================================
+//
+// Usage: ./Replay <replay_file> [frame]
+// Without a frame, prints what the file holds; with one, rebuilds the board
+// at that frame from the nearest indexed keyframe.
+
+/**
+ * A mapped replay file and its keyframe index.
+ */
+typedef struct {
+    const char* data;
+    size_t size;
+    int interval;                       // Frames between indexed keyframes
+
+    int64_t* offsets;                   // File offsets of the indexed keyframes
+    long n_frames;
+    long n_blocks;
+} replay_file_t;
+
+/**
+ * One record, as parsed from the file.
+ */
+typedef struct {
+    int elapsed_ms;
+    unsigned char op;
+    int fields[6];                      // width, height, tempo, victory, game_over, points
+    const char* body;
+    size_t body_size;
+} replay_record_t;
+
+/**
+ * Board rebuilt by applying records.
+ */
+typedef struct {
+    char* cells;
+    size_t capacity;
+    int width;
+    int height;
+    int points;
+    int victory;
+    int game_over;
+    int elapsed_ms;
+} replay_board_t;
+
+// =============================================================================
+// Records
+// =============================================================================
+
+/**
+ * Parses the record at offset. Returns the offset of the next record,
+ * or -1 if the record is cut short or malformed.
+ */
+static int64_t read_record(const replay_file_t* file, int64_t offset, replay_record_t* rec) {
+    size_t pos = (size_t)offset;
+    size_t prefix = sizeof(int) + 1 + BOARD_LENGTH_SIZE;
+    if (pos > file->size || file->size - pos < prefix) {
+        return -1;
+    }
+
+    int frame_length;
+    memcpy(&rec->elapsed_ms, file->data + pos, sizeof(int));
+    rec->op = (unsigned char)file->data[pos + sizeof(int)];
+    memcpy(&frame_length, file->data + pos + sizeof(int) + 1, BOARD_LENGTH_SIZE);
+    pos += prefix;
+
+    if (frame_length < (int)BOARD_FIELDS_SIZE || (size_t)frame_length > file->size - pos) {
+        return -1;
+    }
+    memcpy(rec->fields, file->data + pos, BOARD_FIELDS_SIZE);
+    rec->body = file->data + pos + BOARD_FIELDS_SIZE;
+    rec->body_size = (size_t)frame_length - BOARD_FIELDS_SIZE;
+
+    return (int64_t)(pos + (size_t)frame_length);
+}
+
+static void unpack_cells(const unsigned char* in, size_t n_cells, char* out) {
+    static const char glyphs[9] = BOARD_PACKED_GLYPHS "  ";  // Unused codes 6-7 show as empty
+
+    for (size_t g = 0; g * 8 < n_cells; g++) {
+        uint32_t bits = in[g * 3] | (uint32_t)in[g * 3 + 1] << 8 | (uint32_t)in[g * 3 + 2] << 16;
+        for (size_t i = 0; i < 8 && g * 8 + i < n_cells; i++) {
+            out[g * 8 + i] = glyphs[(bits >> (3 * i)) & 7];
+        }
+    }
+}
+
+/**
+ * Applies a record onto the board. Returns -1 if the record does not fit it.
+ */
+static int apply_record(replay_board_t* board, const replay_record_t* rec) {
+    int width = rec->fields[0];
+    int height = rec->fields[1];
+
+    if (rec->op == (OP_CODE_BOARD | BOARD_PACKED_FLAG)) {
+        if (width <= 0 || height <= 0 || (long)width * height > MAX_BOARD_CELLS) {
+            return -1;
+        }
+        size_t cells = (size_t)width * (size_t)height;
+        if (rec->body_size < BOARD_PACKED_SIZE(cells)) {
+            return -1;
+        }
+        if (cells > board->capacity) {
+            char* grown = realloc(board->cells, cells);
+            if (!grown) {
+                return -1;
+            }
+            board->cells = grown;
+            board->capacity = cells;
+        }
+        unpack_cells((const unsigned char*)rec->body, cells, board->cells);
+        board->width = width;
+        board->height = height;
+    } else if (rec->op == OP_CODE_BOARD_DELTA) {
+        int n_changes;
+        if (!board->cells || width != board->width || height != board->height ||
+            rec->body_size < BOARD_DELTA_COUNT_SIZE) {
+            return -1;
+        }
+        memcpy(&n_changes, rec->body, sizeof(int));
+        if (n_changes < 0 ||
+            (size_t)n_changes > (rec->body_size - BOARD_DELTA_COUNT_SIZE) / BOARD_DELTA_ENTRY_SIZE) {
+            return -1;
+        }
+        const char* entry = rec->body + BOARD_DELTA_COUNT_SIZE;
+        for (int i = 0; i < n_changes; i++, entry += BOARD_DELTA_ENTRY_SIZE) {
+            int idx;
+            memcpy(&idx, entry, sizeof(int));
+            if (idx < 0 || (size_t)idx >= (size_t)width * (size_t)height) {
+                return -1;
+            }
+            board->cells[idx] = entry[sizeof(int)];
+        }
+    } else {
+        return -1;
+    }
+
+    board->victory = rec->fields[3];
+    board->game_over = rec->fields[4];
+    board->points = rec->fields[5];
+    board->elapsed_ms = rec->elapsed_ms;
+    return 0;
+}
+
+// =============================================================================
+// Index
+// =============================================================================
+
+/**
+ * Uses the trailer's index. Returns -1 if the file has no valid trailer.
+ */
+static int read_index(replay_file_t* file) {
+    if (file->size < REPLAY_HEADER_SIZE + REPLAY_TRAILER_SIZE) {
+        return -1;
+    }
+    const char* trailer = file->data + file->size - REPLAY_TRAILER_SIZE;
+    if (memcmp(trailer + 2 * sizeof(int64_t), REPLAY_INDEX_MAGIC, REPLAY_MAGIC_SIZE) != 0) {
+        return -1;
+    }
+
+    int64_t counts[2];
+    memcpy(counts, trailer, sizeof(counts));
+    size_t room = (file->size - REPLAY_HEADER_SIZE - REPLAY_TRAILER_SIZE) / sizeof(int64_t);
+    if (counts[0] < 0 || counts[1] < 0 || (uint64_t)counts[1] > room ||
+        counts[1] != (counts[0] + file->interval - 1) / file->interval) {
+        return -1;
+    }
+
+    // The trailer starts at a multiple of 8 only by chance, so copy the offsets
+    size_t index_size = (size_t)counts[1] * sizeof(int64_t);
+    file->offsets = malloc(index_size ? index_size : 1);
+    if (!file->offsets) {
+        return -1;
+    }
+    memcpy(file->offsets, trailer - index_size, index_size);
+    file->n_frames = (long)counts[0];
+    file->n_blocks = (long)counts[1];
+    return 0;
+}
+
+/**
+ * Rebuilds the index by walking every record (replay cut short, e.g. the
+ * server was killed). Stops at the first incomplete record.
+ */
+static int scan_index(replay_file_t* file) {
+    size_t capacity = 64;
+    file->offsets = malloc(capacity * sizeof(int64_t));
+    if (!file->offsets) {
+        return -1;
+    }
+
+    int64_t offset = REPLAY_HEADER_SIZE;
+    replay_record_t rec;
+    long n_frames = 0;
+    long n_blocks = 0;
+    int64_t next;
+    while ((next = read_record(file, offset, &rec)) >= 0) {
+        bool keyframe = rec.op == (OP_CODE_BOARD | BOARD_PACKED_FLAG);
+        if (!keyframe && rec.op != OP_CODE_BOARD_DELTA) {
+            break;  // Not a replay record - a partial trailer
+        }
+        if (n_frames % file->interval == 0) {
+            if (!keyframe) {
+                break;
+            }
+            if ((size_t)n_blocks == capacity) {
+                int64_t* grown = realloc(file->offsets, capacity * 2 * sizeof(int64_t));
+                if (!grown) {
+                    return -1;
+                }
+                file->offsets = grown;
+                capacity *= 2;
+            }
+            file->offsets[n_blocks++] = offset;
+        }
+        n_frames++;
+        offset = next;
+    }
+
+    file->n_frames = n_frames;
+    file->n_blocks = n_blocks;
+    return 0;
+}
+
+/**
+ * Rebuilds the board at frame n: the indexed keyframe of its block, then at
+ * most interval - 1 records.
+ */
+static int seek_frame(const replay_file_t* file, long n, replay_board_t* board) {
+    long block = n / file->interval;
+    int64_t offset = file->offsets[block];
+    replay_record_t rec;
+
+    for (long frame = block * file->interval; frame <= n; frame++) {
+        offset = read_record(file, offset, &rec);
+        if (offset < 0 || apply_record(board, &rec) < 0) {
+            fprintf(stderr, "Error: Frame %ld is corrupt\n", frame);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// =============================================================================
+// Main
+// =============================================================================
+
+static void print_summary(const replay_file_t* file) {
+    replay_record_t rec;
+    int64_t offset = REPLAY_HEADER_SIZE;
+    int64_t next;
+    long keyframes = 0;
+    int last_ms = 0;
+    int last_points = 0;
+
+    for (long frame = 0; frame < file->n_frames; frame++) {
+        if ((next = read_record(file, offset, &rec)) < 0) {
+            break;
+        }
+        if (rec.op & BOARD_PACKED_FLAG) {
+            keyframes++;
+        }
+        last_ms = rec.elapsed_ms;
+        last_points = rec.fields[5];
+        offset = next;
+    }
+
+    printf("Frames:     %ld (%ld keyframes, %ld indexed every %d frames)\n",
+           file->n_frames, keyframes, file->n_blocks, file->interval);
+    printf("Duration:   %d.%03d s\n", last_ms / 1000, last_ms % 1000);
+    printf("Points:     %d\n", last_points);
+    printf("File size:  %zu bytes\n", file->size);
+}
+
+static void print_board(const replay_board_t* board, long frame) {
+    for (int y = 0; y < board->height; y++) {
+        fwrite(board->cells + (size_t)y * (size_t)board->width, 1, (size_t)board->width, stdout);
+        putchar('\n');
+    }
+    printf("Frame %ld at %d ms: %dx%d, points %d%s%s\n", frame, board->elapsed_ms,
+           board->width, board->height, board->points,
+           board->victory ? ", victory" : "", board->game_over ? ", game over" : "");
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2 && argc != 3) {
+        fprintf(stderr, "Usage: ./Replay <replay_file> [frame]\n");
+        return 1;
+    }
+
+    int fd = open(argv[1], O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        fprintf(stderr, "Error: Cannot open %s: %s\n", argv[1], strerror(errno));
+        return 1;
+    }
+    if ((size_t)st.st_size < REPLAY_HEADER_SIZE) {
+        fprintf(stderr, "Error: %s is not a replay\n", argv[1]);
+        close(fd);
+        return 1;
+    }
+
+    replay_file_t file = {0};
+    file.size = (size_t)st.st_size;
+    file.data = mmap(NULL, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (file.data == MAP_FAILED) {
+        fprintf(stderr, "Error: Cannot map %s: %s\n", argv[1], strerror(errno));
+        return 1;
+    }
+
+    memcpy(&file.interval, file.data + REPLAY_MAGIC_SIZE, sizeof(int));
+    if (memcmp(file.data, REPLAY_MAGIC, REPLAY_MAGIC_SIZE) != 0 || file.interval <= 0) {
+        fprintf(stderr, "Error: %s is not a replay\n", argv[1]);
+        munmap((void*)file.data, file.size);
+        return 1;
+    }
+
+    if (read_index(&file) < 0) {
+        free(file.offsets);
+        file.offsets = NULL;
+        fprintf(stderr, "Warning: No index (replay cut short), scanning records\n");
+        if (scan_index(&file) < 0) {
+            fprintf(stderr, "Error: Out of memory\n");
+            free(file.offsets);
+            munmap((void*)file.data, file.size);
+            return 1;
+        }
+    }
+
+    int status = 0;
+    if (argc == 2) {
+        print_summary(&file);
+    } else {
+        long frame = atol(argv[2]);
+        replay_board_t board = {0};
+        struct timespec start, end;
+
+        if (frame < 0 || frame >= file.n_frames) {
+            fprintf(stderr, "Error: Frame must be between 0 and %ld\n", file.n_frames - 1);
+            status = 1;
+        } else {
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            status = seek_frame(&file, frame, &board) < 0 ? 1 : 0;
+            clock_gettime(CLOCK_MONOTONIC, &end);
+        }
+        if (status == 0) {
+            print_board(&board, frame);
+            printf("Seek took %.3f ms\n", (double)(end.tv_sec - start.tv_sec) * 1000.0 +
+                                          (double)(end.tv_nsec - start.tv_nsec) / 1e6);
+        }
+        free(board.cells);
+    }
+
+    free(file.offsets);
+    munmap((void*)file.data, file.size);
+    return status;
+}
@@ -0,0 +1,251 @@
+#include "scheduler.h"
+#include "display.h"
+#include "leaderboard.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+// =============================================================================
+// Deadline Min-Heap (caller holds sched->mutex)
+// =============================================================================
+
+static bool deadline_before(const struct timespec* a, const struct timespec* b) {
+    return a->tv_sec < b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+static void heap_place(scheduler_t* sched, int i, sched_task_t* task) {
+    sched->heap[i] = task;
+    task->heap_index = i;
+}
+
+static void heap_sift_up(scheduler_t* sched, int i, sched_task_t* task) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!deadline_before(&task->deadline, &sched->heap[parent]->deadline)) {
+            break;
+        }
+        heap_place(sched, i, sched->heap[parent]);
+        i = parent;
+    }
+    heap_place(sched, i, task);
+}
+
+static void heap_push(scheduler_t* sched, sched_task_t* task) {
+    heap_sift_up(sched, sched->n_tasks++, task);
+}
+
+static sched_task_t* heap_pop(scheduler_t* sched) {
+    sched_task_t* top = sched->heap[0];
+    sched_task_t* last = sched->heap[--sched->n_tasks];
+    top->heap_index = -1;
+
+    int i = 0;
+    while (true) {
+        int child = 2 * i + 1;
+        if (child >= sched->n_tasks) {
+            break;
+        }
+        if (child + 1 < sched->n_tasks &&
+            deadline_before(&sched->heap[child + 1]->deadline, &sched->heap[child]->deadline)) {
+            child++;
+        }
+        if (!deadline_before(&sched->heap[child]->deadline, &last->deadline)) {
+            break;
+        }
+        heap_place(sched, i, sched->heap[child]);
+        i = child;
+    }
+    if (sched->n_tasks > 0) {
+        heap_place(sched, i, last);
+    }
+    return top;
+}
+
+// =============================================================================
+// Worker Thread
+// =============================================================================
+
+static void* scheduler_worker_func(void* arg) {
+    scheduler_t* sched = (scheduler_t*)arg;
+
+    // Block SIGUSR1 - only host thread should receive it
+    block_sigusr1();
+
+    pthread_mutex_lock(&sched->mutex);
+    while (sched->running) {
+        if (sched->n_tasks == 0) {
+            pthread_cond_wait(&sched->cond, &sched->mutex);
+            continue;
+        }
+
+        // Sleep until the earliest deadline (or until an earlier task is queued)
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (deadline_before(&now, &sched->heap[0]->deadline)) {
+            pthread_cond_timedwait(&sched->cond, &sched->mutex, &sched->heap[0]->deadline);
+            continue;
+        }
+
+        sched_task_t* task = heap_pop(sched);
+
+        // More work due right now - hand it to another worker
+        if (sched->n_tasks > 0 && !deadline_before(&now, &sched->heap[0]->deadline)) {
+            pthread_cond_signal(&sched->cond);
+        }
+        pthread_mutex_unlock(&sched->mutex);
+
+        struct timespec next;
+        sched_result_t result = task->run(task, &next);
+
+        pthread_mutex_lock(&sched->mutex);
+        if (result == SCHED_TASK_CONTINUE) {
+            task->deadline = next;
+            heap_push(sched, task);
+
+            // Sleeping workers may be waiting for a later deadline
+            if (sched->heap[0] == task) {
+                pthread_cond_signal(&sched->cond);
+            }
+        }
+    }
+    pthread_mutex_unlock(&sched->mutex);
+
+    return NULL;
+}
+
+// =============================================================================
+// Scheduler Management
+// =============================================================================
+
+int scheduler_init(scheduler_t* sched, int n_workers, int capacity) {
+    memset(sched, 0, sizeof(scheduler_t));
+
+    if (n_workers <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        n_workers = cores > 0 ? (int)cores : 1;
+    }
+    if (n_workers > SCHED_MAX_WORKERS) {
+        n_workers = SCHED_MAX_WORKERS;
+    }
+    sched->n_workers = n_workers;
+
+    sched->heap = malloc(sizeof(sched_task_t*) * (size_t)capacity);
+    if (!sched->heap) {
+        debug("[Scheduler] Failed to allocate task heap (%d tasks)\n", capacity);
+        return -1;
+    }
+    sched->capacity = capacity;
+
+    if (pthread_mutex_init(&sched->mutex, NULL) != 0) {
+        free(sched->heap);
+        return -1;
+    }
+
+    // Deadlines are CLOCK_MONOTONIC
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    int cond_result = pthread_cond_init(&sched->cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+    if (cond_result != 0) {
+        pthread_mutex_destroy(&sched->mutex);
+        free(sched->heap);
+        return -1;
+    }
+
+    return 0;
+}
+
+int scheduler_start(scheduler_t* sched) {
+    sched->running = true;
+
+    for (int i = 0; i < sched->n_workers; i++) {
+        if (pthread_create(&sched->workers[i], NULL, scheduler_worker_func, sched) != 0) {
+            debug("[Scheduler] Failed to create worker %d: %s\n", i, strerror(errno));
+            sched->n_workers = i;
+            scheduler_shutdown(sched);
+            return -1;
+        }
+    }
+
+    debug("[Scheduler] Started %d workers (capacity %d tasks)\n", sched->n_workers, sched->capacity);
+    return 0;
+}
+
+int scheduler_submit(scheduler_t* sched, sched_task_t* task, const struct timespec* deadline) {
+    if (deadline) {
+        task->deadline = *deadline;
+    } else {
+        clock_gettime(CLOCK_MONOTONIC, &task->deadline);
+    }
+
+    pthread_mutex_lock(&sched->mutex);
+    if (!sched->running || sched->n_tasks >= sched->capacity) {
+        pthread_mutex_unlock(&sched->mutex);
+        return -1;
+    }
+    heap_push(sched, task);
+    if (sched->heap[0] == task) {
+        pthread_cond_signal(&sched->cond);
+    }
+    pthread_mutex_unlock(&sched->mutex);
+
+    return 0;
+}
+
+void scheduler_wake(scheduler_t* sched, sched_task_t* task) {
+    pthread_mutex_lock(&sched->mutex);
+    int i = task->heap_index;
+    if (i >= 0 && i < sched->n_tasks && sched->heap[i] == task) {
+        // Only ever moved earlier: an overdue task keeps its place, and a
+        // smaller key never needs more than a sift up
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (!deadline_before(&now, &task->deadline)) {
+            pthread_mutex_unlock(&sched->mutex);
+            return;
+        }
+        task->deadline = now;
+        heap_sift_up(sched, i, task);
+        if (sched->heap[0] == task) {
+            pthread_cond_signal(&sched->cond);
+        }
+    }
+    pthread_mutex_unlock(&sched->mutex);
+}
+
+void scheduler_shutdown(scheduler_t* sched) {
+    pthread_mutex_lock(&sched->mutex);
+    sched->running = false;
+    pthread_cond_broadcast(&sched->cond);
+    pthread_mutex_unlock(&sched->mutex);
+
+    // Workers finish the task they are running, then exit
+    for (int i = 0; i < sched->n_workers; i++) {
+        pthread_join(sched->workers[i], NULL);
+    }
+    sched->n_workers = 0;
+
+    // Nobody runs the remaining tasks anymore. The reactor may still be
+    // waking tasks, so the heap is only touched under the lock
+    pthread_mutex_lock(&sched->mutex);
+    while (sched->n_tasks > 0) {
+        sched_task_t* task = heap_pop(sched);
+        pthread_mutex_unlock(&sched->mutex);
+        if (task->cancel) {
+            task->cancel(task);
+        }
+        pthread_mutex_lock(&sched->mutex);
+    }
+    pthread_mutex_unlock(&sched->mutex);
+
+    debug("[Scheduler] All workers stopped\n");
+}
+
+void scheduler_destroy(scheduler_t* sched) {
+    pthread_cond_destroy(&sched->cond);
+    pthread_mutex_destroy(&sched->mutex);
+    free(sched->heap);
+    sched->heap = NULL;
+}
@@ -4,10 +4,12 @@
 
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/uio.h>
 #include <string.h>
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <ctype.h>
 
 // Debug macro (uses the debug function from display.c if available)
 extern void debug(const char* format, ...);
@@ -24,6 +26,26 @@ void init_session(client_session_t* session) {
     session->notif_pipe_path[0] = '\0';
     session->active = false;
     session->accumulated_points = 0;
+    session->frame_body = NULL;
+    session->frame_capacity = 0;
+    session->last_frame_width = 0;
+    session->last_frame_height = 0;
+    session->frames_since_keyframe = 0;
+    session->output = NULL;
+    session->output_offset = 0;
+    session->output_size = 0;
+    session->output_capacity = 0;
+    session->replay = NULL;
+    pthread_mutex_init(&session->input_mutex, NULL);
+    session->input_head = 0;
+    session->input_count = 0;
+    session->input_status = SESSION_INPUT_OPEN;
+    session->view_rows = 0;
+    session->view_cols = 0;
+    session->view_changed = false;
+    session->frame_format = BOARD_FORMAT_GLYPHS;
+    session->input_partial_len = 0;
+    session->reactor_slot = -1;
 }
 
 void cleanup_session(client_session_t* session) {
@@ -39,11 +61,68 @@ void cleanup_session(client_session_t* session) {
         session->notif_pipe_fd = -1;
     }
     
+    free(session->frame_body);
+    session->frame_body = NULL;
+    session->frame_capacity = 0;
+    session->last_frame_width = 0;
+    session->last_frame_height = 0;
+    
+    free(session->output);
+    session->output = NULL;
+    session->output_offset = 0;
+    session->output_size = 0;
+    session->output_capacity = 0;
+    
+    if (session->replay) {
+        replay_recorder_close(session->replay);
+        session->replay = NULL;
+    }
+    
+    pthread_mutex_destroy(&session->input_mutex);
+    
     session->active = false;
     session->req_pipe_path[0] = '\0';
     session->notif_pipe_path[0] = '\0';
 }
 
+void session_detach(client_session_t* session) {
+    debug("[Session] Detaching session from its client\n");
+    
+    if (session->req_pipe_fd >= 0) {
+        close(session->req_pipe_fd);
+        session->req_pipe_fd = -1;
+    }
+    
+    if (session->notif_pipe_fd >= 0) {
+        close(session->notif_pipe_fd);
+        session->notif_pipe_fd = -1;
+    }
+    
+    // The next client has no base to apply deltas to, nor any use for
+    // the rest of a frame this one did not read
+    session->last_frame_width = 0;
+    session->last_frame_height = 0;
+    session->frames_since_keyframe = 0;
+    free(session->output);
+    session->output = NULL;
+    session->output_offset = 0;
+    session->output_size = 0;
+    session->output_capacity = 0;
+    
+    pthread_mutex_lock(&session->input_mutex);
+    session->input_head = 0;
+    session->input_count = 0;
+    session->input_status = SESSION_INPUT_OPEN;
+    session->view_rows = 0;
+    session->view_cols = 0;
+    session->view_changed = false;
+    session->frame_format = BOARD_FORMAT_GLYPHS;
+    pthread_mutex_unlock(&session->input_mutex);
+    session->input_partial_len = 0;
+    
+    session->active = false;
+}
+
 // =============================================================================
 // Connection Handling
 // =============================================================================
@@ -90,9 +169,15 @@ int read_connect_request(int server_fd, client_session_t* session) {
 }
 
 int accept_connection(client_session_t* session) {
-    // 1. Open notification pipe for writing (client is waiting to read)
-    session->notif_pipe_fd = open(session->notif_pipe_path, O_WRONLY);
+    // 1. Open notification pipe for writing (client is about to read).
+    //    Non-blocking: frames are written by the scheduler's workers, which
+    //    must never wait on a client. Such an open fails with ENXIO until
+    //    the client has the FIFO open for reading; the caller tries again
+    session->notif_pipe_fd = open(session->notif_pipe_path, O_WRONLY | O_NONBLOCK);
     if (session->notif_pipe_fd < 0) {
+        if (errno == ENXIO || errno == EINTR) {
+            return 1;
+        }
         debug("[Session] Failed to open notification FIFO: %s\n", strerror(errno));
         return -1;
     }
@@ -106,8 +191,13 @@ int accept_connection(client_session_t* session) {
         return -1;
     }
     
-    // 3. Open request pipe for reading (now client has opened it for writing)
-    session->req_pipe_fd = open(session->req_pipe_path, O_RDONLY);
+    // 3. Open request pipe for reading (the client opens it for writing
+    //    once it has the response). Non-blocking, so the open does not wait
+    //    for the client, and the input reactor never blocks on a read.
+    //    The reactor only reads on epoll events, and a FIFO reports neither
+    //    input nor a hangup before a writer has come, so the client may
+    //    open its end later without being taken for gone
+    session->req_pipe_fd = open(session->req_pipe_path, O_RDONLY | O_NONBLOCK);
     if (session->req_pipe_fd < 0) {
         debug("[Session] Failed to open request FIFO: %s\n", strerror(errno));
         close(session->notif_pipe_fd);
@@ -142,6 +232,157 @@ int send_connect_response(client_session_t* session, char result) {
 // Board Updates
 // =============================================================================
 
+int session_prepare_frames(client_session_t* session, board_t* board) {
+    // New board - the client's copy is no base for deltas anymore
+    session->last_frame_width = 0;
+    session->last_frame_height = 0;
+    if (session->replay) {
+        replay_recorder_new_level(session->replay);
+    }
+    
+    size_t cells = (size_t)board->width * (size_t)board->height;
+    if (cells <= session->frame_capacity) {
+        return 0;
+    }
+    
+    // A delta is only sent while it is smaller than the board itself,
+    // so the body buffer is bounded by the number of cells (packed cells
+    // are smaller, except for the padding of boards under 8 cells)
+    size_t size = cells > BOARD_PACKED_SIZE(cells) ? cells : BOARD_PACKED_SIZE(cells);
+    free(session->frame_body);
+    session->frame_body = malloc(size);
+    if (!session->frame_body) {
+        debug("[Session] Failed to allocate frame buffer (%zu cells)\n", cells);
+        session->frame_capacity = 0;
+        return -1;
+    }
+    
+    session->frame_capacity = cells;
+    debug("[Session] Frame buffer sized for %zu cells\n", cells);
+    return 0;
+}
+
+/**
+ * Writes as much of the frame as the FIFO takes without blocking. Frames
+ * larger than the pipe buffer go out in several chunks (the client reads
+ * them back the same way), so partial writes are resumed where they
+ * stopped until the FIFO is full. iov is trimmed to what was not written.
+ * Returns the bytes written, or -1 if the pipe failed.
+ */
+static ssize_t write_frame(int fd, struct iovec* iov, int iovcnt) {
+    ssize_t total = 0;
+    int first = 0;
+    
+    while (first < iovcnt) {
+        ssize_t written = writev(fd, &iov[first], iovcnt - first);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return -1;
+        }
+        total += written;
+        
+        // Empty the buffers that went out entirely, trim the one cut short
+        while (first < iovcnt && (size_t)written >= iov[first].iov_len) {
+            written -= (ssize_t)iov[first].iov_len;
+            iov[first].iov_len = 0;
+            first++;
+        }
+        if (first < iovcnt) {
+            iov[first].iov_base = (char*)iov[first].iov_base + written;
+            iov[first].iov_len -= (size_t)written;
+        }
+    }
+    
+    return total;
+}
+
+/**
+ * Queues what write_frame left of a frame, behind anything queued before.
+ * Returns -1 if that would put the client more than limit bytes behind
+ * (or the queue cannot grow).
+ */
+static int queue_output(client_session_t* session, const struct iovec* iov, int iovcnt,
+                        size_t limit) {
+    size_t pending = session->output_size - session->output_offset;
+    size_t size = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        size += iov[i].iov_len;
+    }
+    if (pending + size > limit) {
+        debug("[Session] Client is %zu bytes behind, giving up on it\n", pending + size);
+        return -1;
+    }
+    
+    // Keep the pending bytes at the start of the buffer
+    if (session->output_offset > 0) {
+        memmove(session->output, session->output + session->output_offset, pending);
+        session->output_offset = 0;
+        session->output_size = pending;
+    }
+    if (pending + size > session->output_capacity) {
+        char* output = realloc(session->output, pending + size);
+        if (!output) {
+            debug("[Session] Failed to queue %zu frame bytes\n", size);
+            return -1;
+        }
+        session->output = output;
+        session->output_capacity = pending + size;
+    }
+    
+    for (int i = 0; i < iovcnt; i++) {
+        memcpy(session->output + session->output_size, iov[i].iov_base, iov[i].iov_len);
+        session->output_size += iov[i].iov_len;
+    }
+    return 0;
+}
+
+int session_flush_output(client_session_t* session) {
+    if (session->notif_pipe_fd < 0) {
+        return -1;
+    }
+    
+    while (session->output_offset < session->output_size) {
+        ssize_t written = write(session->notif_pipe_fd, session->output + session->output_offset,
+                                session->output_size - session->output_offset);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 1;
+            debug("[Session] Failed to send queued frames: %s\n", strerror(errno));
+            return -1;
+        }
+        session->output_offset += (size_t)written;
+    }
+    
+    session->output_offset = 0;
+    session->output_size = 0;
+    return 0;
+}
+
+/**
+ * Picks the window to send for a rows x cols viewport: the viewport clamped
+ * to the board, centred on pacman but kept inside the board.
+ * Returns false if the whole board fits (no window needed).
+ */
+static bool board_window(board_t* board, int rows, int cols,
+                         int* origin_x, int* origin_y, int* view_w, int* view_h) {
+    if (rows <= 0 || cols <= 0 || (cols >= board->width && rows >= board->height)) {
+        return false;
+    }
+    
+    *view_w = cols < board->width ? cols : board->width;
+    *view_h = rows < board->height ? rows : board->height;
+    
+    pacman_t* pac = &board->pacmans[0];
+    int x = pac->pos_x - *view_w / 2;
+    int y = pac->pos_y - *view_h / 2;
+    if (x > board->width - *view_w) x = board->width - *view_w;
+    if (y > board->height - *view_h) y = board->height - *view_h;
+    *origin_x = x > 0 ? x : 0;
+    *origin_y = y > 0 ? y : 0;
+    return true;
+}
+
 int send_board_update(client_session_t* session, board_t* board, int victory, int game_over) {
     if (!session->active || session->notif_pipe_fd < 0) {
         return -1;
@@ -151,76 +392,138 @@ int send_board_update(client_session_t* session, board_t* board, int victory, in
     int height = board->height;
     int board_size = width * height;
     
-    // Build message:
-    // (char)OP_CODE | (int)width | (int)height | (int)tempo | 
-    // (int)victory | (int)game_over | (int)points | (char[w*h])data
-    
-    size_t msg_size = 1 + 6 * sizeof(int) + (size_t)board_size;
-    char* message = malloc(msg_size);
-    if (!message) {
-        debug("[Session] Failed to allocate board message\n");
+    if ((size_t)board_size > session->frame_capacity) {
+        debug("[Session] Frame buffer not prepared for %dx%d board\n", width, height);
         return -1;
     }
     
-    size_t offset = 0;
+    // Record the full board, whatever this client is sent
+    if (session->replay) {
+        replay_record_frame(session->replay, board, victory, game_over, session->accumulated_points);
+    }
     
-    // OP_CODE
-    message[offset++] = OP_CODE_BOARD;
+    // What the client asked for so far
+    pthread_mutex_lock(&session->input_mutex);
+    int view_rows = session->view_rows;
+    int view_cols = session->view_cols;
+    bool packed = session->frame_format == BOARD_FORMAT_PACKED;
+    session->view_changed = false;
+    pthread_mutex_unlock(&session->input_mutex);
+    
+    int origin_x = 0, origin_y = 0;
+    int frame_width = width, frame_height = height;
+    bool window = board_window(board, view_rows, view_cols,
+                               &origin_x, &origin_y, &frame_width, &frame_height);
+    
+    // Decide between a full keyframe and a delta of the board's dirty cells.
+    // If the delta would not fit in less than a full board, send a keyframe.
+    bool keyframe = !window &&
+                    (session->last_frame_width != width ||
+                     session->last_frame_height != height ||
+                     session->frames_since_keyframe >= BOARD_KEYFRAME_INTERVAL ||
+                     board->dirty_overflow ||
+                     (size_t)board->n_dirty * BOARD_DELTA_ENTRY_SIZE + BOARD_DELTA_COUNT_SIZE >= (size_t)board_size);
     
-    // Header integers
-    int header[6] = {
-        width,
-        height,
+    // Build message:
+    // (char)OP_CODE | (int)frame_length | (int)width | (int)height |
+    // (int)tempo | (int)victory | (int)game_over | (int)points | body
+    // Keyframe body: (char[w*h])data
+    // Delta body:    (int)n_changes | n_changes * ((int)index | (char)glyph)
+    // Window body:   (int)origin_x | (int)origin_y | (char[w*h])data
+    // Keyframe and window data is packed cells if the client asked for them
+    char header[BOARD_HEADER_SIZE + BOARD_WINDOW_ORIGIN_SIZE];
+    size_t header_size = BOARD_HEADER_SIZE;
+    
+    packed = packed && (window || keyframe);
+    header[0] = window ? OP_CODE_BOARD_WINDOW : keyframe ? OP_CODE_BOARD : OP_CODE_BOARD_DELTA;
+    if (packed) {
+        header[0] |= BOARD_PACKED_FLAG;
+    }
+    int fields[6] = {
+        frame_width,
+        frame_height,
         board->tempo,
         victory,
         game_over,
         session->accumulated_points
     };
-    memcpy(&message[offset], header, sizeof(header));
-    offset += sizeof(header);
-    
-    // Board data - serialize from board positions
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            int idx = y * width + x;
-            char content = board->board[idx].content;
-            
-            // Map content to display characters
-            // 'W' -> '#' (wall)
-            // 'P' -> 'C' (pacman)
-            // 'M' -> 'M' (monster)
-            // ' ' with dot -> 'o' (dot)
-            // '@' or portal -> '@'
-            if (content == 'W') {
-                message[offset++] = '#';
-            } else if (content == 'P') {
-                message[offset++] = 'C';
-            } else if (content == 'M') {
-                message[offset++] = 'M';
-            } else if (board->board[idx].has_portal) {
-                message[offset++] = '@';
-            } else if (board->board[idx].has_dot) {
-                message[offset++] = 'o';
-            } else {
-                message[offset++] = ' ';
-            }
+    memcpy(&header[1 + BOARD_LENGTH_SIZE], fields, sizeof(fields));
+    
+    struct iovec iov[2];
+    if (window) {
+        // Gather the window's rows (a narrower window is not contiguous)
+        char* body = session->frame_body;
+        for (int y = 0; y < frame_height; y++) {
+            memcpy(&body[(size_t)y * frame_width],
+                   &board->render[(size_t)(origin_y + y) * width + origin_x], (size_t)frame_width);
         }
+        
+        int origin[2] = {origin_x, origin_y};
+        memcpy(&header[header_size], origin, sizeof(origin));
+        header_size += BOARD_WINDOW_ORIGIN_SIZE;
+        iov[1].iov_base = body;
+        iov[1].iov_len = (size_t)frame_width * frame_height;
+        if (packed) {
+            iov[1].iov_len = board_pack_glyphs(body, iov[1].iov_len, (unsigned char*)body);
+        }
+    } else if (keyframe && packed) {
+        iov[1].iov_base = session->frame_body;
+        iov[1].iov_len = board_pack_glyphs(board->render, (size_t)board_size,
+                                           (unsigned char*)session->frame_body);
+    } else if (keyframe) {
+        // The render plane already is the frame
+        iov[1].iov_base = board->render;
+        iov[1].iov_len = (size_t)board_size;
+    } else {
+        char* body = session->frame_body;
+        size_t body_size = 0;
+        for (int i = 0; i < board->n_dirty; i++) {
+            int idx = board->dirty[i];
+            memcpy(&body[body_size], &idx, sizeof(int));
+            body[body_size + sizeof(int)] = board->render[idx];
+            body_size += BOARD_DELTA_ENTRY_SIZE;
+        }
+        
+        memcpy(&header[header_size], &board->n_dirty, sizeof(int));
+        header_size += BOARD_DELTA_COUNT_SIZE;
+        iov[1].iov_base = body;
+        iov[1].iov_len = body_size;
     }
-    
-    // Send message
-    ssize_t written = write(session->notif_pipe_fd, message, msg_size);
-    free(message);
-    
-    if (written != (ssize_t)msg_size) {
+    iov[0].iov_base = header;
+    iov[0].iov_len = header_size;
+    
+    size_t msg_size = header_size + iov[1].iov_len;
+    int frame_length = (int)(msg_size - 1 - BOARD_LENGTH_SIZE);
+    memcpy(&header[1], &frame_length, BOARD_LENGTH_SIZE);
+    
+    // Send message, after whatever earlier frames left queued; the rest
+    // waits in the queue (a client can be two boards and the backlog behind)
+    int iovcnt = iov[1].iov_len > 0 ? 2 : 1;
+    int queued = session_flush_output(session);
+    ssize_t written = queued == 0 ? write_frame(session->notif_pipe_fd, iov, iovcnt) : 0;
+    
+    if (queued < 0 || written < 0 ||
+        ((size_t)written < msg_size &&
+         queue_output(session, iov, iovcnt,
+                      SESSION_OUTPUT_BACKLOG_MAX + 2 * (size_t)board_size) < 0)) {
         if (written < 0) {
             debug("[Session] Failed to send board update: %s\n", strerror(errno));
-        } else {
-            debug("[Session] Partial write sending board update\n");
         }
+        // Client state is unknown now - resync with a keyframe next time
+        session->last_frame_width = 0;
+        session->last_frame_height = 0;
         return -1;
     }
     
-    debug("[Session] Sent board update (%zu bytes)\n", msg_size);
+    // Frame delivered or queued in order - the client is in sync with the render plane
+    // (a window leaves no base for deltas: the next full-board frame is a keyframe)
+    board_clear_dirty(board);
+    session->last_frame_width = window ? 0 : width;
+    session->last_frame_height = window ? 0 : height;
+    session->frames_since_keyframe = keyframe ? 0 : session->frames_since_keyframe + 1;
+    
+    debug("[Session] Sent board %s%s (%zu bytes)\n",
+          window ? "window" : keyframe ? "keyframe" : "delta", packed ? ", packed" : "", msg_size);
     return 0;
 }
 
@@ -228,49 +531,171 @@ int send_board_update(client_session_t* session, board_t* board, int victory, in
 // Command Reading
 // =============================================================================
 
-int read_client_command(client_session_t* session, char* command) {
-    if (!session->active || session->req_pipe_fd < 0) {
-        return -1;
+/**
+ * Records how the client's input ended; the first reason wins.
+ */
+static void set_input_status(client_session_t* session, int status) {
+    pthread_mutex_lock(&session->input_mutex);
+    if (session->input_status == SESSION_INPUT_OPEN) {
+        session->input_status = status;
     }
-    
-    // Read command message: (char)OP_CODE | (char)command
-    char buffer[2];
-    
-    ssize_t bytes_read = read(session->req_pipe_fd, buffer, sizeof(buffer));
-    
-    if (bytes_read == 0) {
-        // Client closed the pipe - disconnected
-        debug("[Session] Client disconnected (pipe closed)\n");
-        return -1;
+    pthread_mutex_unlock(&session->input_mutex);
+}
+
+/**
+ * Applies the messages of one read: queues movement commands and records
+ * viewport changes. A message cut off at the end of the buffer is left
+ * unconsumed. Returns the input status.
+ */
+static int queue_commands(client_session_t* session, const char* buffer, size_t size,
+                          size_t* consumed) {
+    int status = SESSION_INPUT_OPEN;
+    int dropped = 0;
+    size_t i = 0;
+    
+    pthread_mutex_lock(&session->input_mutex);
+    while (i < size && status == SESSION_INPUT_OPEN) {
+        if (buffer[i] == OP_CODE_DISCONNECT) {
+            // Disconnect request
+            debug("[Session] Client requested disconnect\n");
+            status = SESSION_INPUT_QUIT;
+            break;
+        }
+        
+        if (buffer[i] == OP_CODE_VIEWPORT) {
+            if (i + VIEWPORT_MSG_SIZE > size) {
+                break;  // Rest arrives with the next read
+            }
+            int view[2];
+            memcpy(view, &buffer[i + 1], sizeof(view));
+            session->view_rows = view[0] > 0 ? view[0] : 0;
+            session->view_cols = view[1] > 0 ? view[1] : 0;
+            session->view_changed = true;
+            debug("[Session] Client viewport is %dx%d\n", session->view_cols, session->view_rows);
+            i += VIEWPORT_MSG_SIZE;
+            continue;
+        }
+        
+        if (buffer[i] == OP_CODE_FRAME_FORMAT) {
+            if (i + FRAME_FORMAT_MSG_SIZE > size) {
+                break;  // Rest arrives with the next read
+            }
+            session->frame_format = buffer[i + 1] == BOARD_FORMAT_PACKED ?
+                                    BOARD_FORMAT_PACKED : BOARD_FORMAT_GLYPHS;
+            debug("[Session] Client frame format is %d\n", session->frame_format);
+            i += FRAME_FORMAT_MSG_SIZE;
+            continue;
+        }
+        
+        if (buffer[i] != OP_CODE_PLAY) {
+            debug("[Session] Unexpected OP_CODE: %d\n", buffer[i]);
+            status = SESSION_INPUT_CLOSED;
+            break;
+        }
+        if (i + PLAY_MSG_SIZE > size) {
+            break;  // Rest arrives with the next read
+        }
+        
+        char command = (char)toupper((unsigned char)buffer[i + 1]);
+        if (command == 'Q') {
+            status = SESSION_INPUT_QUIT;
+        } else if (command == 'W' || command == 'A' || command == 'S' || command == 'D' ||
+                   command == 'G') {
+            if (session->input_count < SESSION_INPUT_QUEUE_SIZE) {
+                int slot = (session->input_head + session->input_count) % SESSION_INPUT_QUEUE_SIZE;
+                session->input_queue[slot] = command;
+                session->input_count++;
+            } else {
+                dropped++;
+            }
+        }
+        i += PLAY_MSG_SIZE;
     }
-    
-    if (bytes_read < 0) {
-        debug("[Session] Error reading command: %s\n", strerror(errno));
-        return -1;
+    if (session->input_status == SESSION_INPUT_OPEN) {
+        session->input_status = status;
     }
+    status = session->input_status;
+    pthread_mutex_unlock(&session->input_mutex);
     
-    if (bytes_read == 1 && buffer[0] == OP_CODE_DISCONNECT) {
-        // Disconnect request
-        debug("[Session] Client requested disconnect\n");
-        return -2;
+    if (dropped > 0) {
+        debug("[Session] Input queue full, dropped %d command(s)\n", dropped);
     }
-    
-    if (bytes_read != 2) {
-        debug("[Session] Invalid command message size: %zd\n", bytes_read);
-        return -1;
+    *consumed = i;
+    return status;
+}
+
+int session_read_input(client_session_t* session) {
+    if (!session->active || session->req_pipe_fd < 0) {
+        set_input_status(session, SESSION_INPUT_CLOSED);
+        return SESSION_INPUT_CLOSED;
     }
     
-    if (buffer[0] != OP_CODE_PLAY) {
-        if (buffer[0] == OP_CODE_DISCONNECT) {
-            debug("[Session] Client requested disconnect\n");
-            return -2;
+    // Messages: (char)OP_CODE | (char)command or format, or a viewport message.
+    // Each one is a single write smaller than PIPE_BUF, so the FIFO holds whole
+    // messages, but a read may still end in the middle of one; that part is
+    // kept in the session and completed by the next read.
+    char buffer[VIEWPORT_MSG_SIZE + CLIENT_COMMAND_BATCH * PLAY_MSG_SIZE];
+    
+    while (true) {
+        size_t pending = session->input_partial_len;
+        memcpy(buffer, session->input_partial, pending);
+        
+        ssize_t bytes_read = read(session->req_pipe_fd, buffer + pending, sizeof(buffer) - pending);
+        
+        if (bytes_read == 0) {
+            // Client closed the pipe - disconnected
+            debug("[Session] Client disconnected (pipe closed)\n");
+            set_input_status(session, SESSION_INPUT_CLOSED);
+            break;
+        }
+        
+        if (bytes_read < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;  // Drained
+            }
+            debug("[Session] Error reading command: %s\n", strerror(errno));
+            set_input_status(session, SESSION_INPUT_CLOSED);
+            break;
+        }
+        
+        size_t size = pending + (size_t)bytes_read;
+        size_t consumed;
+        int status = queue_commands(session, buffer, size, &consumed);
+        
+        // Whatever is left of an open stream is shorter than the longest message
+        session->input_partial_len = status == SESSION_INPUT_OPEN ? size - consumed : 0;
+        memcpy(session->input_partial, buffer + consumed, session->input_partial_len);
+        
+        if (status != SESSION_INPUT_OPEN || size < sizeof(buffer)) {
+            break;
         }
-        debug("[Session] Unexpected OP_CODE: %d\n", buffer[0]);
-        return -1;
     }
     
-    *command = buffer[1];
-    debug("[Session] Received command: %c\n", *command);
-    
-    return 0;
+    pthread_mutex_lock(&session->input_mutex);
+    int status = session->input_status;
+    pthread_mutex_unlock(&session->input_mutex);
+    return status;
+}
+
+bool session_viewport_changed(client_session_t* session) {
+    pthread_mutex_lock(&session->input_mutex);
+    bool changed = session->view_changed;
+    pthread_mutex_unlock(&session->input_mutex);
+    return changed;
+}
+
+int session_pop_command(client_session_t* session, char* command) {
+    pthread_mutex_lock(&session->input_mutex);
+    int result = session->input_status;
+    if (result == SESSION_INPUT_OPEN && session->input_count > 0) {
+        *command = session->input_queue[session->input_head];
+        session->input_head = (session->input_head + 1) % SESSION_INPUT_QUEUE_SIZE;
+        session->input_count--;
+        result = 1;
+    }
+    pthread_mutex_unlock(&session->input_mutex);
+    return result;
 }
@@ -0,0 +1,207 @@
+#include "snapshot.h"
+#include "display.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+
+// Header: magic | width | height | tempo | n_pacmans | n_ghosts | level_name
+#define SNAPSHOT_HEADER_SIZE (SNAPSHOT_MAGIC_SIZE + 5 * sizeof(int) + 256)
+
+// =============================================================================
+// Child Process (only async-signal-safe calls: the other threads were not
+// copied, and a lock they held stays held forever)
+// =============================================================================
+
+static int write_all(int fd, const void* data, size_t size) {
+    const char* ptr = data;
+    while (size > 0) {
+        ssize_t written = write(fd, ptr, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        ptr += written;
+        size -= (size_t)written;
+    }
+    return 0;
+}
+
+/**
+ * Writes the board to tmp_path, then renames it over path.
+ * Runs in the child; returns its exit status.
+ */
+static int write_snapshot(const board_t* board, const char* path, const char* tmp_path) {
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return 1;
+    }
+
+    char header[SNAPSHOT_HEADER_SIZE];
+    int fields[5] = {board->width, board->height, board->tempo, board->n_pacmans, board->n_ghosts};
+    memcpy(header, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE);
+    memcpy(header + SNAPSHOT_MAGIC_SIZE, fields, sizeof(fields));
+    memcpy(header + SNAPSHOT_MAGIC_SIZE + sizeof(fields), board->level_name, 256);
+
+    size_t cells = (size_t)board->width * (size_t)board->height;
+    int result = write_all(fd, header, sizeof(header));
+    if (result == 0) result = write_all(fd, board->content, cells);
+    if (result == 0) result = write_all(fd, board->dots, BOARD_BITPLANE_SIZE(cells));
+    if (result == 0) result = write_all(fd, board->portals, BOARD_BITPLANE_SIZE(cells));
+    if (result == 0) {
+        result = write_all(fd, board->pacmans, (size_t)board->n_pacmans * sizeof(pacman_t));
+    }
+    if (result == 0) {
+        result = write_all(fd, board->ghosts, (size_t)board->n_ghosts * sizeof(ghost_t));
+    }
+
+    if (close(fd) < 0 || result < 0 || rename(tmp_path, path) < 0) {
+        unlink(tmp_path);
+        return 1;
+    }
+    return 0;
+}
+
+// =============================================================================
+// Children (caller holds snapshots->mutex)
+// =============================================================================
+
+/**
+ * Frees the child's slot and counts how it ended.
+ */
+static void release_child(snapshot_manager_t* snapshots, int slot, int status) {
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        atomic_fetch_add(&snapshots->saved, 1);
+        debug("[Snapshot] Child %d saved the board\n", snapshots->children[slot]);
+    } else {
+        atomic_fetch_add(&snapshots->failed, 1);
+        debug("[Snapshot] Child %d failed (status %d)\n", snapshots->children[slot], status);
+    }
+    snapshots->children[slot] = 0;
+}
+
+// =============================================================================
+// Snapshot Management
+// =============================================================================
+
+int snapshot_manager_init(snapshot_manager_t* snapshots) {
+    memset(snapshots, 0, sizeof(snapshot_manager_t));
+    atomic_init(&snapshots->saved, 0);
+    atomic_init(&snapshots->skipped, 0);
+    atomic_init(&snapshots->failed, 0);
+
+    // Blocked in every thread, SIGCHLD is only ever read from the signalfd
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    if (pthread_sigmask(SIG_BLOCK, &mask, NULL) != 0) {
+        return -1;
+    }
+
+    snapshots->signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (snapshots->signal_fd < 0) {
+        debug("[Snapshot] Failed to create signalfd: %s\n", strerror(errno));
+        return -1;
+    }
+
+    if (pthread_mutex_init(&snapshots->mutex, NULL) != 0) {
+        close(snapshots->signal_fd);
+        return -1;
+    }
+
+    return 0;
+}
+
+pid_t snapshot_save(snapshot_manager_t* snapshots, const board_t* board, const char* path,
+                    pid_t previous_pid) {
+    // Built before forking: the child must not format strings
+    char tmp_path[SNAPSHOT_PATH_LENGTH + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    pthread_mutex_lock(&snapshots->mutex);
+
+    int slot = -1;
+    bool busy = false;
+    for (int i = 0; i < SNAPSHOT_MAX_CHILDREN; i++) {
+        if (snapshots->children[i] == 0) {
+            if (slot < 0) slot = i;
+        } else if (snapshots->children[i] == previous_pid) {
+            busy = true;
+        }
+    }
+    if (busy || slot < 0) {
+        pthread_mutex_unlock(&snapshots->mutex);
+        atomic_fetch_add(&snapshots->skipped, 1);
+        debug("[Snapshot] Quicksave skipped (%s)\n",
+              busy ? "previous one still running" : "too many running");
+        return -1;
+    }
+
+    // Forking under the lock, so a child is in children before it is reaped
+    pid_t pid = fork();
+    if (pid == 0) {
+        _exit(write_snapshot(board, path, tmp_path));
+    }
+    if (pid < 0) {
+        pthread_mutex_unlock(&snapshots->mutex);
+        atomic_fetch_add(&snapshots->failed, 1);
+        debug("[Snapshot] Failed to fork: %s\n", strerror(errno));
+        return -1;
+    }
+    snapshots->children[slot] = pid;
+
+    pthread_mutex_unlock(&snapshots->mutex);
+
+    debug("[Snapshot] Child %d is saving to %s\n", pid, path);
+    return pid;
+}
+
+void snapshot_reap(snapshot_manager_t* snapshots) {
+    // Signals coalesce, so the count read means nothing - check every child
+    struct signalfd_siginfo info;
+    while (read(snapshots->signal_fd, &info, sizeof(info)) == (ssize_t)sizeof(info)) {
+    }
+
+    pthread_mutex_lock(&snapshots->mutex);
+    for (int i = 0; i < SNAPSHOT_MAX_CHILDREN; i++) {
+        int status;
+        if (snapshots->children[i] != 0 &&
+            waitpid(snapshots->children[i], &status, WNOHANG) > 0) {
+            release_child(snapshots, i, status);
+        }
+    }
+    pthread_mutex_unlock(&snapshots->mutex);
+}
+
+void snapshot_manager_shutdown(snapshot_manager_t* snapshots) {
+    pthread_mutex_lock(&snapshots->mutex);
+    for (int i = 0; i < SNAPSHOT_MAX_CHILDREN; i++) {
+        int status;
+        if (snapshots->children[i] == 0) {
+            continue;
+        }
+        pid_t done;
+        while ((done = waitpid(snapshots->children[i], &status, 0)) < 0 && errno == EINTR) {
+        }
+        if (done < 0) {
+            snapshots->children[i] = 0;  // Already reaped
+            continue;
+        }
+        release_child(snapshots, i, status);
+    }
+    pthread_mutex_unlock(&snapshots->mutex);
+
+    debug("[Snapshot] Stopped (saved=%ld skipped=%ld failed=%ld)\n",
+          atomic_load(&snapshots->saved), atomic_load(&snapshots->skipped),
+          atomic_load(&snapshots->failed));
+}
+
+void snapshot_manager_destroy(snapshot_manager_t* snapshots) {
+    pthread_mutex_destroy(&snapshots->mutex);
+    close(snapshots->signal_fd);
+}
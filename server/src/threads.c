@@ -2,89 +2,57 @@
 #include "session.h"
 #include "display.h"
 #include "leaderboard.h"
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <errno.h>
-#include <ctype.h>
 
 // =============================================================================
-// Internal Structures
+// Time Helpers
 // =============================================================================
 
-// Data passed to each ghost thread
-typedef struct {
-    game_context_t* ctx;
-    int ghost_index;
-} ghost_thread_data_t;
+static void timespec_add_ms(struct timespec* ts, int milliseconds) {
+    ts->tv_sec += milliseconds / 1000;
+    ts->tv_nsec += (long)(milliseconds % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+static bool timespec_before(const struct timespec* a, const struct timespec* b) {
+    return a->tv_sec < b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
 
 // =============================================================================
 // Context Initialization / Cleanup
 // =============================================================================
 
-int init_game_context(game_context_t* ctx, board_t* board, client_session_t* session) {
+void init_game_context(game_context_t* ctx, client_session_t* session) {
     memset(ctx, 0, sizeof(game_context_t));
-    ctx->board = board;
     ctx->session = session;
     ctx->state = GAME_PAUSED;
-    ctx->pacman_dead = false;
-    ctx->board_changed = true;  // Initial update needed
-    ctx->threads_running = false;
     ctx->leaderboard = NULL;
     ctx->leaderboard_index = -1;
-    
-    // Initialize RW lock for board access
-    if (pthread_rwlock_init(&ctx->board_lock, NULL) != 0) {
-        return -1;
-    }
-    
-    // Initialize state mutex
-    if (pthread_mutex_init(&ctx->state_mutex, NULL) != 0) {
-        pthread_rwlock_destroy(&ctx->board_lock);
-        return -1;
-    }
-    
-    // Initialize display condition variable
-    if (pthread_cond_init(&ctx->display_cond, NULL) != 0) {
-        pthread_mutex_destroy(&ctx->state_mutex);
-        pthread_rwlock_destroy(&ctx->board_lock);
-        return -1;
-    }
-    
-    // Initialize game condition variable
-    if (pthread_cond_init(&ctx->game_cond, NULL) != 0) {
-        pthread_cond_destroy(&ctx->display_cond);
-        pthread_mutex_destroy(&ctx->state_mutex);
-        pthread_rwlock_destroy(&ctx->board_lock);
-        return -1;
-    }
-    
-    // Allocate ghost thread handles
-    ctx->n_ghost_threads = board->n_ghosts;
-    if (ctx->n_ghost_threads > 0) {
-        ctx->ghost_threads = calloc((size_t)ctx->n_ghost_threads, sizeof(pthread_t));
-        if (!ctx->ghost_threads) {
-            pthread_cond_destroy(&ctx->game_cond);
-            pthread_cond_destroy(&ctx->display_cond);
-            pthread_mutex_destroy(&ctx->state_mutex);
-            pthread_rwlock_destroy(&ctx->board_lock);
-            return -1;
-        }
-    }
-    
-    return 0;
+    ctx->snapshots = NULL;
+    ctx->quicksave_pid = -1;
+    ctx->journal = NULL;
 }
 
 void cleanup_game_context(game_context_t* ctx) {
-    if (ctx->ghost_threads) {
-        free(ctx->ghost_threads);
-        ctx->ghost_threads = NULL;
-    }
-    
-    pthread_cond_destroy(&ctx->game_cond);
-    pthread_cond_destroy(&ctx->display_cond);
-    pthread_mutex_destroy(&ctx->state_mutex);
-    pthread_rwlock_destroy(&ctx->board_lock);
+    ctx->board = NULL;
+    ctx->session = NULL;
+}
+
+void game_set_level(game_context_t* ctx, board_t* board, int level, bool last_level) {
+    ctx->board = board;
+    ctx->state = GAME_PAUSED;
+    ctx->pacman_dead = false;
+    ctx->level = level;
+    ctx->last_level = last_level;
+    ctx->tempo = board->tempo > 0 ? board->tempo : 100;
+    ctx->tick = 0;
 }
 
 void set_game_leaderboard(game_context_t* ctx, leaderboard_t* lb, int lb_index) {
@@ -92,330 +60,248 @@ void set_game_leaderboard(game_context_t* ctx, leaderboard_t* lb, int lb_index)
     ctx->leaderboard_index = lb_index;
 }
 
+void set_game_snapshots(game_context_t* ctx, snapshot_manager_t* snapshots, const char* client_id) {
+    ctx->snapshots = snapshots;
+    snprintf(ctx->quicksave_path, sizeof(ctx->quicksave_path), SNAPSHOT_PATH_FORMAT, client_id);
+}
+
+void set_game_journal(game_context_t* ctx, journal_t* journal, const char* client_id) {
+    ctx->journal = journal;
+    snprintf(ctx->client_id, sizeof(ctx->client_id), "%s", client_id);
+}
+
 // =============================================================================
-// State Management (Thread-Safe)
+// State Management (engine only - the state is returned by game_step, so
+// nobody else needs to read it, let alone wait for it)
 // =============================================================================
 
 void set_game_state(game_context_t* ctx, game_state_t state) {
-    pthread_mutex_lock(&ctx->state_mutex);
     ctx->state = state;
-    pthread_cond_broadcast(&ctx->game_cond);  // Wake all waiting threads
-    pthread_mutex_unlock(&ctx->state_mutex);
 }
 
 game_state_t get_game_state(game_context_t* ctx) {
-    pthread_mutex_lock(&ctx->state_mutex);
-    game_state_t state = ctx->state;
-    pthread_mutex_unlock(&ctx->state_mutex);
-    return state;
+    return ctx->state;
 }
 
-void request_display_refresh(game_context_t* ctx) {
-    pthread_mutex_lock(&ctx->state_mutex);
-    ctx->board_changed = true;
-    pthread_cond_signal(&ctx->display_cond);
-    pthread_mutex_unlock(&ctx->state_mutex);
+/**
+ * Records that pacman died and ends the level.
+ */
+static void end_with_dead_pacman(game_context_t* ctx) {
+    ctx->pacman_dead = true;
+    set_game_state(ctx, GAME_OVER);
 }
 
 // =============================================================================
-// Session Thread (Sends board updates to client via FIFO)
+// Tick Engine
 // =============================================================================
 
-void* session_thread_func(void* arg) {
-    game_context_t* ctx = (game_context_t*)arg;
-    client_session_t* session = ctx->session;
-    board_t* board = ctx->board;
-    
-    // Block SIGUSR1 - only host thread should receive it
-    block_sigusr1();
-    
-    debug("[Session] Thread started\n");
-    
-    while (ctx->threads_running) {
-        game_state_t state = get_game_state(ctx);
-        
-        // Check if game has ended
-        int victory = (state == GAME_WON || state == GAME_NEXT_LEVEL) ? 1 : 0;
-        int game_over = (state == GAME_OVER || state == GAME_QUIT || 
-                        state == GAME_CLIENT_DISCONNECTED) ? 1 : 0;
-        
-        // Send board update to client
-        pthread_rwlock_rdlock(&ctx->board_lock);
-        int result = send_board_update(session, board, victory, game_over);
-        pthread_rwlock_unlock(&ctx->board_lock);
-        
-        if (result < 0) {
-            // Client disconnected
-            debug("[Session] Failed to send board update, client disconnected\n");
-            set_game_state(ctx, GAME_CLIENT_DISCONNECTED);
-            break;
-        }
-        
-        // Exit if game ended (after sending the final update with game_over/victory)
-        if (state != GAME_RUNNING) {
-            debug("[Session] Game ended with state %d (victory=%d, game_over=%d)\n", 
-                  state, victory, game_over);
-            break;
-        }
-        
-        // Wait for tempo before sending next update
-        int tempo = board->tempo > 0 ? board->tempo : 100;
-        sleep_ms(tempo);
+/**
+ * Starts writing the board to the session's snapshot file. A child process
+ * does the writing, so the tick never waits for it.
+ */
+static void quicksave(game_context_t* ctx) {
+    if (!ctx->snapshots) {
+        return;
     }
-    
-    debug("[Session] Thread exiting\n");
-    return NULL;
-}
 
-// =============================================================================
-// Pacman Thread (Reads commands from client FIFO)
-// =============================================================================
+    pid_t pid = snapshot_save(ctx->snapshots, ctx->board, ctx->quicksave_path, ctx->quicksave_pid);
+    if (pid > 0) {
+        ctx->quicksave_pid = pid;
+    }
+}
 
-void* pacman_thread_func(void* arg) {
-    game_context_t* ctx = (game_context_t*)arg;
-    board_t* board = ctx->board;
-    client_session_t* session = ctx->session;
+tick_result_t simulate_tick(board_t* board, char command) {
     pacman_t* pacman = &board->pacmans[0];
-    
-    // Block SIGUSR1 - only host thread should receive it
-    block_sigusr1();
-    
-    debug("[Pacman] Thread started\n");
-    
-    // Wait for initial passo
-    if (pacman->waiting > 0) {
-        for (int i = 0; i < pacman->waiting && ctx->threads_running; i++) {
-            sleep_ms(board->tempo > 0 ? board->tempo : 100);
-        }
-    }
-    
-    while (ctx->threads_running && get_game_state(ctx) == GAME_RUNNING) {
-        // Read command from client via FIFO
-        char cmd_char;
-        int result = read_client_command(session, &cmd_char);
-        
-        if (result < 0) {
-            // Client disconnected or error
-            debug("[Pacman] Client disconnected\n");
-            set_game_state(ctx, GAME_CLIENT_DISCONNECTED);
-            break;
-        }
-        
-        if (result == -2) {
-            // Client requested disconnect
-            debug("[Pacman] Client requested disconnect\n");
-            set_game_state(ctx, GAME_QUIT);
-            break;
-        }
-        
-        // Handle quit command
-        if (cmd_char == 'Q' || cmd_char == 'q') {
-            set_game_state(ctx, GAME_QUIT);
-            break;
+
+    if (command != 0) {
+        command_t cmd;
+        cmd.command = command;
+        cmd.turns = 1;
+        cmd.turns_left = 1;
+
+        int move_result = move_pacman(board, 0, &cmd);
+        if (move_result == REACHED_PORTAL) {
+            return TICK_PORTAL;
         }
-        
-        // Convert to uppercase
-        cmd_char = (char)toupper((unsigned char)cmd_char);
-        
-        // Only process valid movement commands
-        if (cmd_char == 'W' || cmd_char == 'A' || cmd_char == 'S' || cmd_char == 'D') {
-            command_t cmd;
-            cmd.command = cmd_char;
-            cmd.turns = 1;
-            cmd.turns_left = 1;
-            
-            // Write lock for moving pacman
-            pthread_rwlock_wrlock(&ctx->board_lock);
-            
-            debug("[Pacman] Moving: %c\n", cmd.command);
-            int move_result = move_pacman(board, 0, &cmd);
-            bool is_alive = pacman->alive;
-            
-            // Update session points
-            session->accumulated_points = pacman->points;
-            
-            // Update leaderboard in real-time
-            if (ctx->leaderboard && ctx->leaderboard_index >= 0) {
-                leaderboard_update_points(ctx->leaderboard, ctx->leaderboard_index, 
-                                         session->accumulated_points);
-            }
-            
-            pthread_rwlock_unlock(&ctx->board_lock);
-            
-            // Handle movement result
-            if (move_result == REACHED_PORTAL) {
-                set_game_state(ctx, GAME_NEXT_LEVEL);
-                break;
-            }
-            
-            if (move_result == DEAD_PACMAN || !is_alive) {
-                pthread_mutex_lock(&ctx->state_mutex);
-                ctx->pacman_dead = true;
-                pthread_mutex_unlock(&ctx->state_mutex);
-                set_game_state(ctx, GAME_OVER);
-                break;
-            }
-            
-            // Request session thread to send updated board
-            request_display_refresh(ctx);
+        if (move_result == DEAD_PACMAN || !pacman->alive) {
+            return TICK_PACMAN_DEAD;
         }
     }
-    
-    debug("[Pacman] Thread exiting\n");
-    return NULL;
-}
 
-// =============================================================================
-// Ghost Thread
-// =============================================================================
+    // Step every ghost, in order
+    for (int i = 0; i < board->n_ghosts; i++) {
+        ghost_t* ghost = &board->ghosts[i];
 
-void* ghost_thread_func(void* arg) {
-    ghost_thread_data_t* data = (ghost_thread_data_t*)arg;
-    game_context_t* ctx = data->ctx;
-    int ghost_index = data->ghost_index;
-    board_t* board = ctx->board;
-    ghost_t* ghost = &board->ghosts[ghost_index];
-    
-    // Block SIGUSR1 - only host thread should receive it
-    block_sigusr1();
-    
-    debug("[Ghost %d] Thread started\n", ghost_index);
-    
-    // Wait for initial passo
-    if (ghost->waiting > 0) {
-        for (int i = 0; i < ghost->waiting && ctx->threads_running; i++) {
-            sleep_ms(board->tempo > 0 ? board->tempo : 100);
-        }
-    }
-    
-    while (ctx->threads_running && get_game_state(ctx) == GAME_RUNNING) {
         // Skip if ghost has no moves defined
         if (ghost->n_moves == 0) {
-            sleep_ms(100);
             continue;
         }
-        
-        // Get current move
+
         command_t* cmd = &ghost->moves[ghost->current_move % ghost->n_moves];
-        
-        // Write lock for moving ghost
-        pthread_rwlock_wrlock(&ctx->board_lock);
-        
-        debug("[Ghost %d] Cmd: %c (move %d)\n", ghost_index, cmd->command, ghost->current_move);
-        int result = move_ghost(board, ghost_index, cmd);
-        
-        // Check if pacman was killed
-        if (!board->pacmans[0].alive) {
-            pthread_rwlock_unlock(&ctx->board_lock);
-            
-            pthread_mutex_lock(&ctx->state_mutex);
-            ctx->pacman_dead = true;
-            pthread_mutex_unlock(&ctx->state_mutex);
-            
-            set_game_state(ctx, GAME_OVER);
-            break;
-        }
-        
-        pthread_rwlock_unlock(&ctx->board_lock);
-        
-        // Request display refresh
-        request_display_refresh(ctx);
-        
+        int result = move_ghost(board, i, cmd);
+
         // Advance to next move only if command was completed
         if (result == MOVE_COMPLETED) {
             ghost->current_move++;
         }
-        
-        // Small delay for game timing
-        sleep_ms(board->tempo > 0 ? board->tempo : 100);
+
+        // Collisions - a ghost walked into pacman
+        if (!pacman->alive) {
+            debug("[Engine] Pacman killed by ghost %d\n", i);
+            return TICK_PACMAN_DEAD;
+        }
     }
-    
-    debug("[Ghost %d] Thread exiting\n", ghost_index);
-    
-    // Free the thread data
-    free(data);
-    return NULL;
+
+    return TICK_PLAYING;
 }
 
-// =============================================================================
-// Thread Management
-// =============================================================================
+void game_tick(game_context_t* ctx) {
+    board_t* board = ctx->board;
+    client_session_t* session = ctx->session;
 
-int start_game_threads(game_context_t* ctx) {
-    ctx->threads_running = true;
-    set_game_state(ctx, GAME_RUNNING);
-    
-    // Start session thread (sends board updates to client)
-    if (pthread_create(&ctx->session_thread, NULL, session_thread_func, ctx) != 0) {
-        ctx->threads_running = false;
-        return -1;
+    ctx->tick++;
+
+    // 1. Take one queued pacman command
+    char cmd_char;
+    int input = session_pop_command(session, &cmd_char);
+
+    if (input == SESSION_INPUT_QUIT) {
+        debug("[Engine] Tick %ld - client quit\n", ctx->tick);
+        set_game_state(ctx, GAME_QUIT);
+        return;
     }
-    
-    // Start pacman thread (reads commands from client)
-    if (pthread_create(&ctx->pacman_thread, NULL, pacman_thread_func, ctx) != 0) {
-        ctx->threads_running = false;
-        pthread_join(ctx->session_thread, NULL);
-        return -1;
+
+    if (input == SESSION_INPUT_CLOSED) {
+        debug("[Engine] Tick %ld - client disconnected\n", ctx->tick);
+        set_game_state(ctx, GAME_CLIENT_DISCONNECTED);
+        return;
     }
-    
-    // Start ghost threads
-    for (int i = 0; i < ctx->n_ghost_threads; i++) {
-        ghost_thread_data_t* data = malloc(sizeof(ghost_thread_data_t));
-        if (!data) {
-            // Cleanup on failure
-            ctx->threads_running = false;
-            pthread_join(ctx->pacman_thread, NULL);
-            pthread_join(ctx->session_thread, NULL);
-            for (int j = 0; j < i; j++) {
-                pthread_join(ctx->ghost_threads[j], NULL);
-            }
-            return -1;
+
+    char move = 0;
+    if (input == 1 && cmd_char == 'G') {
+        debug("[Engine] Tick %ld - quicksave\n", ctx->tick);
+        quicksave(ctx);
+    } else if (input == 1) {
+        debug("[Engine] Tick %ld - pacman: %c\n", ctx->tick, cmd_char);
+        move = cmd_char;
+
+        // Only queued here - the log thread makes it durable. Without this
+        // input the journaled ones after it mean nothing, so a refused one
+        // ends the game's journaling
+        if (ctx->journal && journal_append_input(ctx->journal, ctx->client_id, ctx->tick, move) < 0) {
+            journal_abandon(ctx->journal, ctx->client_id, session->accumulated_points);
+            ctx->journal = NULL;
         }
-        
-        data->ctx = ctx;
-        data->ghost_index = i;
-        
-        if (pthread_create(&ctx->ghost_threads[i], NULL, ghost_thread_func, data) != 0) {
-            free(data);
-            ctx->threads_running = false;
-            pthread_join(ctx->pacman_thread, NULL);
-            pthread_join(ctx->session_thread, NULL);
-            for (int j = 0; j < i; j++) {
-                pthread_join(ctx->ghost_threads[j], NULL);
-            }
-            return -1;
+    }
+
+    // 2. Move pacman and every ghost, resolving collisions
+    tick_result_t result = simulate_tick(board, move);
+
+    if (move != 0) {
+        // Update session points
+        session->accumulated_points = board->pacmans[0].points;
+
+        // Update leaderboard in real-time
+        if (ctx->leaderboard && ctx->leaderboard_index >= 0) {
+            leaderboard_update_points(ctx->leaderboard, ctx->leaderboard_index,
+                                     session->accumulated_points);
         }
     }
-    
-    debug("[Main] All %d threads started\n", 2 + ctx->n_ghost_threads);
+
+    if (result == TICK_PORTAL) {
+        set_game_state(ctx, GAME_NEXT_LEVEL);
+        return;
+    }
+    if (result == TICK_PACMAN_DEAD) {
+        end_with_dead_pacman(ctx);
+        return;
+    }
+
+    // 3. Checkpoint now and then, so recovery replays few inputs
+    if (ctx->journal && ctx->tick % JOURNAL_CHECKPOINT_TICKS == 0) {
+        journal_append_checkpoint(ctx->journal, ctx->client_id, ctx->level, ctx->tick, board);
+    }
+}
+
+/**
+ * Sends the current board to the client.
+ * Returns -1 if the client is gone.
+ */
+static int publish_frame(game_context_t* ctx, game_state_t state) {
+    // A finished level only counts as victory when it is the last one
+    // (the client stops on victory)
+    int victory = (state == GAME_WON ||
+                  (state == GAME_NEXT_LEVEL && ctx->last_level)) ? 1 : 0;
+    int game_over = (state == GAME_OVER || state == GAME_QUIT ||
+                    state == GAME_CLIENT_DISCONNECTED) ? 1 : 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &ctx->last_frame_time);
+    return send_board_update(ctx->session, ctx->board, victory, game_over);
+}
+
+
+int game_begin(game_context_t* ctx) {
+    set_game_state(ctx, GAME_RUNNING);
+
+    debug("[Engine] Level started (tempo=%d ms, %d ghosts)\n", ctx->tempo, ctx->board->n_ghosts);
+
+    // Initial board
+    if (publish_frame(ctx, GAME_RUNNING) < 0) {
+        debug("[Engine] Failed to send board update, client disconnected\n");
+        set_game_state(ctx, GAME_CLIENT_DISCONNECTED);
+        return -1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &ctx->next_tick);
+    timespec_add_ms(&ctx->next_tick, ctx->tempo);
     return 0;
 }
 
-void stop_game_threads(game_context_t* ctx) {
-    debug("[Main] Stopping threads...\n");
-    
-    // Signal all threads to stop
-    ctx->threads_running = false;
-    
-    // Wake up any waiting threads
-    pthread_mutex_lock(&ctx->state_mutex);
-    pthread_cond_broadcast(&ctx->display_cond);
-    pthread_cond_broadcast(&ctx->game_cond);
-    pthread_mutex_unlock(&ctx->state_mutex);
-    
-    // Wait for session thread
-    pthread_join(ctx->session_thread, NULL);
-    debug("[Main] Session thread joined\n");
-    
-    // Wait for pacman thread
-    pthread_join(ctx->pacman_thread, NULL);
-    debug("[Main] Pacman thread joined\n");
-    
-    // Wait for ghost threads
-    for (int i = 0; i < ctx->n_ghost_threads; i++) {
-        pthread_join(ctx->ghost_threads[i], NULL);
-        debug("[Main] Ghost %d thread joined\n", i);
+game_state_t game_step(game_context_t* ctx) {
+    board_t* board = ctx->board;
+
+    game_state_t state = get_game_state(ctx);
+    if (state == GAME_RUNNING) {
+        game_tick(ctx);
+        state = get_game_state(ctx);
+
+        // Deadlines are absolute, so ticks do not drift; if we fell more
+        // than a tick behind, skip ahead instead of bursting
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        timespec_add_ms(&ctx->next_tick, ctx->tempo);
+        if (timespec_before(&ctx->next_tick, &now)) {
+            ctx->next_tick = now;
+            timespec_add_ms(&ctx->next_tick, ctx->tempo);
+        }
     }
-    
-    debug("[Main] All threads stopped\n");
+
+    // Publish one frame per tick if anything changed (the board or what the
+    // client can see of it), a heartbeat when idle, and always the final frame
+    bool changed = board->n_dirty > 0 || board->dirty_overflow ||
+                   session_viewport_changed(ctx->session);
+    struct timespec heartbeat = ctx->last_frame_time;
+    timespec_add_ms(&heartbeat, SESSION_HEARTBEAT_MS);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    if (changed || state != GAME_RUNNING || !timespec_before(&now, &heartbeat)) {
+        if (publish_frame(ctx, state) < 0) {
+            debug("[Engine] Failed to send board update, client disconnected\n");
+            if (state == GAME_RUNNING) {
+                set_game_state(ctx, GAME_CLIENT_DISCONNECTED);
+                state = GAME_CLIENT_DISCONNECTED;
+            }
+        }
+    } else if (session_flush_output(ctx->session) < 0) {
+        // Nothing new, but the rest of a frame the client was slow to read
+        debug("[Engine] Failed to send queued frames, client disconnected\n");
+        set_game_state(ctx, GAME_CLIENT_DISCONNECTED);
+        state = GAME_CLIENT_DISCONNECTED;
+    }
+
+    if (state != GAME_RUNNING) {
+        debug("[Engine] Level ended with state %d after %ld ticks\n", state, ctx->tick);
+    }
+    return state;
 }